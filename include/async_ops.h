@@ -0,0 +1,78 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#ifndef ASYNC_OPS_H
+#define ASYNC_OPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ASYNC_PRIORITY_AUTO   (-1)
+#define ASYNC_PRIORITY_HIGH   0
+#define ASYNC_PRIORITY_NORMAL 1
+#define ASYNC_PRIORITY_LOW    2
+
+typedef enum {
+  ASYNC_PENDING   = 0,
+  ASYNC_RUNNING,
+  ASYNC_DONE,
+  ASYNC_CANCELLED
+} async_status_t;
+
+typedef struct __async_job_struct_t async_job_t;
+
+/* Called by the executor before the job counts as done: the callback
+   must not wait for its own job, async_wait then returns -1.
+*/
+typedef void (*async_callback_t)(async_job_t *job, int result, void *arg);
+
+void async_set_executors(unsigned int n);
+
+async_job_t *async_multiplication(uint64_t *p,
+				  const uint64_t *a, size_t m,
+				  const uint64_t *b, size_t n,
+				  int priority,
+				  async_callback_t callback, void *arg);
+
+async_job_t *async_division(uint64_t *q, uint64_t *r,
+			    const uint64_t *a, size_t m,
+			    const uint64_t *b, size_t n,
+			    int priority,
+			    async_callback_t callback, void *arg);
+
+async_job_t *async_convert_to_string_base(char *str,
+					  const uint64_t *a, size_t n,
+					  unsigned int base,
+					  int priority,
+					  async_callback_t callback, void *arg);
+
+async_job_t *async_convert_from_string_base(uint64_t *a, size_t n,
+					    const char *str,
+					    unsigned int base,
+					    int priority,
+					    async_callback_t callback, void *arg);
+
+async_status_t async_poll(async_job_t *job);
+
+int async_wait(async_job_t *job);
+
+int async_cancel(async_job_t *job);
+
+int async_eventfd(async_job_t *job);
+
+void async_release(async_job_t *job);
+
+
+#endif
@@ -31,13 +31,31 @@ void multiplication(uint64_t *p,
 		    const uint64_t *a, size_t m,
 		    const uint64_t *b, size_t n);
 
+uint64_t mul_1(uint64_t *p, const uint64_t *a, size_t n, uint64_t b);
+
+uint64_t divrem_1(uint64_t *q, const uint64_t *a, size_t n, uint64_t d);
+
 void divide_by_ten(uint64_t *q, unsigned int *r,
 		   const uint64_t *a, size_t n);
 
+int division(uint64_t *q, uint64_t *r,
+	     const uint64_t *a, size_t m,
+	     const uint64_t *b, size_t n);
+
 void shift_left(uint64_t *a, size_t n, size_t k);
 
 void shift_right(uint64_t *a, size_t n, size_t k);
 
+uint64_t lshift(uint64_t *dst, const uint64_t *src, size_t n, unsigned int k);
+
+uint64_t rshift(uint64_t *dst, const uint64_t *src, size_t n, unsigned int k);
+
+uint64_t addlsh(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+		size_t n, unsigned int k);
+
+uint64_t sublsh(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+		size_t n, unsigned int k);
+
 int comparison(const uint64_t *a,
 	       const uint64_t *b,
 	       size_t n);
@@ -50,8 +68,104 @@ int convert_from_decimal_string(uint64_t *a, size_t n,
 void convert_to_decimal_string(char *str,
 			       const uint64_t *a, size_t n);
 
+int convert_from_string_base(uint64_t *a, size_t n, const char *str,
+			     unsigned int base);
+
+void convert_to_string_base(char *str, const uint64_t *a, size_t n,
+			    unsigned int base);
+
+size_t convert_to_string_base_size(const uint64_t *a, size_t n,
+				   unsigned int base);
+
+typedef char *(*string_sink_t)(void *arg, char *str, size_t len);
+
+int convert_to_string_base_stream(const uint64_t *a, size_t n, unsigned int base,
+				  size_t block, string_sink_t sink, void *arg);
+
+typedef int (*string_source_t)(void *arg, const char **str, size_t *len);
+
+int convert_from_string_base_stream(uint64_t **a, size_t *n, unsigned int base,
+				    size_t hint, string_source_t source, void *arg);
+
+uint64_t decimal_digit_count(const uint64_t *a, size_t n);
+
+double log10_approx(const uint64_t *a, size_t n);
+
+size_t leading_decimal_digits(char *str, size_t k, const uint64_t *a, size_t n);
+
+void convert_to_string_pow2(char *str, const uint64_t *a, size_t n,
+			    unsigned int k, const char *alphabet);
+
+int convert_from_string_pow2(uint64_t *a, size_t n, const char *str,
+			     unsigned int k, const char *alphabet);
+
+void convert_to_hex_string(char *str, const uint64_t *a, size_t n);
+
+int convert_from_hex_string(uint64_t *a, size_t n, const char *str);
+
+void convert_to_bytes(unsigned char *bytes, size_t len,
+		      const uint64_t *a, size_t n, int big_endian);
+
+void convert_from_bytes(uint64_t *a, size_t n,
+			const unsigned char *bytes, size_t len, int big_endian);
+
 uint64_t leading_zeros(const uint64_t *a, size_t n);
 
+uint64_t trailing_zeros(const uint64_t *a, size_t n);
+
+uint64_t popcount(const uint64_t *a, size_t n);
+
+uint64_t bit_length(const uint64_t *a, size_t n);
+
+int test_bit(const uint64_t *a, size_t n, uint64_t k);
+
+void set_bit(uint64_t *a, size_t n, uint64_t k);
+
+void clear_bit(uint64_t *a, size_t n, uint64_t k);
+
+void bitwise_and(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n);
+
+void bitwise_or(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n);
+
+void bitwise_xor(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n);
+
+void bitwise_andnot(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n);
+
+void bitwise_not(uint64_t *r, const uint64_t *a, size_t n);
+
+typedef struct {
+  uint64_t       *p;
+  const uint64_t *a;
+  size_t         m;
+  const uint64_t *b;
+  size_t         n;
+} multiplication_desc_t;
+
+typedef struct {
+  uint64_t       *q;
+  uint64_t       *r;
+  const uint64_t *a;
+  size_t         m;
+  const uint64_t *b;
+  size_t         n;
+  int            result;
+} division_desc_t;
+
+typedef struct {
+  char     *str;
+  uint64_t *a;
+  size_t   n;
+  int      result;
+} decimal_string_desc_t;
+
+void multiplication_batch(multiplication_desc_t *ops, size_t count);
+
+void division_batch(division_desc_t *ops, size_t count);
+
+void convert_to_decimal_string_batch(decimal_string_desc_t *ops, size_t count);
+
+void convert_from_decimal_string_batch(decimal_string_desc_t *ops, size_t count);
+
 #endif
 
 
@@ -0,0 +1,62 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter 
+                   
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#ifndef IO_OPS_H
+#define IO_OPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "widefloat_ops.h"
+
+typedef enum {
+  IO_MODE_READ     = 0,
+  IO_MODE_MMAP
+} iomode_t;
+
+typedef struct {
+  void   *base;
+  size_t length;
+  size_t offset;
+} binary_map_t;
+
+int read_decimal_fd(uint64_t **a, size_t *n, int fd,
+		    size_t size_hint, iomode_t mode);
+
+int read_decimal_mapped(uint64_t **a, size_t *n,
+			const char *data, size_t len);
+
+int write_decimal_fd(int fd, const uint64_t *a, size_t n);
+
+int write_decimal_file(FILE *f, const uint64_t *a, size_t n);
+
+int write_binary_integer(int fd, const uint64_t *a, size_t n);
+
+int write_binary_widefloat(int fd, const widefloat_t *x);
+
+int binary_map_open(binary_map_t *map, int fd);
+
+void binary_map_close(binary_map_t *map);
+
+int binary_map_integer(binary_map_t *map, uint64_t **a, size_t *n);
+
+int binary_map_widefloat(binary_map_t *map, widefloat_t *x);
+
+int multiplication_out_of_core(int pfd, int afd, size_t m, int bfd, size_t n,
+			       size_t memory);
+
+
+#endif
+
@@ -0,0 +1,54 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#ifndef RNS_OPS_H
+#define RNS_OPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  size_t   count;
+  uint64_t *primes;
+  uint64_t *barrett;
+  uint64_t *cofactors;
+  void     *tree;
+} rns_base_t;
+
+typedef struct {
+  const rns_base_t *base;
+  uint64_t         *residues;
+} rns_t;
+
+int rns_base_init(rns_base_t *base, uint64_t bits);
+
+void rns_base_clear(rns_base_t *base);
+
+void rns_init(rns_t *x, const rns_base_t *base);
+
+void rns_clear(rns_t *x);
+
+void rns_set_integer(rns_t *x, const uint64_t *a, size_t n);
+
+void rns_get_integer(uint64_t *a, size_t n, const rns_t *x);
+
+void rns_add(rns_t *r, const rns_t *x, const rns_t *y);
+
+void rns_sub(rns_t *r, const rns_t *x, const rns_t *y);
+
+void rns_mul(rns_t *r, const rns_t *x, const rns_t *y);
+
+
+#endif
@@ -0,0 +1,37 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#ifndef SHARD_OPS_H
+#define SHARD_OPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct __shard_engine_struct_t shard_engine_t;
+
+shard_engine_t *shard_engine_start(unsigned int workers);
+
+void shard_engine_stop(shard_engine_t *engine);
+
+int shard_worker_serve(int fd);
+
+unsigned int shard_engine_last_shards(const shard_engine_t *engine);
+
+int multiplication_sharded(shard_engine_t *engine, uint64_t *p,
+			   const uint64_t *a, size_t m,
+			   const uint64_t *b, size_t n);
+
+
+#endif
@@ -0,0 +1,52 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*thread_task_func_t)(void *);
+
+typedef struct __thread_task_struct_t {
+  thread_task_func_t            func;
+  void                          *arg;
+  int                           queue;
+  int                           state;
+  struct __thread_task_struct_t *parent;
+} thread_task_t;
+
+typedef struct {
+  void   *chunk;
+  size_t used;
+} thread_scratch_mark_t;
+
+void utepnum_set_threads(unsigned int n);
+
+unsigned int utepnum_get_threads(void);
+
+void thread_pool_fork(thread_task_t *task, thread_task_func_t func, void *arg);
+
+void thread_pool_join(thread_task_t *task);
+
+thread_scratch_mark_t thread_scratch_mark(void);
+
+void *thread_scratch_alloc(size_t nmemb, size_t size);
+
+void thread_scratch_release(thread_scratch_mark_t mark);
+
+
+#endif
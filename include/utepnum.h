@@ -17,6 +17,11 @@
 #define UTEPNUM_H
 
 #include "integer_ops.h"
+#include "io_ops.h"
+#include "thread_pool.h"
+#include "async_ops.h"
+#include "shard_ops.h"
+#include "rns_ops.h"
 
 
 #endif
@@ -49,6 +49,28 @@ void widefloat_set_from_integer(widefloat_t *op,
 				const uint64_t *m,
 				size_t n);
 
+void widefloat_add(widefloat_t *r, const widefloat_t *a, const widefloat_t *b);
+
+void widefloat_sub(widefloat_t *r, const widefloat_t *a, const widefloat_t *b);
+
+void widefloat_mul(widefloat_t *r, const widefloat_t *a, const widefloat_t *b);
+
+void widefloat_inv(widefloat_t *r, const widefloat_t *a);
+
+void widefloat_div(widefloat_t *r, const widefloat_t *a, const widefloat_t *b);
+
+void widefloat_sqrt(widefloat_t *r, const widefloat_t *a);
+
+void widefloat_rsqrt(widefloat_t *r, const widefloat_t *a);
+
+void widefloat_exp(widefloat_t *r, const widefloat_t *a);
+
+void widefloat_log(widefloat_t *r, const widefloat_t *a);
+
+void widefloat_sin_cos(widefloat_t *s, widefloat_t *c, const widefloat_t *a);
+
+void widefloat_twiddles(widefloat_t *out, size_t N);
+
 
 #endif
 
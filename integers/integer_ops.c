@@ -19,7 +19,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
+#include <math.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define DECIMAL_KERNELS_X86
+#endif
 #include "integer_ops.h"
+#include "thread_pool.h"
 
 /* Helper functions */
 
@@ -159,6 +166,34 @@ static inline void __free_mem(void *ptr) {
   free(ptr);
 }
 
+/* Returns the number of leading zero bits in a 64 bit integer.
+
+   If the integer is zero, 64 is returned.
+   
+*/
+static inline uint64_t __leading_zeros_uint64(uint64_t a) {
+  if (a == ((uint64_t) 0)) return (uint64_t) 64;
+
+  /* The builtin is undefined for zero, which we handled above. */
+  return (uint64_t) __builtin_clzll((unsigned long long int) a);
+}
+
+/* Returns the number of trailing zero bits in a 64 bit integer.
+
+   If the integer is zero, 64 is returned.
+   
+*/
+static inline uint64_t __trailing_zeros_uint64(uint64_t a) {
+  if (a == ((uint64_t) 0)) return (uint64_t) 64;
+
+  return (uint64_t) __builtin_ctzll((unsigned long long int) a);
+}
+
+/* Returns the number of bits set in a 64 bit integer. */
+static inline uint64_t __popcount_uint64(uint64_t a) {
+  return (uint64_t) __builtin_popcountll((unsigned long long int) a);
+}
+
 /* cout * 2^64 + s = a + b */
 static inline void __halfadder(uint64_t *cout, uint64_t *s,
 			       uint64_t a, uint64_t b) {
@@ -384,7 +419,7 @@ void shift_right(uint64_t *a, size_t n, size_t k) {
 
   /* Do the word shift, if needed */
   if (w >= ((size_t) 1)) {
-    for (i=0;i<w;i++) {
+    for (i=0;i<(n-w);i++) {
       a[i] = a[i+w];
     }
     for (i=(n-w);i<n;i++) {
@@ -403,65 +438,164 @@ void shift_right(uint64_t *a, size_t n, size_t k) {
   }
 }
 
-/* a becomes what is in the decimal string mod 2^(64 * n)
+/* dst = (src * 2^k) mod 2^(64 * n)
 
-   Returns 0 if success
-   Returns -1 if failure  (someone tries to convert "cheese")
+   Returns the k bits shifted out at the top, i.e. 
+
+   floor(src * 2^k / 2^(64 * n)).
+
+   The shift amount k must satisfy 0 <= k <= 63. Shifts by whole
+   digits are just offsets into the arrays.
+
+   dst and src have size n. dst may be the same array as src or start
+   above it, as the digits are processed from the most significant
+   one down.
 
 */
-int convert_from_decimal_string(uint64_t *a, size_t n,
-				const char *str) {
-  const char *curr;
-  uint64_t digit;
-  uint64_t *a_eight;
-  uint64_t *a_two;
-  uint64_t *t;
- 
-  /* Do nothing for the empty string */
-  if (str[0] == '\0') return -1;
+uint64_t lshift(uint64_t *dst, const uint64_t *src, size_t n, unsigned int k) {
+  uint64_t hi, lo, out;
+  size_t i, l;
 
-  /* Allocate memory */
-  a_eight = __alloc_mem(n, sizeof(*a_eight));
-  a_two = __alloc_mem(n, sizeof(*a_two));
-  t = __alloc_mem(n, sizeof(*t));
-  
-  /* Set a to zero */
-  __m_memset(a, 0, n, sizeof(*a));
+  if (n == ((size_t) 0)) return (uint64_t) 0;
 
-  /* Loop over the string */
-  for (curr=str; *curr!='\0'; curr++) {
-    if (!(('0' <= *curr) &&
-	  (*curr <= '9'))) {
-      /* Free memory */
-      __free_mem(a_eight);
-      __free_mem(a_two);
-      __free_mem(t);
-      
-      /* Indicate failure */
-      return -1;
-    }
-    digit = (uint64_t) (((int) *curr) - ((int) '0'));
+  /* Shift by 0 bits => just copy */
+  if (k == 0u) {
+    if (dst != src) memmove(dst, src, n * sizeof(*dst));
+    return (uint64_t) 0;
+  }
+
+  /* Here 1 <= k <= 63 */
+  hi = src[n - ((size_t) 1)];
+  out = hi >> (64u - k);
+  for (l=n-((size_t) 1),i=n-((size_t) 1);l>=((size_t) 1);l--,i--) {
+    lo = src[i - ((size_t) 1)];
+    dst[i] = (hi << k) | (lo >> (64u - k));
+    hi = lo;
+  }
+  dst[0] = hi << k;
+  return out;
+}
 
-    /* Multiply a by 10 and add in the digit 
+/* dst = floor(src / 2^k)
 
-       a * 10 = a * 8 + a * 2
+   Returns the k bits shifted out at the bottom, placed in the most
+   significant bits of the returned word, i.e.
 
-    */
-    __m_memcpy(a_eight, a, n, sizeof(*a));
-    __m_memcpy(a_two, a, n, sizeof(*a));
-    shift_left(a_eight, n, 3);
-    shift_left(a_two, n, 1);
-    addition(t, a_eight, n, a_two, n);
-    addition(a, t, n, &digit, 1);
+   (src * 2^(64 - k)) mod 2^64.
+
+   The shift amount k must satisfy 0 <= k <= 63.
+
+   dst and src have size n. dst may be the same array as src or start
+   below it, as the digits are processed from the least significant
+   one up.
+
+*/
+uint64_t rshift(uint64_t *dst, const uint64_t *src, size_t n, unsigned int k) {
+  uint64_t hi, lo, out;
+  size_t i;
+
+  if (n == ((size_t) 0)) return (uint64_t) 0;
+
+  /* Shift by 0 bits => just copy */
+  if (k == 0u) {
+    if (dst != src) memmove(dst, src, n * sizeof(*dst));
+    return (uint64_t) 0;
   }
 
-  /* Free memory */
-  __free_mem(a_eight);
-  __free_mem(a_two);
-  __free_mem(t);
+  /* Here 1 <= k <= 63 */
+  lo = src[0];
+  out = lo << (64u - k);
+  for (i=0;i<n-((size_t) 1);i++) {
+    hi = src[i + ((size_t) 1)];
+    dst[i] = (lo >> k) | (hi << (64u - k));
+    lo = hi;
+  }
+  dst[n - ((size_t) 1)] = lo >> k;
+  return out;
+}
 
-  /* Indicate success */
-  return 0;
+/* dst = (a + b * 2^k) mod 2^(64 * n)
+
+   Returns the part that does not fit, i.e.
+
+   floor((a + b * 2^k) / 2^(64 * n)).
+
+   The shift amount k must satisfy 0 <= k <= 63.
+
+   All arrays have size n. dst may be the same array as a or b. The
+   shifted b is never materialized: it is built digit by digit while
+   adding, so this is a single pass over the operands.
+
+*/
+uint64_t addlsh(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+		size_t n, unsigned int k) {
+  uint64_t cin, cout, prev, curr, t;
+  size_t i;
+
+  if (n == ((size_t) 0)) return (uint64_t) 0;
+
+  /* Shift by 0 bits => plain addition */
+  if (k == 0u) {
+    cin = (uint64_t) 0;
+    for (i=0;i<n;i++) {
+      __fulladder(&cout, &dst[i], a[i], b[i], cin);
+      cin = cout;
+    }
+    return cin;
+  }
+
+  /* Here 1 <= k <= 63 */
+  cin = (uint64_t) 0;
+  prev = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    curr = b[i];
+    t = (curr << k) | (prev >> (64u - k));
+    prev = curr;
+    __fulladder(&cout, &dst[i], a[i], t, cin);
+    cin = cout;
+  }
+  return (prev >> (64u - k)) + cin;
+}
+
+/* dst = (a - b * 2^k) mod 2^(64 * n)
+
+   Returns the amount that has been borrowed from above, i.e. the 
+   value w such that 
+
+   a - b * 2^k = dst - w * 2^(64 * n).
+
+   The shift amount k must satisfy 0 <= k <= 63.
+
+   All arrays have size n. dst may be the same array as a or b. As
+   for addlsh, this is a single pass over the operands.
+
+*/
+uint64_t sublsh(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+		size_t n, unsigned int k) {
+  uint64_t cin, cout, prev, curr, t;
+  size_t i;
+
+  if (n == ((size_t) 0)) return (uint64_t) 0;
+
+  /* Subtraction is addition of the complement with an initial carry,
+     as in subtraction(). The carry out is then 1 if nothing was 
+     borrowed.
+  */
+  cin = (uint64_t) 1;
+  prev = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    curr = b[i];
+    if (k == 0u) {
+      t = curr;
+    } else {
+      t = (curr << k) | (prev >> (64u - k));
+    }
+    prev = curr;
+    __fulladder(&cout, &dst[i], a[i], ~t, cin);
+    cin = cout;
+  }
+  if (k == 0u) return ((uint64_t) 1) - cin;
+  return (prev >> (64u - k)) + (((uint64_t) 1) - cin);
 }
 
 /* Returns  -1  if a < b
@@ -481,6 +615,13 @@ int comparison(const uint64_t *a, const uint64_t *b, size_t n) {
 /* hi * 2^64 + lo = a * b */
 static inline void __multiply_digits(uint64_t *hi, uint64_t *lo,
 				     uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 t;
+
+  t = ((unsigned __int128) a) * ((unsigned __int128) b);
+  *hi = (uint64_t) (t >> 64);
+  *lo = (uint64_t) t;
+#else
   uint32_t ah, al, bh, bl;
   uint64_t tah, tal, tbh, tbl;
   uint64_t hh, hl, lh, ll;
@@ -537,6 +678,7 @@ static inline void __multiply_digits(uint64_t *hi, uint64_t *lo,
   /* Write results back */
   *hi = h;
   *lo = l;
+#endif
 }
 
 /* hi * 2^64 + lo = a * b + c */
@@ -578,6 +720,101 @@ static inline void __multiplication_rectangular(uint64_t *p,
   p[i] = cin;
 }
 
+/* p = (a * b + c) mod 2^(64 * n)
+
+   Returns the digit that does not fit, i.e.
+
+   floor((a * b + c) / 2^(64 * n)).
+
+   a and p have size n, b and c are single digits. p may be the same
+   array as a.
+
+*/
+static inline uint64_t __mul_1_add_1(uint64_t *p,
+				     const uint64_t *a, size_t n,
+				     uint64_t b, uint64_t c) {
+  uint64_t cin, cout;
+  size_t i;
+
+  cin = c;
+  for (i=0;i<n;i++) {
+    __multiply_and_add(&cout, &p[i], a[i], b, cin);
+    cin = cout;
+  }
+  return cin;
+}
+
+/* p = (a * b) mod 2^(64 * n)
+
+   Returns the digit that does not fit, i.e.
+
+   floor(a * b / 2^(64 * n)).
+
+   a and p have size n, b is a single digit. p may be the same array
+   as a.
+
+*/
+uint64_t mul_1(uint64_t *p, const uint64_t *a, size_t n, uint64_t b) {
+  return __mul_1_add_1(p, a, n, b, (uint64_t) 0);
+}
+
+/* r = (r + a * b) mod 2^(64 * n)
+
+   Returns the digit that does not fit, i.e.
+
+   floor((r + a * b) / 2^(64 * n)).
+
+   a and r have size n, b is a single digit.
+
+*/
+static inline uint64_t __addmul_1(uint64_t *r, const uint64_t *a, size_t n,
+				  uint64_t b) {
+  uint64_t cin, hi, lo, t;
+  size_t i;
+
+  cin = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    /* hi * 2^64 + lo = a[i] * b + cin, where hi <= 2^64 - 2 */
+    __multiply_and_add(&hi, &lo, a[i], b, cin);
+    t = r[i] + lo;
+    r[i] = t;
+    cin = hi + ((uint64_t) (t < lo));
+  }
+  return cin;
+}
+
+/* p = a * b
+
+   a and b are on n >= 1 digits, p is on 2 * n digits.
+
+   Schoolbook multiplication, which is faster than Karatsuba for small
+   n.
+
+*/
+static inline void __multiplication_schoolbook(uint64_t *p,
+					       const uint64_t *a,
+					       const uint64_t *b,
+					       size_t n) {
+  size_t j;
+
+  p[n] = __mul_1_add_1(p, a, n, b[0], (uint64_t) 0);
+  for (j=1;j<n;j++) {
+    p[j + n] = __addmul_1(&p[j], a, n, b[j]);
+  }
+}
+
+/* Below 2^KARATSUBA_THRESHOLD_LOG digits, Karatsuba's recursion stops
+   and schoolbook multiplication is used.
+*/
+#define KARATSUBA_THRESHOLD_LOG ((unsigned int) 4)
+
+/* From 2^KARATSUBA_PARALLEL_THRESHOLD_LOG digits on, Karatsuba's
+   recursion forks two of its three sub-products as tasks for the
+   thread pool, if there is one. Below, a sub-product is too cheap to
+   be worth handing over to another thread.
+*/
+#define KARATSUBA_PARALLEL_THRESHOLD_LOG ((unsigned int) 9)
+
 static inline unsigned int __floor_log2_size(size_t x) {
   int k;
   size_t t;
@@ -615,6 +852,11 @@ static inline unsigned int __floor_log2_size(size_t x) {
    lo has size p and
    r has size q.
 
+   The sum must hold on q digits, but hi and mi may be given with more
+   digits than fit into r at their offsets: these extra digits are then
+   zero. This happens in Karatsuba, where the middle term is computed
+   on two digits more than it needs.
+
 */
 static inline  void __multiplication_helper_sum(uint64_t *r,
 						size_t q,
@@ -633,8 +875,12 @@ static inline  void __multiplication_helper_sum(uint64_t *r,
 
   */
   if (q < p) return;
-  if (q < (t + n + ((size_t) 1))) return;
-  if (q < (m + s)) return;
+  if (q < t) return;
+  if (q < s) return;
+
+  /* Clip hi and mi to what fits into r */
+  if (n > q - t) n = q - t;
+  if (m > q - s) m = q - s;
 
   /* Set r to zero. */
   __m_memset(r, 0, q, sizeof(*r));
@@ -648,7 +894,10 @@ static inline  void __multiplication_helper_sum(uint64_t *r,
     __fulladder(&cout, &r[i+t], r[i+t], mi[i], cin);
     cin = cout;
   }
-  r[i+t] = cin;
+  for (i+=t;(i<q) && (cin != ((uint64_t) 0));i++) {
+    __halfadder(&cout, &r[i], r[i], cin);
+    cin = cout;
+  }
 
   /* Add in hi */
   cin = (uint64_t) 0;
@@ -656,8 +905,22 @@ static inline  void __multiplication_helper_sum(uint64_t *r,
     __fulladder(&cout, &r[i+s], r[i+s], hi[i], cin);
     cin = cout;
   }  
+  for (i+=s;(i<q) && (cin != ((uint64_t) 0));i++) {
+    __halfadder(&cout, &r[i], r[i], cin);
+    cin = cout;
+  }
 }
 
+/* Arguments of a Karatsuba sub-product forked as a task */
+typedef struct {
+  uint64_t       *p;
+  const uint64_t *a;
+  const uint64_t *b;
+  unsigned int   k;
+} __karatsuba_task_t;
+
+static void __multiplication_square_karatsuba_task(void *arg);
+
 /* p = a * b
 
    a is on 2^k digits
@@ -669,6 +932,10 @@ static inline  void __multiplication_helper_sum(uint64_t *r,
 
    0 <= k <= 8 * sizeof(size_t) - 1.
 
+   The temporaries are taken from the current thread's scratch
+   memory. Above the parallel threshold, the sub-products t0 and t2
+   are forked as tasks while the current thread computes w.
+
 */
 static inline void __multiplication_square_karatsuba(uint64_t *p,
 						     const uint64_t *a,
@@ -689,6 +956,9 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
   uint64_t *t0p;
   uint64_t *w;
   int sign_s1, sign_s2;
+  thread_scratch_mark_t mark;
+  __karatsuba_task_t args0, args2;
+  thread_task_t task0, task2;
   
   /* Check for the base case */
   if (k == ((size_t) 0)) {
@@ -696,6 +966,13 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
     __multiply_digits(&p[1], &p[0], a[0], b[0]);
     return;
   }
+  if (k < KARATSUBA_THRESHOLD_LOG) {
+    /* Small case: a and b are on less than 2^KARATSUBA_THRESHOLD_LOG
+       digits 
+    */
+    __multiplication_schoolbook(p, a, b, ((size_t) 1) << k);
+    return;
+  }
 
   /* Here, k >= 1. 
 
@@ -706,10 +983,11 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
 
   /* Allocate memory for ah, al, bh, bl */
   n = ((size_t) 1) << kprime; /* n = 2^(k - 1) */
-  ah = __alloc_mem(n, sizeof(*ah));
-  al = __alloc_mem(n, sizeof(*al));
-  bh = __alloc_mem(n, sizeof(*bh));
-  bl = __alloc_mem(n, sizeof(*bl));
+  mark = thread_scratch_mark();
+  ah = thread_scratch_alloc(n, sizeof(*ah));
+  al = thread_scratch_alloc(n, sizeof(*al));
+  bh = thread_scratch_alloc(n, sizeof(*bh));
+  bl = thread_scratch_alloc(n, sizeof(*bl));
 
   /* Cut a into ah and al, b into bh and bl */
   __m_memcpy(al, a, n, sizeof(*al));
@@ -718,8 +996,8 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
   __m_memcpy(bh, &b[n], n, sizeof(*bh));
   
   /* Allocate memory for s1 and s2 */
-  s1 = __alloc_mem(n, sizeof(*s1));
-  s2 = __alloc_mem(n, sizeof(*s2));
+  s1 = thread_scratch_alloc(n, sizeof(*s1));
+  s2 = thread_scratch_alloc(n, sizeof(*s2));
   
   /* Compute 
 
@@ -744,17 +1022,30 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
   }
 
   /* Allocate memory for t0, t1, t2, w */
-  t0 = __alloc_mem(n, ((size_t) 2) * sizeof(*t0));
-  t1 = __alloc_mem(n + ((size_t) 1), ((size_t) 2) * sizeof(*t1));
-  t2 = __alloc_mem(n, ((size_t) 2) * sizeof(*t2));
-  w = __alloc_mem(n, ((size_t) 2) * sizeof(*w));
-  t0p = __alloc_mem(n + ((size_t) 1), ((size_t) 2) * sizeof(*t0p));
-  t2p = __alloc_mem(n + ((size_t) 1), ((size_t) 2) * sizeof(*t2p));
+  t0 = thread_scratch_alloc(n, ((size_t) 2) * sizeof(*t0));
+  t1 = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*t1));
+  t2 = thread_scratch_alloc(n, ((size_t) 2) * sizeof(*t2));
+  w = thread_scratch_alloc(n, ((size_t) 2) * sizeof(*w));
+  t0p = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*t0p));
+  t2p = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*t2p));
   
-  /* Execute the 3 recursive calls */
-  __multiplication_square_karatsuba(t0, al, bl, kprime);
-  __multiplication_square_karatsuba(t2, ah, bh, kprime);
-  __multiplication_square_karatsuba(w, s1, s2, kprime);
+  /* Execute the 3 recursive calls, forking two of them if the 
+     sub-products are large enough and there are several threads 
+  */
+  if ((k >= KARATSUBA_PARALLEL_THRESHOLD_LOG) &&
+      (utepnum_get_threads() > 1u)) {
+    args0.p = t0; args0.a = al; args0.b = bl; args0.k = kprime;
+    args2.p = t2; args2.a = ah; args2.b = bh; args2.k = kprime;
+    thread_pool_fork(&task0, __multiplication_square_karatsuba_task, &args0);
+    thread_pool_fork(&task2, __multiplication_square_karatsuba_task, &args2);
+    __multiplication_square_karatsuba(w, s1, s2, kprime);
+    thread_pool_join(&task2);
+    thread_pool_join(&task0);
+  } else {
+    __multiplication_square_karatsuba(t0, al, bl, kprime);
+    __multiplication_square_karatsuba(t2, ah, bh, kprime);
+    __multiplication_square_karatsuba(w, s1, s2, kprime);
+  }
 
   /* Deduce t1 out of w, t0, t2, sign_s1 and sign_s2 */
   __m_memset(t0p, 0, n + ((size_t) 1), ((size_t) 2) * sizeof(*t0p));
@@ -774,19 +1065,15 @@ static inline void __multiplication_square_karatsuba(uint64_t *p,
 			      t1, ((size_t) 2) * n + ((size_t) 2), n,
 			      t0, ((size_t) 2) * n);
   
-  /* Free the temporaries */
-  __free_mem(ah);
-  __free_mem(al);
-  __free_mem(bh);
-  __free_mem(bl);
-  __free_mem(s1);
-  __free_mem(s2);
-  __free_mem(t0);
-  __free_mem(t0p);
-  __free_mem(t1);
-  __free_mem(t2);
-  __free_mem(t2p);
-  __free_mem(w);
+  /* Release the temporaries */
+  thread_scratch_release(mark);
+}
+
+/* Runs a forked Karatsuba sub-product */
+static void __multiplication_square_karatsuba_task(void *arg) {
+  __karatsuba_task_t *t = (__karatsuba_task_t *) arg;
+
+  __multiplication_square_karatsuba(t->p, t->a, t->b, t->k);
 }
 
 /* Forward declaration */
@@ -817,14 +1104,16 @@ static inline void __multiplication_square_aux1(uint64_t *p,
   uint64_t *aa;
   uint64_t *bb;
   uint64_t *r;
+  thread_scratch_mark_t mark;
   
   /* Check the pre-condition */
   if (!(t > m)) return;
 
   /* Allocate memory */
-  aa = __alloc_mem(t, sizeof(*aa));
-  bb = __alloc_mem(t, sizeof(*bb));
-  r = __alloc_mem(t, ((size_t) 2) * sizeof(*r));
+  mark = thread_scratch_mark();
+  aa = thread_scratch_alloc(t, sizeof(*aa));
+  bb = thread_scratch_alloc(t, sizeof(*bb));
+  r = thread_scratch_alloc(t, ((size_t) 2) * sizeof(*r));
   
   /* Extend a and b to size t */
   __m_memcpy(aa, a, m, sizeof(*aa));
@@ -839,9 +1128,7 @@ static inline void __multiplication_square_aux1(uint64_t *p,
   __m_memcpy(p, r, (m + m), sizeof(*p));
 
   /* Free memory */
-  __free_mem(aa);
-  __free_mem(bb);
-  __free_mem(r);
+  thread_scratch_release(mark);
 }
 
 /* p = a * b
@@ -857,8 +1144,8 @@ static inline void __multiplication_square_aux1(uint64_t *p,
 
    The function works only for m > t.
 
-   On a 64 bit system, this function is essentially never needed. So
-   its performance can be pretty bad.
+   This is used when m is only a little greater than a power of 2, as
+   well as when m is too great to be extended to a power of 2.
 
 */
 static inline void __multiplication_square_aux2(uint64_t *p,
@@ -877,22 +1164,24 @@ static inline void __multiplication_square_aux2(uint64_t *p,
   uint64_t *hle; 
   uint64_t *lhe; 
   uint64_t *hllh; 
+  thread_scratch_mark_t mark;
   
   /* Check the pre-condition */
   if (!(m > t)) return;
 
   /* Allocate memory */
-  al = __alloc_mem(t, sizeof(*al));
-  ah = __alloc_mem(m - t, sizeof(*ah));
-  bl = __alloc_mem(t, sizeof(*bl));
-  bh = __alloc_mem(m - t, sizeof(*bh));
-  hh = __alloc_mem(m - t, ((size_t) 2) * sizeof(*hh));
-  hl = __alloc_mem(m, sizeof(*hl));
-  lh = __alloc_mem(m, sizeof(*lh));
-  ll = __alloc_mem(t, ((size_t) 2) * sizeof(*ll));
-  hle = __alloc_mem(m + ((size_t) 1), sizeof(*hle)); /* +1 may overflow */
-  lhe = __alloc_mem(m + ((size_t) 1), sizeof(*lhe)); /* +1 may overflow */
-  hllh = __alloc_mem(m + ((size_t) 1), sizeof(*hllh)); /* +1 may overflow */
+  mark = thread_scratch_mark();
+  al = thread_scratch_alloc(t, sizeof(*al));
+  ah = thread_scratch_alloc(m - t, sizeof(*ah));
+  bl = thread_scratch_alloc(t, sizeof(*bl));
+  bh = thread_scratch_alloc(m - t, sizeof(*bh));
+  hh = thread_scratch_alloc(m - t, ((size_t) 2) * sizeof(*hh));
+  hl = thread_scratch_alloc(m, sizeof(*hl));
+  lh = thread_scratch_alloc(m, sizeof(*lh));
+  ll = thread_scratch_alloc(t, ((size_t) 2) * sizeof(*ll));
+  hle = thread_scratch_alloc(m + ((size_t) 1), sizeof(*hle)); /* +1 may overflow */
+  lhe = thread_scratch_alloc(m + ((size_t) 1), sizeof(*lhe)); /* +1 may overflow */
+  hllh = thread_scratch_alloc(m + ((size_t) 1), sizeof(*hllh)); /* +1 may overflow */
   
   /* Cut 
 
@@ -929,17 +1218,7 @@ static inline void __multiplication_square_aux2(uint64_t *p,
 			      ll, t + t);
 
   /* Free memory */
-  __free_mem(al);
-  __free_mem(ah);
-  __free_mem(bl);
-  __free_mem(bh);
-  __free_mem(hh);
-  __free_mem(hl);
-  __free_mem(lh);
-  __free_mem(ll);
-  __free_mem(hle);
-  __free_mem(lhe);
-  __free_mem(hllh);
+  thread_scratch_release(mark);
 }
 
 /* p = a * b
@@ -994,8 +1273,13 @@ static inline void __multiplication_square(uint64_t *p,
 
   /* If t is less than T, we can compute 2 * t (and 4 * t) without
      overflowing. 
+
+     Extending a and b to 2 * t digits costs about three
+     multiplications on t digits. Cutting a and b at t digits costs one
+     multiplication on t digits plus the products involving the m - t
+     upper digits, which is cheaper as long as m - t is at most t / 2.
   */
-  if (t < T) {
+  if ((t < T) && ((m - t) > (t >> 1))) {
     /* We can compute tt = 2 * t, which is a power of 2 and that is
        greater than m.
 
@@ -1009,14 +1293,13 @@ static inline void __multiplication_square(uint64_t *p,
     return;
   }
 
-  /* Here m > t >= T and T is the largest power of 2 such 
-     that 2 * T holds on a size_t.
+  /* Here m > t and m is close to t, or t >= T.
 
      We need to cut a and b into smaller parts. We do so in 
      a helper function.
 
   */
-  __multiplication_square_aux2(p, a, b, m, T);
+  __multiplication_square_aux2(p, a, b, m, t);
 }
 
 /* p = a * b 
@@ -1028,6 +1311,8 @@ static inline void __multiplication_square(uint64_t *p,
    +  2 <= m
    +  m < n
 
+   p is on m + n digits.
+
 */
 static inline void __multiplication_aux(uint64_t *p,
 					const uint64_t *a,
@@ -1035,31 +1320,49 @@ static inline void __multiplication_aux(uint64_t *p,
 					const uint64_t *b,
 					size_t n) {
   uint64_t *t;
-  uint64_t *r;
+  uint64_t cin, cout;
+  size_t i, j, k;
+  thread_scratch_mark_t mark;
   
   /* Handle preconditions */
   if (!(((size_t) 2) <= m)) return;
   if (!(m < n)) return;
 
   /* Allocate memory */
-  t = __alloc_mem(n, sizeof(*t));
-  r = __alloc_mem(n, ((size_t) 2) * sizeof(*r));
+  mark = thread_scratch_mark();
+  t = thread_scratch_alloc(m, ((size_t) 2) * sizeof(*t));
   
-  /* Copy a into t */
-  __m_memcpy(t, a, m, sizeof(*t));
+  /* Set p to zero */
+  __m_memset(p, 0, (m + n), sizeof(*p));
+
+  /* Cut b into blocks of m digits, multiply each of them by a and
+     add the products into p. 
 
-  /* Set upper part of t to zero */
-  __m_memset(&t[m], 0, (n - m), sizeof(*t));
+     This costs about n / m multiplications on m digits, where
+     extending a to n digits would cost a multiplication on n digits.
 
-  /* Now t and b have the same size n */
-  __multiplication_square(r, t, b, n);
+  */
+  for (i=0;i<n;i+=k) {
+    k = n - i;
+    if (k > m) k = m;
+
+    /* t = a * b[i .. i + k - 1], on m + k digits */
+    multiplication(t, a, m, &b[i], k);
 
-  /* Copy low part of r into p */
-  __m_memcpy(p, r, (m + n), sizeof(*p));
+    /* p = p + t * 2^(64 * i) */
+    cin = (uint64_t) 0;
+    for (j=0;j<m+k;j++) {
+      __fulladder(&cout, &p[i + j], p[i + j], t[j], cin);
+      cin = cout;
+    }
+    for (j+=i;(j<m+n) && (cin != ((uint64_t) 0));j++) {
+      __halfadder(&cout, &p[j], p[j], cin);
+      cin = cout;
+    }
+  }
 
   /* Free memory */
-  __free_mem(t);
-  __free_mem(r);
+  thread_scratch_release(mark);
 }
 
 /* p = a * b
@@ -1120,33 +1423,97 @@ void multiplication(uint64_t *p,
 }
 
 
-/* Set r = floor(1/10 * 2^(64 * n) */
-static inline void __one_tenth(uint64_t *r, size_t n) {
-  size_t i;
-  
-  /* If n is zero, do nothing */
-  if (n == ((size_t) 0)) return;
+/* Computes q and r such that 
 
-  /* Set high-level word 
+   hi * 2^64 + lo = q * d + r
 
-     floor(1/10 * 2^64) = 0x1999999999999999
+   with 0 <= r < d.
 
+   Works only for hi < d, which guarantees that q holds on a digit.
+
+*/
+static inline void __divide_digits(uint64_t *q, uint64_t *r,
+				   uint64_t hi, uint64_t lo, uint64_t d) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 t;
+
+  t = (((unsigned __int128) hi) << 64) | ((unsigned __int128) lo);
+  *q = (uint64_t) (t / ((unsigned __int128) d));
+  *r = (uint64_t) (t % ((unsigned __int128) d));
+#else
+  uint64_t b, vn1, vn0, un32, un21, un10, un1, un0, q1, q0, rhat, dd;
+  unsigned int s;
+
+  /* We do a schoolbook division of a 4 half-digit number by a 
+     2 half-digit number, after normalizing d so that its most
+     significant bit is set. This is Knuth's algorithm D on 32 bit
+     half-digits, which is exact as long as hi < d.
   */
-  r[n - ((size_t) 1)] = (uint64_t) 0x1999999999999999ull;
-  
-  /* If n is one, we are done */
-  if (n == ((size_t) 1)) return;
+  b = ((uint64_t) 1) << 32;
+  s = (unsigned int) __leading_zeros_uint64(d);
+  dd = d << s;
+  vn1 = dd >> 32;
+  vn0 = dd & (b - ((uint64_t) 1));
+  if (s == 0u) {
+    un32 = hi;
+  } else {
+    un32 = (hi << s) | (lo >> (64u - s));
+  }
+  un10 = lo << s;
+  un1 = un10 >> 32;
+  un0 = un10 & (b - ((uint64_t) 1));
+
+  /* First half-digit of the quotient */
+  q1 = un32 / vn1;
+  rhat = un32 - q1 * vn1;
+  while ((q1 >= b) || (q1 * vn0 > b * rhat + un1)) {
+    q1--;
+    rhat += vn1;
+    if (rhat >= b) break;
+  }
+  un21 = un32 * b + un1 - q1 * dd;
+
+  /* Second half-digit of the quotient */
+  q0 = un21 / vn1;
+  rhat = un21 - q0 * vn1;
+  while ((q0 >= b) || (q0 * vn0 > b * rhat + un0)) {
+    q0--;
+    rhat += vn1;
+    if (rhat >= b) break;
+  }
+
+  *r = (un21 * b + un0 - q0 * dd) >> s;
+  *q = q1 * b + q0;
+#endif
+}
 
-  /* Here n is at least 2. 
+/* Set 
 
-     Set the low level words.
+   q = floor(a / d)
 
-     floor(1/10 * 2^(64 * n)) mod 2^64 = 0x9999999999999999
+   and return 
 
-  */
-  for (i=0;i<n-((size_t) 1);i++) {
-    r[i] = (uint64_t) 0x9999999999999999ull;
+   r = a - d * q.
+
+   The size of q and a is n. q may be the same array as a, or NULL if
+   only the remainder is needed.
+
+   Does nothing and returns 0 if d is zero.
+
+*/
+uint64_t divrem_1(uint64_t *q, const uint64_t *a, size_t n, uint64_t d) {
+  uint64_t r, qq;
+  size_t i, k;
+
+  if (n == ((size_t) 0)) return (uint64_t) 0;
+  if (d == ((uint64_t) 0)) return (uint64_t) 0;
+
+  r = (uint64_t) 0;
+  for (i=n-((size_t) 1),k=n;k>((size_t) 0);k--,i--) {
+    __divide_digits(&qq, &r, r, a[i], d);
+    if (q != NULL) q[i] = qq;
   }
+  return r;
 }
 
 /* Set 
@@ -1163,229 +1530,2668 @@ static inline void __one_tenth(uint64_t *r, size_t n) {
 
 */
 void divide_by_ten(uint64_t *q, unsigned int *r, const uint64_t *a, size_t n) {
-  uint64_t *one_tenth;
-  uint64_t *nine;
-  uint64_t *t;
-  uint64_t *rr;
-  uint64_t *c;
-  uint64_t *d;
-  uint64_t *e;
-  uint64_t one;
-  int okay;
-  
   /* If the size is zero, do nothing */
   if (n == ((size_t) 0)) return;
 
-  /* Set one to 1 */
-  one = (uint64_t) 1;
-  
-  /* Allocate memory for one_tenth on n+2 digits */
-  one_tenth = __alloc_mem(n + ((size_t) 2), sizeof(*one_tenth));
+  *r = (unsigned int) divrem_1(q, a, n, (uint64_t) 10);
+}
 
-  /* Allocate memory for nine on n digits */
-  nine = __alloc_mem(n, sizeof(*nine));
-  
-  /* Allocate memory for a temporary on n digits */
-  rr = __alloc_mem(n, sizeof(*rr));
+/* r = (r - a * b) mod 2^(64 * n)
 
-  /* Allocate memory for a temporary on n digits */
-  c = __alloc_mem(n, sizeof(*c));
+   Returns the digit that has been borrowed from above, i.e. the value
+   w such that
 
-  /* Allocate memory for a temporary on n digits */
-  d = __alloc_mem(n, sizeof(*d));
+   r - a * b = r' - w * 2^(64 * n).
 
-  /* Allocate memory for a temporary on n digits */
-  e = __alloc_mem(n, sizeof(*e));
-  
-  /* Allocate memory for a temporary on 2 * n + 2 digits */
-  t = __alloc_mem(n + ((size_t) 1), ((size_t) 2) * sizeof(*t));
+   a and r have size n, b is a single digit.
 
-  /* Load one_tenth = floor(1/10 * 2^(64 * (n + 2))) */
-  __one_tenth(one_tenth, n + ((size_t) 2));
+*/
+static inline uint64_t __submul_1(uint64_t *r, const uint64_t *a, size_t n,
+				  uint64_t b) {
+  uint64_t cin, hi, lo, t;
+  size_t i;
 
-  /* Load nine = 9 */
-  __m_memset(nine, 0, n, sizeof(*nine));
-  nine[0] = (uint64_t) 9;
+  cin = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    /* hi * 2^64 + lo = a[i] * b + cin, where hi <= 2^64 - 2 */
+    __multiply_and_add(&hi, &lo, a[i], b, cin);
+    t = r[i];
+    r[i] = t - lo;
+    cin = hi + ((uint64_t) (t < lo));
+  }
+  return cin;
+}
 
-  /* Multiply a with floor(1/10 * 2^(64 * (n + 2))) */
-  multiplication(t, a, n, one_tenth, n + ((size_t) 2));
-  
-  /* Divide the temporary by 2^(64 * (n + 2)) */
-  __m_memcpy(q, &t[n + ((size_t) 2)], n, sizeof(*q));
+/* Below this number of digits in the divisor, we use schoolbook
+   division. Above, we use a division based on a Newton-computed
+   inverse of the divisor.
+*/
+#define DIVISION_NEWTON_THRESHOLD ((size_t) 48)
 
-  /* Compute, check and correct the remainder */
-  okay = 0;
-  do {
-    /* Multiply q by 10, yielding c */
-    __m_memcpy(d, q, n, sizeof(*c));
-    __m_memcpy(e, q, n, sizeof(*d));
-    shift_left(d, n, 3);
-    shift_left(e, n, 1);
-    addition(c, d, n, e, n);
+/* Schoolbook division (Knuth's algorithm D)
 
-    /* We need to compute 
+   u has nq + n digits, d has n >= 2 digits. The most significant bit
+   of d must be set and the n most significant digits of u must form
+   a number less than d.
 
-       rr = a - c
+   On return, q, which has nq digits, holds floor(u / d) and the n
+   least significant digits of u hold the remainder u - q * d. The
+   other digits of u are zero.
 
-       We start by checking if c > a.
+*/
+static void __division_basecase(uint64_t *q, uint64_t *u, size_t nq,
+				const uint64_t *d, size_t n) {
+  uint64_t dh, dl, u2, u1, u0, qhat, rhat, ph, pl, w, c;
+  size_t j, l;
+  int rhat_overflow;
+
+  dh = d[n - ((size_t) 1)];
+  dl = d[n - ((size_t) 2)];
+  for (l=nq,j=nq-((size_t) 1);l>((size_t) 0);l--,j--) {
+    /* The current partial remainder is u[j .. j + n], whose n most
+       significant digits are less than d. We estimate the quotient 
+       digit from its three most significant digits.
+    */
+    u2 = u[j + n];
+    u1 = u[j + n - ((size_t) 1)];
+    u0 = u[j + n - ((size_t) 2)];
+    if (u2 >= dh) {
+      /* Here u2 = dh. The quotient digit is at most 2^64 - 1. */
+      qhat = ~((uint64_t) 0);
+      rhat = u1 + dh;
+      rhat_overflow = (rhat < u1);
+    } else {
+      __divide_digits(&qhat, &rhat, u2, u1, dh);
+      rhat_overflow = 0;
+    }
 
+    /* The estimate is at most 2 too great. Correct it using the second
+       digit of d, which leaves it at most 1 too great.
     */
-    if (comparison(c, a, n) > 0) {
-      /* c > a. This means 10 * q > a.
+    while (!rhat_overflow) {
+      __multiply_digits(&ph, &pl, qhat, dl);
+      if ((ph < rhat) || ((ph == rhat) && (pl <= u0))) break;
+      qhat--;
+      rhat += dh;
+      rhat_overflow = (rhat < dh);
+    }
 
-	 This means q is too great. 
+    /* u[j .. j + n] -= qhat * d */
+    w = __submul_1(&u[j], d, n, qhat);
+    if (u[j + n] < w) {
+      /* The estimate was 1 too great: add d back in */
+      qhat--;
+      c = addlsh(&u[j], &u[j], d, n, 0u);
+      u[j + n] = u[j + n] - w + c;
+    } else {
+      u[j + n] -= w;
+    }
+    q[j] = qhat;
+  }
+}
 
-	 Subtract 1 from q.
+/* Computes the inverse of a divisor
 
-      */
-      subtraction(c, q, n, &one, (size_t) 1);
-      __m_memcpy(q, c, n, sizeof(*q));
-      okay = 0;
-    } else {
-      /* Here, c <= a. Subtract c from a. */
-      subtraction(rr, a, n, c, n);
+   d has n >= 1 digits and its most significant bit is set.
 
-      /* We know that 0 <= rr.
+   Sets x, which has n digits, to 
 
-	 We need to check if rr <= 9.
+   floor((2^(128 * n) - 1) / d) - 2^(64 * n),
 
-      */
-      if (comparison(rr, nine, n) > 0) {
-	/* Here rr = a - c = a - 10 * q > 9 
-	   
-	   This means that q is too small.
+   which holds on n digits as 2^(64 * n - 1) <= d < 2^(64 * n).
 
-	   Add 1 to q.
+   For small n, this is a schoolbook division. For greater n, we
+   compute the inverse of the upper half of d recursively and perform
+   one Newton iteration
 
-	*/
-	addition(c, q, n, &one, (size_t) 1);
-	__m_memcpy(q, c, n, sizeof(*q));
-	okay = 0;
-      } else {
-	/* Here, we know that 
+   x' = x + x * (2^(128 * n) - d * x) / 2^(128 * n),
 
-	   0 <= rr <= 9.
+   which doubles the number of correct digits. The Newton iterate is
+   then corrected to the exact value, which takes a couple of steps at
+   most.
 
-	   The quotient is hence correct.
+*/
+static void __invert(uint64_t *x, const uint64_t *d, size_t n) {
+  uint64_t *u;
+  uint64_t *xx;
+  uint64_t *t;
+  uint64_t *e;
+  uint64_t *p;
+  uint64_t one;
+  size_t h, l, ne, i;
+  int neg;
+  thread_scratch_mark_t mark;
 
-	*/
-	okay = 1;
-      }
-    }
-  } while (!okay);
-
-  /* Here, q is already set. Extract r. */
-  *r = (unsigned int) rr[0];
-
-  /* Deallocate temporaries */
-  __free_mem(one_tenth);
-  __free_mem(nine);
-  __free_mem(rr);
-  __free_mem(c);
-  __free_mem(d);
-  __free_mem(e);
-  __free_mem(t);
-}
+  if (n < DIVISION_NEWTON_THRESHOLD) {
+    /* Schoolbook case 
 
-/* Returns 1 if a is zero. Returns 0 otherwise */
-int is_zero(const uint64_t *a, size_t n) {
-  size_t i;
-  
-  /* Consider empty values to be zero. */
-  if (n == ((size_t) 0)) return 1;
+       (2^(128 * n) - 1) / d = 2^(64 * n) + 
+          ((2^(64 * n) - 1 - d) * 2^(64 * n) + 2^(64 * n) - 1) / d
 
-  /* Check all digits */
-  for (i=0;i<n;i++) {
-    if (a[i] != ((uint64_t) 0)) return 0;
+       The upper digits of the numerator on the right, ~d, are less 
+       than d.
+    */
+    if (n == ((size_t) 1)) {
+      __divide_digits(&x[0], &one, ~d[0], ~((uint64_t) 0), d[0]);
+      return;
+    }
+    mark = thread_scratch_mark();
+    u = thread_scratch_alloc(n, ((size_t) 2) * sizeof(*u));
+    for (i=0;i<n;i++) {
+      u[i] = ~((uint64_t) 0);
+      u[i + n] = ~d[i];
+    }
+    __division_basecase(x, u, n, d, n);
+    thread_scratch_release(mark);
+    return;
   }
 
-  /* We survived the loop. Everything is zero. */
-  return 1;
-}
+  /* Here n is great enough for Newton's iteration 
 
-/* str becomes the decimal string corresponding to a.
+     Let h be the number of upper digits we invert recursively and l
+     the number of the lower digits.
 
-   str needs to have sufficient length.
+  */
+  h = (n + ((size_t) 1)) >> 1;
+  l = n - h;
 
-*/
+  /* Allocate memory 
+
+     xx, the current iterate, has n + 1 digits.
+     t and e have 2 * n + 1 digits.
+     p has n + 1 + 2 * n digits.
+
+  */
+  mark = thread_scratch_mark();
+  xx = thread_scratch_alloc(n + ((size_t) 1), sizeof(*xx));
+  t = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*t));
+  e = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*e));
+  p = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 3) * sizeof(*p));
+
+  /* xx = (2^(64 * h) + inverse of upper h digits of d) * 2^(64 * l) */
+  __m_memset(xx, 0, l, sizeof(*xx));
+  __invert(&xx[l], &d[l], h);
+  xx[n] = (uint64_t) 1;
+
+  /* t = d * xx */
+  multiplication(t, d, n, xx, n + ((size_t) 1));
+
+  /* e = |2^(128 * n) - t|, which is small */
+  if (t[((size_t) 2) * n] == ((uint64_t) 0)) {
+    neg = 0;
+    __m_memset(e, 0, ((size_t) 2) * n, sizeof(*e));
+    subtraction(e, e, ((size_t) 2) * n, t, ((size_t) 2) * n);
+  } else {
+    neg = 1;
+    __m_memcpy(e, t, ((size_t) 2) * n, sizeof(*e));
+  }
+  for (ne=((size_t) 2)*n;(ne>((size_t) 0)) && (e[ne - ((size_t) 1)] == ((uint64_t) 0));ne--);
+
+  /* xx = xx +/- floor(xx * e / 2^(128 * n)) */
+  if (ne > ((size_t) 0)) {
+    multiplication(p, xx, n + ((size_t) 1), e, ne);
+    if (ne + ((size_t) 1) > n) {
+      if (neg) {
+	subtraction(xx, xx, n + ((size_t) 1),
+		    &p[((size_t) 2) * n], ne + ((size_t) 1) - n);
+      } else {
+	addition(xx, xx, n + ((size_t) 1),
+		 &p[((size_t) 2) * n], ne + ((size_t) 1) - n);
+      }
+    }
+  }
+
+  /* Correct xx such that 
+
+     d * xx <= 2^(128 * n) - 1 < d * (xx + 1)
+
+  */
+  one = (uint64_t) 1;
+  multiplication(t, d, n, xx, n + ((size_t) 1));
+  while (t[((size_t) 2) * n] != ((uint64_t) 0)) {
+    subtraction(xx, xx, n + ((size_t) 1), &one, (size_t) 1);
+    subtraction(t, t, ((size_t) 2) * n + ((size_t) 1), d, n);
+  }
+  for (;;) {
+    addition(e, t, ((size_t) 2) * n + ((size_t) 1), d, n);
+    if (e[((size_t) 2) * n] != ((uint64_t) 0)) break;
+    __m_memcpy(t, e, ((size_t) 2) * n + ((size_t) 1), sizeof(*t));
+    addition(xx, xx, n + ((size_t) 1), &one, (size_t) 1);
+  }
+
+  /* Here xx = 2^(64 * n) + x */
+  __m_memcpy(x, xx, n, sizeof(*x));
+
+  thread_scratch_release(mark);
+}
+
+/* Division with a precomputed inverse (Barrett's algorithm)
+
+   Same interface as __division_basecase, with the additional inverse
+   x of d as computed by __invert.
+
+   The quotient is computed by blocks of n digits. For each block, the
+   partial remainder U has at most 2 * n digits and is less than 
+   d * 2^(64 * n). The quotient block is estimated as
+
+   floor(floor(U / 2^(64 * (n - 1))) * (2^(64 * n) + x) / 2^(64 * (n + 1)))
+
+   which is at most 3 below the actual quotient block.
+
+*/
+static void __division_preinv(uint64_t *q, uint64_t *u, size_t nq,
+			      const uint64_t *d, size_t n,
+			      const uint64_t *x) {
+  uint64_t *v;
+  uint64_t *p;
+  uint64_t *t;
+  uint64_t one, c;
+  size_t j, k;
+  thread_scratch_mark_t mark;
+
+  /* Allocate memory */
+  mark = thread_scratch_mark();
+  v = thread_scratch_alloc(n + ((size_t) 1), sizeof(*v));
+  p = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*p));
+  t = thread_scratch_alloc(n + ((size_t) 1), ((size_t) 2) * sizeof(*t));
+
+  /* v = 2^(64 * n) + x */
+  __m_memcpy(v, x, n, sizeof(*v));
+  v[n] = (uint64_t) 1;
+
+  one = (uint64_t) 1;
+  for (j=nq;j>((size_t) 0);) {
+    /* Next block of k quotient digits */
+    k = (j < n) ? j : n;
+    j -= k;
+
+    /* p = floor(U / 2^(64 * (n - 1))) * v, U = u[j .. j + n + k - 1] */
+    multiplication(p, &u[j + n - ((size_t) 1)], k + ((size_t) 1),
+		   v, n + ((size_t) 1));
+
+    /* The estimate is p[n + 1 .. n + k], t = estimate * d */
+    multiplication(t, &p[n + ((size_t) 1)], k, d, n);
+
+    /* U = U - estimate * d, which is less than 4 * d */
+    subtraction(&u[j], &u[j], n + k, t, n + k);
+    __m_memcpy(&q[j], &p[n + ((size_t) 1)], k, sizeof(*q));
+
+    /* Correct the estimate */
+    while ((u[j + n] != ((uint64_t) 0)) ||
+	   (comparison(&u[j], d, n) >= 0)) {
+      c = sublsh(&u[j], &u[j], d, n, 0u);
+      u[j + n] -= c;
+      addition(&q[j], &q[j], k, &one, (size_t) 1);
+    }
+  }
+
+  thread_scratch_release(mark);
+}
+
+/* Division of normalized operands
+
+   Same interface as __division_basecase. x is the inverse of d as
+   computed by __invert, or NULL. It is only used for great n.
+
+*/
+static void __division_normalized(uint64_t *q, uint64_t *u, size_t nq,
+				  const uint64_t *d, size_t n,
+				  const uint64_t *x) {
+  uint64_t *xx;
+  thread_scratch_mark_t mark;
+
+  if ((n < DIVISION_NEWTON_THRESHOLD) || (nq < DIVISION_NEWTON_THRESHOLD)) {
+    __division_basecase(q, u, nq, d, n);
+    return;
+  }
+  if (x != NULL) {
+    __division_preinv(q, u, nq, d, n, x);
+    return;
+  }
+  mark = thread_scratch_mark();
+  xx = thread_scratch_alloc(n, sizeof(*xx));
+  __invert(xx, d, n);
+  __division_preinv(q, u, nq, d, n, xx);
+  thread_scratch_release(mark);
+}
+
+/* Computes q = floor(a / d) and r = a - q * d
+
+   a has m digits. d has n >= 2 digits, of which the most significant
+   one is not zero. s is the number of leading zeros of d and dn is 
+   d shifted left by s bits. x is the inverse of dn or NULL.
+
+   q has m + 1 - n digits and r has n digits. Both may be NULL if not
+   needed. Works only for m >= n.
+
+*/
+static void __division_qr(uint64_t *q, uint64_t *r,
+			  const uint64_t *a, size_t m,
+			  const uint64_t *dn, size_t n, unsigned int s,
+			  const uint64_t *x) {
+  uint64_t *u;
+  uint64_t *qq;
+  size_t nq;
+  thread_scratch_mark_t mark;
+
+  /* Shift a the same way d has been */
+  nq = m + ((size_t) 1) - n;
+  mark = thread_scratch_mark();
+  u = thread_scratch_alloc(m + ((size_t) 1), sizeof(*u));
+  u[m] = lshift(u, a, m, s);
+  if (q == NULL) {
+    qq = thread_scratch_alloc(nq, sizeof(*qq));
+  } else {
+    qq = q;
+  }
+
+  /* The top digit of u is less than 2^s <= the top digit of dn, so the 
+     preconditions of the division are satisfied.
+  */
+  __division_normalized(qq, u, nq, dn, n, x);
+
+  /* The remainder has been shifted as well */
+  if (r != NULL) {
+    rshift(r, u, n, s);
+  }
+
+  thread_scratch_release(mark);
+}
+
+/* Set 
+
+   q = floor(a / b)
+
+   and 
+
+   r = a - b * q
+
+   where a has m digits and b has n digits. q has m digits and r has 
+   n digits. Any of q and r may be NULL if it is not needed.
+
+   Returns 0 on success and -1 if b is zero, in which case q and r 
+   are not touched.
+
+*/
+int division(uint64_t *q, uint64_t *r,
+	     const uint64_t *a, size_t m,
+	     const uint64_t *b, size_t n) {
+  uint64_t *dn;
+  uint64_t rr;
+  unsigned int s;
+  size_t nb;
+  thread_scratch_mark_t mark;
+
+  /* Get the number of significant digits in b */
+  for (nb=n;(nb>((size_t) 0)) && (b[nb - ((size_t) 1)] == ((uint64_t) 0));nb--);
+  if (nb == ((size_t) 0)) return -1;
+
+  /* If a is shorter than b, the quotient is zero */
+  if (m < nb) {
+    if (q != NULL) __m_memset(q, 0, m, sizeof(*q));
+    if (r != NULL) {
+      __m_memset(r, 0, n, sizeof(*r));
+      __m_memcpy(r, a, m, sizeof(*r));
+    }
+    return 0;
+  }
+
+  /* Division by a single digit */
+  if (nb == ((size_t) 1)) {
+    rr = divrem_1(q, a, m, b[0]);
+    if (r != NULL) {
+      __m_memset(r, 0, n, sizeof(*r));
+      r[0] = rr;
+    }
+    return 0;
+  }
+
+  /* General case: normalize the divisor */
+  s = (unsigned int) __leading_zeros_uint64(b[nb - ((size_t) 1)]);
+  mark = thread_scratch_mark();
+  dn = thread_scratch_alloc(nb, sizeof(*dn));
+  lshift(dn, b, nb, s);
+  if (q != NULL) __m_memset(q, 0, m, sizeof(*q));
+  if (r != NULL) __m_memset(r, 0, n, sizeof(*r));
+  __division_qr(q, r, a, m, dn, nb, s, NULL);
+  thread_scratch_release(mark);
+
+  return 0;
+}
+
+/* Returns 1 if a is zero. Returns 0 otherwise */
+int is_zero(const uint64_t *a, size_t n) {
+  size_t i;
+  
+  /* Consider empty values to be zero. */
+  if (n == ((size_t) 0)) return 1;
+
+  /* Check all digits */
+  for (i=0;i<n;i++) {
+    if (a[i] != ((uint64_t) 0)) return 0;
+  }
+
+  /* We survived the loop. Everything is zero. */
+  return 1;
+}
+
+/* Number of decimal digits that always hold on a 64 bit digit */
+#define DECIMAL_CHUNK_DIGITS ((size_t) 19)
+
+/* 10^19, the greatest power of 10 that holds on a 64 bit digit */
+#define DECIMAL_CHUNK_BASE ((uint64_t) 10000000000000000000ull)
+
+/* Character-level kernels for decimal conversion
+
+   Checking that characters are decimal digits, turning 19 decimal
+   characters into a chunk value and turning chunk values back into 19
+   decimal characters are done by kernels that come in several
+   variants: a portable scalar one, and SSE4.1 and AVX2 ones on x86
+   processors that support them. The variant is chosen once, on first
+   use, by __decimal_kernels.
+
+   The kernels work on chunks of 19 characters, which hold on a 64 bit
+   digit. As 16 characters fit into an SSE register, a chunk is handled
+   as 3 characters done in scalar and 16 done in vector code. An AVX2
+   register holds the 16 vector characters of two consecutive chunks,
+   which is why the AVX2 kernels handle chunks by pairs.
+
+*/
+typedef struct {
+  /* Returns 0 if the len characters at str are all decimal digits,
+     -1 otherwise.
+  */
+  int (*check)(const char *str, size_t len);
+
+  /* Sets c[i] to the value of the 19 decimal characters starting at
+     str + 19 * i, for i = 0 .. count - 1. The characters must have
+     been checked.
+  */
+  void (*parse)(uint64_t *c, const char *str, size_t count);
+
+  /* Writes the values c[i] < 10^19 to the 19 decimal characters
+     starting at str + 19 * i, including leading zeros, for 
+     i = 0 .. count - 1.
+  */
+  void (*format)(char *str, const uint64_t *c, size_t count);
+} __decimal_kernels_t;
+
+/* Returns the value of the len decimal digits starting at str.
+
+   The digits must have been checked before and len must be at most
+   19.
+
+*/
+static inline uint64_t __decimal_chunk_value(const char *str, size_t len) {
+  uint64_t res;
+  size_t i;
+
+  res = (uint64_t) 0;
+  for (i=0;i<len;i++) {
+    res = res * ((uint64_t) 10) + ((uint64_t) (((int) str[i]) - ((int) '0')));
+  }
+  return res;
+}
+
+/* Returns 10^len, for len between 0 and 19. */
+static inline uint64_t __decimal_chunk_power(size_t len) {
+  uint64_t res;
+  size_t i;
+
+  res = (uint64_t) 1;
+  for (i=0;i<len;i++) {
+    res *= (uint64_t) 10;
+  }
+  return res;
+}
+
+/* Writes the len least significant decimal digits of the chunk c,
+   including leading zeros, to str.
+*/
+static inline void __format_decimal_chunk(char *str, uint64_t c, size_t len) {
+  size_t i;
+
+  for (i=len;i>((size_t) 0);i--) {
+    str[i - ((size_t) 1)] = (char) (((int) (c % ((uint64_t) 10))) + ((int) '0'));
+    c /= (uint64_t) 10;
+  }
+}
+
+/* Scalar kernels */
+static int __decimal_check_scalar(const char *str, size_t len) {
+  size_t i;
+
+  for (i=0;i<len;i++) {
+    if (!(('0' <= str[i]) &&
+	  (str[i] <= '9'))) return -1;
+  }
+  return 0;
+}
+
+static void __decimal_parse_scalar(uint64_t *c, const char *str, size_t count) {
+  size_t i;
+
+  for (i=0;i<count;i++) {
+    c[i] = __decimal_chunk_value(&str[i * DECIMAL_CHUNK_DIGITS], DECIMAL_CHUNK_DIGITS);
+  }
+}
+
+static void __decimal_format_scalar(char *str, const uint64_t *c, size_t count) {
+  size_t i;
+
+  for (i=0;i<count;i++) {
+    __format_decimal_chunk(&str[i * DECIMAL_CHUNK_DIGITS], c[i], DECIMAL_CHUNK_DIGITS);
+  }
+}
+
+static const __decimal_kernels_t __decimal_kernels_scalar = {
+  __decimal_check_scalar,
+  __decimal_parse_scalar,
+  __decimal_format_scalar
+};
+
+#if defined(DECIMAL_KERNELS_X86)
+
+/* Vector kernels
+
+   Parsing 16 characters d0 .. d15, most significant first, goes by
+   pairwise multiply-adds: first d0 * 10 + d1 etc. on 16 bits, then
+   (d0 d1) * 100 + (d2 d3) etc. on 32 bits, then, after packing back to
+   16 bits, (d0 .. d3) * 10^4 + (d4 .. d7) on 32 bits. This yields two
+   values of 8 digits each.
+
+   Formatting a value v < 10^8 goes the other way, without any
+   division instructions: v is cut into v = abcd * 10^4 + efgh by a
+   multiplication with a scaled reciprocal of 10^4. Both halves are
+   spread over 4 lanes of 16 bits, where they are divided by 10^3, 
+   10^2, 10^1 and 10^0 by multiplications with scaled reciprocals, 
+   yielding a, ab, abc, abcd. Subtracting 10 times the neighbouring
+   lane gives the individual digits.
+
+*/
+
+/* Multipliers for the multiply-add steps of parsing */
+#define DECIMAL_PARSE_M1 1,10,1,10,1,10,1,10,1,10,1,10,1,10,1,10
+#define DECIMAL_PARSE_M2 1,100,1,100,1,100,1,100
+#define DECIMAL_PARSE_M3 1,10000,1,10000,1,10000,1,10000
+
+/* Scaled reciprocals of 10^4 (on 32 bits, shifted by 45 bits) and of
+   10^3, 10^2, 10^1, 10^0 (on 16 bits, followed by a second shift
+   multiplication)
+*/
+#define DECIMAL_FORMAT_DIV10000 ((int) 0xd1b71759)
+#define DECIMAL_FORMAT_DIVPOWERS 8389, 5243, 13108, (short) 32768, 8389, 5243, 13108, (short) 32768
+#define DECIMAL_FORMAT_SHIFTPOWERS (1 << (16 - (23 + 2 - 16))), (1 << (16 - (19 + 2 - 16))), (1 << (16 - 1 - 2)), (short) (1 << 15), (1 << (16 - (23 + 2 - 16))), (1 << (16 - (19 + 2 - 16))), (1 << (16 - 1 - 2)), (short) (1 << 15)
+
+/* Returns the value of the 16 checked decimal characters at str */
+__attribute__ ((target ("sse4.1")))
+static inline uint64_t __decimal_parse16_sse41(const char *str) {
+  __m128i v;
+  uint64_t hi, lo;
+
+  v = _mm_loadu_si128((const __m128i *) str);
+  v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+  v = _mm_maddubs_epi16(v, _mm_set_epi8(DECIMAL_PARSE_M1));
+  v = _mm_madd_epi16(v, _mm_set_epi16(DECIMAL_PARSE_M2));
+  v = _mm_packus_epi32(v, v);
+  v = _mm_madd_epi16(v, _mm_set_epi16(DECIMAL_PARSE_M3));
+  hi = (uint64_t) (uint32_t) _mm_cvtsi128_si32(v);
+  lo = (uint64_t) (uint32_t) _mm_extract_epi32(v, 1);
+  return hi * ((uint64_t) 100000000) + lo;
+}
+
+/* Returns the 8 digits of v < 10^8 in the 16 bit lanes of the result,
+   most significant first
+*/
+__attribute__ ((target ("sse4.1")))
+static inline __m128i __decimal_format8_sse41(uint32_t v) {
+  __m128i x, abcd, efgh, t;
+
+  x = _mm_cvtsi32_si128((int) v);
+  abcd = _mm_srli_epi64(_mm_mul_epu32(x, _mm_set1_epi32(DECIMAL_FORMAT_DIV10000)), 45);
+  efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+  t = _mm_unpacklo_epi16(abcd, efgh);
+  t = _mm_slli_epi64(t, 2);
+  t = _mm_unpacklo_epi16(t, t);
+  t = _mm_unpacklo_epi32(t, t);
+  t = _mm_mulhi_epu16(t, _mm_setr_epi16(DECIMAL_FORMAT_DIVPOWERS));
+  t = _mm_mulhi_epu16(t, _mm_setr_epi16(DECIMAL_FORMAT_SHIFTPOWERS));
+  return _mm_sub_epi16(t, _mm_slli_epi64(_mm_mullo_epi16(t, _mm_set1_epi16(10)), 16));
+}
+
+__attribute__ ((target ("sse4.1")))
+static int __decimal_check_sse41(const char *str, size_t len) {
+  __m128i v, nine;
+  size_t i;
+
+  nine = _mm_set1_epi8(9);
+  for (i=0;i+((size_t) 16)<=len;i+=((size_t) 16)) {
+    v = _mm_loadu_si128((const __m128i *) &str[i]);
+    v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    v = _mm_cmpeq_epi8(_mm_max_epu8(v, nine), nine);
+    if (_mm_movemask_epi8(v) != 0xffff) return -1;
+  }
+  return __decimal_check_scalar(&str[i], len - i);
+}
+
+__attribute__ ((target ("sse4.1")))
+static void __decimal_parse_sse41(uint64_t *c, const char *str, size_t count) {
+  const char *curr;
+  size_t i;
+
+  for (i=0,curr=str;i<count;i++,curr+=DECIMAL_CHUNK_DIGITS) {
+    c[i] = __decimal_chunk_value(curr, (size_t) 3) * ((uint64_t) 10000000000000000ull) +
+      __decimal_parse16_sse41(&curr[3]);
+  }
+}
+
+__attribute__ ((target ("sse4.1")))
+static void __decimal_format_sse41(char *str, const uint64_t *c, size_t count) {
+  uint64_t v, r;
+  __m128i hi, lo;
+  size_t i;
+  char *curr;
+
+  for (i=0,curr=str;i<count;i++,curr+=DECIMAL_CHUNK_DIGITS) {
+    v = c[i] / ((uint64_t) 10000000000000000ull);
+    r = c[i] - v * ((uint64_t) 10000000000000000ull);
+    __format_decimal_chunk(curr, v, (size_t) 3);
+    hi = __decimal_format8_sse41((uint32_t) (r / ((uint64_t) 100000000)));
+    lo = __decimal_format8_sse41((uint32_t) (r % ((uint64_t) 100000000)));
+    hi = _mm_add_epi8(_mm_packus_epi16(hi, lo), _mm_set1_epi8('0'));
+    _mm_storeu_si128((__m128i *) &curr[3], hi);
+  }
+}
+
+static const __decimal_kernels_t __decimal_kernels_sse41 = {
+  __decimal_check_sse41,
+  __decimal_parse_sse41,
+  __decimal_format_sse41
+};
+
+__attribute__ ((target ("avx2")))
+static int __decimal_check_avx2(const char *str, size_t len) {
+  __m256i v, nine;
+  size_t i;
+
+  nine = _mm256_set1_epi8(9);
+  for (i=0;i+((size_t) 32)<=len;i+=((size_t) 32)) {
+    v = _mm256_loadu_si256((const __m256i *) &str[i]);
+    v = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    v = _mm256_cmpeq_epi8(_mm256_max_epu8(v, nine), nine);
+    if (_mm256_movemask_epi8(v) != -1) return -1;
+  }
+  return __decimal_check_sse41(&str[i], len - i);
+}
+
+/* Two consecutive chunks at str and str + 19: the 32 characters at 
+   str + 3 are the 16 last ones of the first chunk and the 16 first
+   ones of the second chunk.
+*/
+__attribute__ ((target ("avx2")))
+static void __decimal_parse_avx2(uint64_t *c, const char *str, size_t count) {
+  const char *curr;
+  __m256i v;
+  uint64_t h0, l0, h1, l1;
+  size_t i;
+
+  for (i=0,curr=str;i+((size_t) 2)<=count;i+=((size_t) 2),curr+=((size_t) 2)*DECIMAL_CHUNK_DIGITS) {
+    v = _mm256_loadu_si256((const __m256i *) &curr[3]);
+    v = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    v = _mm256_maddubs_epi16(v, _mm256_set_epi8(DECIMAL_PARSE_M1, DECIMAL_PARSE_M1));
+    v = _mm256_madd_epi16(v, _mm256_set_epi16(DECIMAL_PARSE_M2, DECIMAL_PARSE_M2));
+    v = _mm256_packus_epi32(v, v);
+    v = _mm256_madd_epi16(v, _mm256_set_epi16(DECIMAL_PARSE_M3, DECIMAL_PARSE_M3));
+    h0 = (uint64_t) (uint32_t) _mm256_extract_epi32(v, 0);
+    l0 = (uint64_t) (uint32_t) _mm256_extract_epi32(v, 1);
+    h1 = (uint64_t) (uint32_t) _mm256_extract_epi32(v, 4);
+    l1 = (uint64_t) (uint32_t) _mm256_extract_epi32(v, 5);
+    c[i] = __decimal_chunk_value(curr, (size_t) 3) * ((uint64_t) 10000000000000000ull) +
+      h0 * ((uint64_t) 100000000) + l0;
+    c[i + ((size_t) 1)] = (h1 * ((uint64_t) 100000000) + l1) * ((uint64_t) 1000) +
+      __decimal_chunk_value(&curr[DECIMAL_CHUNK_DIGITS + ((size_t) 16)], (size_t) 3);
+  }
+  if (i < count) {
+    __decimal_parse_sse41(&c[i], curr, count - i);
+  }
+}
+
+/* Two chunks at a time: the 8 digit groups of the first chunk go to
+   the lower 128 bit lane, those of the second to the upper lane.
+*/
+__attribute__ ((target ("avx2")))
+static void __decimal_format_avx2(char *str, const uint64_t *c, size_t count) {
+  uint64_t v0, v1, r0, r1;
+  __m256i hi, lo, abcd, efgh, t;
+  size_t i;
+  char *curr;
+  int k;
+
+  for (i=0,curr=str;i+((size_t) 2)<=count;i+=((size_t) 2),curr+=((size_t) 2)*DECIMAL_CHUNK_DIGITS) {
+    v0 = c[i] / ((uint64_t) 10000000000000000ull);
+    r0 = c[i] - v0 * ((uint64_t) 10000000000000000ull);
+    v1 = c[i + ((size_t) 1)] / ((uint64_t) 10000000000000000ull);
+    r1 = c[i + ((size_t) 1)] - v1 * ((uint64_t) 10000000000000000ull);
+
+    /* hi holds the upper 8 digits of both chunks, lo the lower ones */
+    hi = _mm256_setr_epi32((int) (r0 / ((uint64_t) 100000000)), 0, 0, 0,
+			   (int) (r1 / ((uint64_t) 100000000)), 0, 0, 0);
+    lo = _mm256_setr_epi32((int) (r0 % ((uint64_t) 100000000)), 0, 0, 0,
+			   (int) (r1 % ((uint64_t) 100000000)), 0, 0, 0);
+    for (k=0;k<2;k++) {
+      t = (k == 0) ? hi : lo;
+      abcd = _mm256_srli_epi64(_mm256_mul_epu32(t, _mm256_set1_epi32(DECIMAL_FORMAT_DIV10000)), 45);
+      efgh = _mm256_sub_epi32(t, _mm256_mul_epu32(abcd, _mm256_set1_epi32(10000)));
+      t = _mm256_unpacklo_epi16(abcd, efgh);
+      t = _mm256_slli_epi64(t, 2);
+      t = _mm256_unpacklo_epi16(t, t);
+      t = _mm256_unpacklo_epi32(t, t);
+      t = _mm256_mulhi_epu16(t, _mm256_setr_epi16(DECIMAL_FORMAT_DIVPOWERS, DECIMAL_FORMAT_DIVPOWERS));
+      t = _mm256_mulhi_epu16(t, _mm256_setr_epi16(DECIMAL_FORMAT_SHIFTPOWERS, DECIMAL_FORMAT_SHIFTPOWERS));
+      t = _mm256_sub_epi16(t, _mm256_slli_epi64(_mm256_mullo_epi16(t, _mm256_set1_epi16(10)), 16));
+      if (k == 0) {
+	hi = t;
+      } else {
+	lo = t;
+      }
+    }
+    hi = _mm256_add_epi8(_mm256_packus_epi16(hi, lo), _mm256_set1_epi8('0'));
+
+    __format_decimal_chunk(curr, v0, (size_t) 3);
+    _mm_storeu_si128((__m128i *) &curr[3], _mm256_castsi256_si128(hi));
+    __format_decimal_chunk(&curr[DECIMAL_CHUNK_DIGITS], v1, (size_t) 3);
+    _mm_storeu_si128((__m128i *) &curr[DECIMAL_CHUNK_DIGITS + ((size_t) 3)],
+		     _mm256_extracti128_si256(hi, 1));
+  }
+  if (i < count) {
+    __decimal_format_sse41(curr, &c[i], count - i);
+  }
+}
+
+static const __decimal_kernels_t __decimal_kernels_avx2 = {
+  __decimal_check_avx2,
+  __decimal_parse_avx2,
+  __decimal_format_avx2
+};
+
+#endif
+
+static const __decimal_kernels_t *__decimal_kernels_selected = NULL;
+
+/* Returns the best kernels the processor supports */
+static inline const __decimal_kernels_t *__decimal_kernels(void) {
+  const __decimal_kernels_t *k;
+
+  k = __atomic_load_n(&__decimal_kernels_selected, __ATOMIC_ACQUIRE);
+  if (k != NULL) return k;
+
+  /* Several threads may get here at the same time. They all come to
+     the same result.
+  */
+  k = &__decimal_kernels_scalar;
+#if defined(DECIMAL_KERNELS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    k = &__decimal_kernels_avx2;
+  } else if (__builtin_cpu_supports("sse4.1")) {
+    k = &__decimal_kernels_sse41;
+  }
+#endif
+  __atomic_store_n(&__decimal_kernels_selected, k, __ATOMIC_RELEASE);
+  return k;
+}
+
+/* Conversion in arbitrary radices
+
+   Integers are converted to and from radices 2 to 62. In radices up to
+   36, digits are taken from 0 .. 9 followed by the lower case letters,
+   upper case letters being accepted on input as well. In radices 37 to
+   62, digits are 0 .. 9 followed by the upper case letters, then the
+   lower case letters.
+
+   Every radix comes with a "big base", the greatest power of the radix
+   that holds on a 64 bit digit, say base^d. Strings are cut into
+   chunks of d characters, which are converted one 64 bit digit at a
+   time. For radix 10, this is 10^19 and the character-level kernels
+   above do the work.
+
+   Long strings and great integers are cut in halves by powers of the
+   big base of the form base^(d * 2^k). These powers are kept in
+   process-wide tables, one per radix, along with the values needed to
+   divide by them: the power shifted left so that its most significant
+   bit is set and, for great powers, the inverse of that shifted power
+   as computed by __invert. Only conversion to strings divides, so the
+   inverses are computed on first use by a division.
+
+   The tables are grown on demand by squaring their last entry and are
+   never shrunk, so repeated conversions in the same radix do not
+   recompute the powers. Entries never move once computed, so they can
+   be used without holding any lock. Growing a table, or setting up a
+   radix for the first time, is done under a mutex.
+
+*/
+static const char __radix_digits_lower[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static const char __radix_digits_mixed[] =
+  "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+#define RADIX_MIN 2u
+#define RADIX_MAX 62u
+
+/* Maximum number of cached powers per radix. Entry k has about
+   2^k 64 bit digits, so this is never a limit in practice.
+*/
+#define RADIX_POWER_TABLE_MAX ((size_t) 48)
+
+typedef struct {
+  uint64_t     *power;
+  uint64_t     *normalized;
+  uint64_t     *inverse;
+  size_t       size;
+  unsigned int shift;
+} __power_table_entry_t;
+
+typedef struct {
+  unsigned int          base;
+  size_t                chunk_digits;
+  uint64_t              chunk_base;
+  const char            *digits;
+  unsigned char         values[256];
+  size_t                table_size;
+  __power_table_entry_t table[RADIX_POWER_TABLE_MAX];
+} __radix_t;
+
+static __radix_t *__radices[RADIX_MAX + 1u];
+static pthread_mutex_t __radix_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Returns the description of radix base, which must be between 2 and
+   62, setting it up on first use.
+*/
+static const __radix_t *__radix(unsigned int base) {
+  __radix_t *r;
+  unsigned int i;
+
+  r = __atomic_load_n(&__radices[base], __ATOMIC_ACQUIRE);
+  if (r != NULL) return r;
+
+  pthread_mutex_lock(&__radix_mutex);
+  r = __radices[base];
+  if (r == NULL) {
+    r = __alloc_mem((size_t) 1, sizeof(*r));
+    r->base = base;
+    r->chunk_digits = (size_t) 1;
+    r->chunk_base = (uint64_t) base;
+    while (r->chunk_base <= UINT64_MAX / ((uint64_t) base)) {
+      r->chunk_base *= (uint64_t) base;
+      r->chunk_digits++;
+    }
+    r->digits = (base <= 36u) ? __radix_digits_lower : __radix_digits_mixed;
+    memset(r->values, 0xff, sizeof(r->values));
+    for (i=0u;i<base;i++) {
+      r->values[(unsigned char) r->digits[i]] = (unsigned char) i;
+      if ((base <= 36u) && (i >= 10u)) {
+	r->values[(unsigned char) (r->digits[i] - 'a' + 'A')] = (unsigned char) i;
+      }
+    }
+    r->table_size = (size_t) 0;
+    __atomic_store_n(&__radices[base], r, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&__radix_mutex);
+
+  return r;
+}
+
+/* Returns entry k of the table of powers of radix r, which holds 
+   base^(d * 2^k), growing the table if needed.
+
+   The products, which may fork, are computed without holding
+   __radix_mutex: a joining thread may run other conversions, which
+   would take the mutex again. The mutex only guards publishing an
+   entry. Threads that race for the same entry compute it each, and
+   all but the first drop their copy.
+*/
+static const __power_table_entry_t *__radix_power(const __radix_t *r, size_t k) {
+  __radix_t *w;
+  __power_table_entry_t e;
+  const __power_table_entry_t *prev;
+  size_t i, n;
+  int published;
+
+  if (k < __atomic_load_n(&r->table_size, __ATOMIC_ACQUIRE)) return &r->table[k];
+  if (k >= RADIX_POWER_TABLE_MAX) {
+    fprintf(stderr, "Cannot cache such a power of %u\n", r->base);
+    exit(1);
+  }
+
+  /* Compute the missing entries, unless another thread already did */
+  w = (__radix_t *) r;
+  for (i=__atomic_load_n(&w->table_size, __ATOMIC_ACQUIRE);i<=k;i++) {
+    if (i < __atomic_load_n(&w->table_size, __ATOMIC_ACQUIRE)) continue;
+    if (i == ((size_t) 0)) {
+      e.size = (size_t) 1;
+      e.power = __alloc_mem(e.size, sizeof(*(e.power)));
+      e.power[0] = w->chunk_base;
+    } else {
+      prev = &w->table[i - ((size_t) 1)];
+      n = prev->size << 1;
+      e.power = __alloc_mem(n, sizeof(*(e.power)));
+      multiplication(e.power, prev->power, prev->size,
+		     prev->power, prev->size);
+      if (e.power[n - ((size_t) 1)] == ((uint64_t) 0)) n--;
+      e.size = n;
+    }
+    e.shift = (unsigned int) __leading_zeros_uint64(e.power[e.size - ((size_t) 1)]);
+    e.normalized = __alloc_mem(e.size, sizeof(*(e.normalized)));
+    lshift(e.normalized, e.power, e.size, e.shift);
+    e.inverse = NULL;
+
+    pthread_mutex_lock(&__radix_mutex);
+    published = (w->table_size == i);
+    if (published) {
+      w->table[i] = e;
+      __atomic_store_n(&w->table_size, i + ((size_t) 1), __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&__radix_mutex);
+    if (!published) {
+      __free_mem(e.power);
+      __free_mem(e.normalized);
+    }
+  }
+
+  return &r->table[k];
+}
+
+/* Returns the inverse of the normalized power in the entry e of a
+   table of powers, computing it if needed, or NULL if the power is
+   too small for division by Newton inverse to pay off.
+
+   As for the powers, the inversion runs without any lock held. The
+   first inverse is published with a compare-and-swap and the copies
+   of threads that lose the race are freed.
+*/
+static const uint64_t *__radix_power_inverse(const __power_table_entry_t *e) {
+  __power_table_entry_t *w;
+  uint64_t *inv;
+  uint64_t *old;
+
+  if (e->size < DIVISION_NEWTON_THRESHOLD) return NULL;
+  inv = __atomic_load_n(&e->inverse, __ATOMIC_ACQUIRE);
+  if (inv != NULL) return inv;
+
+  w = (__power_table_entry_t *) e;
+  inv = __alloc_mem(w->size, sizeof(*inv));
+  __invert(inv, w->normalized, w->size);
+  old = NULL;
+  if (!__atomic_compare_exchange_n(&w->inverse, &old, inv, 0,
+				   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    __free_mem(inv);
+    inv = old;
+  }
+
+  return inv;
+}
+
+/* Returns the value of the len digits in radix r starting at str.
+
+   The digits must have been checked before and len must be at most
+   the number of digits of a chunk.
+
+*/
+static inline uint64_t __radix_chunk_value(const __radix_t *r, const char *str, size_t len) {
+  uint64_t res;
+  size_t i;
+
+  res = (uint64_t) 0;
+  for (i=0;i<len;i++) {
+    res = res * ((uint64_t) r->base) + ((uint64_t) r->values[(unsigned char) str[i]]);
+  }
+  return res;
+}
+
+/* Returns base^len, for len at most the number of digits of a chunk */
+static inline uint64_t __radix_chunk_power(const __radix_t *r, size_t len) {
+  uint64_t res;
+  size_t i;
+
+  res = (uint64_t) 1;
+  for (i=0;i<len;i++) {
+    res *= (uint64_t) r->base;
+  }
+  return res;
+}
+
+/* Returns the number of digits of c in radix r, which is at least 1 */
+static inline size_t __radix_chunk_length(const __radix_t *r, uint64_t c) {
+  size_t res;
+
+  for (res=(size_t) 1;c>=((uint64_t) r->base);c/=((uint64_t) r->base)) res++;
+  return res;
+}
+
+/* Writes the len least significant digits in radix r of the chunk c,
+   including leading zeros, to str.
+*/
+static inline void __format_radix_chunk(const __radix_t *r, char *str, uint64_t c, size_t len) {
+  size_t i;
+
+  for (i=len;i>((size_t) 0);i--) {
+    str[i - ((size_t) 1)] = r->digits[c % ((uint64_t) r->base)];
+    c /= (uint64_t) r->base;
+  }
+}
+
+/* Returns 0 if the len characters at str are all digits in radix r,
+   -1 otherwise.
+*/
+static inline int __check_radix_chars(const char *str, size_t len,
+				      const __radix_t *r) {
+  size_t i;
+
+  if (r->base == 10u) return __decimal_kernels()->check(str, len);
+  for (i=0;i<len;i++) {
+    if (r->values[(unsigned char) str[i]] == ((unsigned char) 0xff)) return -1;
+  }
+  return 0;
+}
+
+/* Checks that str consists only of digits in radix r.
+
+   On success, sets the variable pointed to by len to the length of
+   str and returns 0. Returns -1 otherwise, including for the empty
+   string.
+
+*/
+static inline int __check_radix_string(size_t *len, const char *str,
+				       const __radix_t *r) {
+  size_t l;
+
+  l = strlen(str);
+  if (l == ((size_t) 0)) return -1;
+  if (__check_radix_chars(str, l, r) < 0) return -1;
+  *len = l;
+  return 0;
+}
+
+/* Sets c[i] to the value of the i-th full chunk of digits starting at
+   str, for i = 0 .. count - 1.
+*/
+static inline void __radix_parse_chunks(const __radix_t *r, uint64_t *c,
+					const char *str, size_t count) {
+  size_t i;
+
+  if (r->base == 10u) {
+    __decimal_kernels()->parse(c, str, count);
+    return;
+  }
+  for (i=0;i<count;i++) {
+    c[i] = __radix_chunk_value(r, &str[i * r->chunk_digits], r->chunk_digits);
+  }
+}
+
+/* Writes the chunks c[0], ..., c[count - 1] as full chunks of digits,
+   starting at str.
+*/
+static inline void __radix_format_chunks(const __radix_t *r, char *str,
+					 const uint64_t *c, size_t count) {
+  size_t i;
+
+  if (r->base == 10u) {
+    __decimal_kernels()->format(str, c, count);
+    return;
+  }
+  for (i=0;i<count;i++) {
+    __format_radix_chunk(r, &str[i * r->chunk_digits], c[i], r->chunk_digits);
+  }
+}
+
+/* Below this number of digits, integers are converted to strings by
+   repeated division by the big base. Above, they are cut in two
+   halves by division by a cached power. The same number of chunks is
+   the threshold for cutting strings.
+*/
+#define RADIX_DC_THRESHOLD ((size_t) 24)
+
+/* From this number of digits resp. chunks on, the two halves of the
+   divide-and-conquer conversions are converted in parallel when the
+   library uses several threads.
+*/
+#define RADIX_PARALLEL_THRESHOLD ((size_t) 512)
+
+/* Arguments of a conversion of a part of an integer to characters,
+   forked as a task
+*/
+typedef struct {
+  char            *str;
+  const uint64_t  *a;
+  size_t          n;
+  size_t          width;
+  const __radix_t *r;
+} __convert_to_string_task_t;
+
+static void __convert_to_string_task(void *arg);
+
+/* Writes the representation in radix r of a, which has n digits, to
+   str, without a terminating null character.
+
+   If width is zero, a must not be zero and is written without leading
+   zeros. Otherwise, a must be less than base^width and is written on
+   exactly width characters, padded with leading zeros.
+
+   Returns the number of characters written.
+
+   This is the basecase: a is cut into chunks by repeated division by
+   the big base, which is quadratic in n.
+
+*/
+static size_t __convert_to_string_basecase(char *str, const uint64_t *a,
+					   size_t n, size_t width,
+					   const __radix_t *r) {
+  uint64_t *t;
+  uint64_t *c;
+  uint64_t chunk;
+  size_t nc, len, i, j, l, d;
+  thread_scratch_mark_t mark;
+
+  d = r->chunk_digits;
+
+  /* Get the chunks, least significant first */
+  mark = thread_scratch_mark();
+  t = thread_scratch_alloc(n + ((size_t) 1), sizeof(*t));
+  c = thread_scratch_alloc(n + ((size_t) 2), sizeof(*c));
+  __m_memcpy(t, a, n, sizeof(*t));
+  nc = (size_t) 0;
+  while (n > ((size_t) 0)) {
+    c[nc] = divrem_1(t, t, n, r->chunk_base);
+    nc++;
+    if (t[n - ((size_t) 1)] == ((uint64_t) 0)) n--;
+  }
+
+  /* Get the length of the representation */
+  if (nc == ((size_t) 0)) {
+    len = (size_t) 0;
+  } else {
+    len = (nc - ((size_t) 1)) * d + __radix_chunk_length(r, c[nc - ((size_t) 1)]);
+  }
+  if (width > len) {
+    l = width - len;
+    memset(str, r->digits[0], l);
+  } else {
+    l = (size_t) 0;
+  }
+
+  /* Write the chunks, most significant first. The full chunks are
+     reversed into most significant first order, so that they can be
+     written in one go.
+  */
+  if (nc > ((size_t) 0)) {
+    i = nc - ((size_t) 1);
+    __format_radix_chunk(r, &str[l], c[i], len - i * d);
+    l += len - i * d;
+    for (j=0;j<(i >> 1);j++) {
+      chunk = c[j];
+      c[j] = c[i - ((size_t) 1) - j];
+      c[i - ((size_t) 1) - j] = chunk;
+    }
+    __radix_format_chunks(r, &str[l], c, i);
+    l += i * d;
+  }
+
+  thread_scratch_release(mark);
+
+  return l;
+}
+
+/* Same as __convert_to_string_basecase, but subquadratic.
+
+   a is cut as a = q * base^(d * 2^k) + r, where base^(d * 2^k) is
+   taken from the table of powers and has about half the digits of a.
+   Then q is converted, followed by r on exactly d * 2^k characters.
+
+   If width is not zero, the characters of r go to a known offset, so
+   that r can be converted by another thread while q gets converted,
+   writing directly to its final place in str.
+
+*/
+static size_t __convert_to_string_rec(char *str, const uint64_t *a,
+				      size_t n, size_t width,
+				      const __radix_t *r) {
+  const __power_table_entry_t *e;
+  uint64_t *q;
+  uint64_t *rem;
+  size_t k, nq, len, l, w;
+  __convert_to_string_task_t args;
+  thread_task_t task;
+  thread_scratch_mark_t mark;
+
+  /* Strip leading zero digits */
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  if (n == ((size_t) 0)) {
+    memset(str, r->digits[0], width);
+    return width;
+  }
+
+  /* Find the greatest power that has about half the digits of a and
+     leaves enough characters for the quotient.
+  */
+  if (n < RADIX_DC_THRESHOLD) {
+    return __convert_to_string_basecase(str, a, n, width, r);
+  }
+  for (k=(size_t) 0;;k++) {
+    e = __radix_power(r, k + ((size_t) 1));
+    if ((e->size << 1) > n + ((size_t) 1)) break;
+    if ((width != ((size_t) 0)) &&
+	((r->chunk_digits << (k + ((size_t) 1))) >= width)) break;
+  }
+  e = __radix_power(r, k);
+  l = r->chunk_digits << k;
+  if ((width != ((size_t) 0)) && (l >= width)) {
+    return __convert_to_string_basecase(str, a, n, width, r);
+  }
+
+  /* Divide a by the power. As e->size <= (n + 1) / 2 < n, the
+     quotient is not zero.
+  */
+  nq = n + ((size_t) 1) - e->size;
+  mark = thread_scratch_mark();
+  q = thread_scratch_alloc(nq, sizeof(*q));
+  rem = thread_scratch_alloc(e->size, sizeof(*rem));
+  __division_qr(q, rem, a, n, e->normalized, e->size, e->shift,
+		__radix_power_inverse(e));
+
+  /* Convert the quotient, then the remainder on l characters. With a
+     known width, the remainder is converted in parallel.
+  */
+  if ((width != ((size_t) 0)) &&
+      (n >= RADIX_PARALLEL_THRESHOLD) &&
+      (utepnum_get_threads() > 1u)) {
+    args.str = &str[width - l];
+    args.a = rem;
+    args.n = e->size;
+    args.width = l;
+    args.r = r;
+    thread_pool_fork(&task, __convert_to_string_task, &args);
+    __convert_to_string_rec(str, q, nq, width - l, r);
+    thread_pool_join(&task);
+    thread_scratch_release(mark);
+    return width;
+  }
+  w = (width == ((size_t) 0)) ? ((size_t) 0) : (width - l);
+  len = __convert_to_string_rec(str, q, nq, w, r);
+  len += __convert_to_string_rec(&str[len], rem, e->size, l, r);
+  thread_scratch_release(mark);
+
+  return len;
+}
+
+/* Runs a forked conversion to characters */
+static void __convert_to_string_task(void *arg) {
+  __convert_to_string_task_t *t = (__convert_to_string_task_t *) arg;
+
+  __convert_to_string_rec(t->str, t->a, t->n, t->width, t->r);
+}
+
+/* Forward declaration */
+static size_t __radix_length(const __radix_t *r, const uint64_t *a, size_t n);
+
+/* str becomes the string in radix base corresponding to a.
+
+   str needs to have sufficient length, i.e. room for the number of
+   digits of 2^(64 * n) in radix base, plus the terminating null
+   character.
+
+   Radices that are powers of two are converted in linear time.
+   Otherwise, the conversion cuts a recursively by division by cached
+   powers of the radix, so that it costs O(M(n) log(n)), where M(n) is
+   the cost of multiplication.
+
+   When the library uses several threads, the length of the string is
+   determined first. Then every part of a has a known place in str,
+   and the parts are converted in parallel.
+
+   Does nothing if base is not between 2 and 62.
+
+*/
+void convert_to_string_base(char *str, const uint64_t *a, size_t n,
+			    unsigned int base) {
+  const __radix_t *r;
+  size_t len;
+
+  if ((base < RADIX_MIN) || (base > RADIX_MAX)) return;
+
+  /* Power-of-two radices need no arithmetic */
+  if ((base & (base - 1u)) == 0u) {
+    convert_to_string_pow2(str, a, n, (unsigned int) __trailing_zeros_uint64((uint64_t) base), NULL);
+    return;
+  }
+
+  /* If n is zero, set str to the empty string */
+  if (n == ((size_t) 0)) {
+    str[0] = '\0';
+    return;
+  }
+
+  /* If a is zero, set str to the string "0" */
+  if (is_zero(a, n)) {
+    str[0] = '0';
+    str[1] = '\0';
+    return;
+  }
+
+  /* a is not zero. Convert it and set the end marker. */
+  r = __radix(base);
+  if ((n >= RADIX_PARALLEL_THRESHOLD) && (utepnum_get_threads() > 1u)) {
+    len = __convert_to_string_rec(str, a, n, __radix_length(r, a, n), r);
+  } else {
+    len = __convert_to_string_rec(str, a, n, (size_t) 0, r);
+  }
+  str[len] = '\0';
+}
+
+/* Returns an upper bound on the number of characters of the string
+   in radix base corresponding to a, including the terminating null
+   character, or 0 if base is not between 2 and 62.
+
+   As base^(d + 1) > 2^64, every 64 bits of a give at most d + 1
+   characters. The bound is exact up to a few percent.
+
+*/
+size_t convert_to_string_base_size(const uint64_t *a, size_t n,
+				   unsigned int base) {
+  uint64_t bits;
+
+  if ((base < RADIX_MIN) || (base > RADIX_MAX)) return (size_t) 0;
+  bits = bit_length(a, n);
+  return (size_t) ((bits * ((uint64_t) (__radix(base)->chunk_digits + ((size_t) 1))) +
+		    ((uint64_t) 63)) >> 6) + ((size_t) 2);
+}
+
+/* State of a conversion to a stream of characters: the characters
+   go to buf, which has room for block characters, fill of which are
+   in use. Full buffers are handed over to sink.
+*/
+typedef struct {
+  const __radix_t *r;
+  string_sink_t   sink;
+  void            *arg;
+  char            *buf;
+  size_t          block;
+  size_t          fill;
+} __string_stream_t;
+
+/* Hands the characters in the buffer over to the sink and gets a
+   new buffer. Returns 0 on success and -1 if the sink fails.
+*/
+static inline int __string_stream_flush(__string_stream_t *st) {
+  if (st->fill == ((size_t) 0)) return 0;
+  st->buf = st->sink(st->arg, st->buf, st->fill);
+  st->fill = (size_t) 0;
+  if (st->buf == NULL) return -1;
+  return 0;
+}
+
+/* Appends the len characters at str, or len zero characters if str
+   is NULL, to the stream.
+*/
+static int __string_stream_write(__string_stream_t *st, const char *str, size_t len) {
+  size_t l;
+
+  while (len > ((size_t) 0)) {
+    if (st->fill == st->block) {
+      if (__string_stream_flush(st) < 0) return -1;
+    }
+    l = ((st->block - st->fill) < len) ? (st->block - st->fill) : len;
+    if (str == NULL) {
+      memset(&st->buf[st->fill], st->r->digits[0], l);
+    } else {
+      memcpy(&st->buf[st->fill], str, l);
+      str += l;
+    }
+    st->fill += l;
+    len -= l;
+  }
+  return 0;
+}
+
+/* Same as __convert_to_string_rec, but the characters go to the
+   stream st, most significant first.
+
+   a is cut by division by cached powers until its representation
+   holds on a block, and is then converted directly into the buffer.
+
+   Returns 0 on success and -1 if the sink fails.
+
+*/
+static int __convert_to_string_stream(__string_stream_t *st, const uint64_t *a,
+				      size_t n, size_t width) {
+  const __power_table_entry_t *e;
+  const __radix_t *r;
+  uint64_t *q;
+  uint64_t *rem;
+  char *t;
+  size_t k, nq, l, w, bound;
+  int res;
+
+  r = st->r;
+
+  /* Strip leading zero digits */
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  if (n == ((size_t) 0)) return __string_stream_write(st, NULL, width);
+
+  /* If the representation holds on a block, convert directly into
+     the buffer. 
+  */
+  bound = (width == ((size_t) 0)) ? ((r->chunk_digits + ((size_t) 1)) * n) : width;
+  if (bound <= st->block) {
+    if (bound > (st->block - st->fill)) {
+      if (__string_stream_flush(st) < 0) return -1;
+    }
+    st->fill += __convert_to_string_rec(&st->buf[st->fill], a, n, width, r);
+    return 0;
+  }
+
+  /* Small integers with a lot of padding are converted apart */
+  if (n < RADIX_DC_THRESHOLD) {
+    t = __alloc_mem((r->chunk_digits + ((size_t) 1)) * n, sizeof(*t));
+    l = __convert_to_string_rec(t, a, n, (size_t) 0, r);
+    res = __string_stream_write(st, NULL, (width > l) ? (width - l) : ((size_t) 0));
+    if (res == 0) res = __string_stream_write(st, t, l);
+    __free_mem(t);
+    return res;
+  }
+
+  /* Cut a like __convert_to_string_rec does */
+  for (k=(size_t) 0;;k++) {
+    e = __radix_power(r, k + ((size_t) 1));
+    if ((e->size << 1) > n + ((size_t) 1)) break;
+    if ((width != ((size_t) 0)) &&
+	((r->chunk_digits << (k + ((size_t) 1))) >= width)) break;
+  }
+  e = __radix_power(r, k);
+  l = r->chunk_digits << k;
+
+  nq = n + ((size_t) 1) - e->size;
+  q = __alloc_mem(nq, sizeof(*q));
+  rem = __alloc_mem(e->size, sizeof(*rem));
+  __division_qr(q, rem, a, n, e->normalized, e->size, e->shift,
+		__radix_power_inverse(e));
+
+  /* Write the quotient, then the remainder on l characters */
+  w = (width == ((size_t) 0)) ? ((size_t) 0) : (width - l);
+  res = __convert_to_string_stream(st, q, nq, w);
+  __free_mem(q);
+  if (res == 0) res = __convert_to_string_stream(st, rem, e->size, l);
+  __free_mem(rem);
+
+  return res;
+}
+
+/* Writes the representation of a in radix base to a stream of
+   characters, most significant first, without any terminating null
+   character.
+
+   The characters go to buffers of at least block characters obtained
+   from sink. sink is first called with a NULL str argument and must
+   return the first buffer. It is then called with every buffer that
+   has been filled, along with the number of characters in it, and
+   must return the next buffer. sink returns NULL on error.
+
+   Returns 0 on success and -1 if base is not between 2 and 62, block
+   is zero or sink fails.
+
+   Like convert_to_string_base, this cuts a recursively by division by
+   cached powers of the radix, but only down to pieces that hold on a
+   block. Besides the buffers, the memory needed is about twice the
+   size of a, whatever the length of the representation.
+
+*/
+int convert_to_string_base_stream(const uint64_t *a, size_t n, unsigned int base,
+				  size_t block, string_sink_t sink, void *arg) {
+  __string_stream_t st;
+  int res;
+
+  if ((base < RADIX_MIN) || (base > RADIX_MAX)) return -1;
+  if (block == ((size_t) 0)) return -1;
+
+  st.r = __radix(base);
+  st.sink = sink;
+  st.arg = arg;
+  st.block = block;
+  st.fill = (size_t) 0;
+  st.buf = sink(arg, NULL, (size_t) 0);
+  if (st.buf == NULL) return -1;
+
+  /* If n is zero, there are no characters. If a is zero, there is
+     the character "0".
+  */
+  if (n == ((size_t) 0)) return 0;
+  if (is_zero(a, n)) {
+    res = __string_stream_write(&st, NULL, (size_t) 1);
+  } else {
+    res = __convert_to_string_stream(&st, a, n, (size_t) 0);
+  }
+  if (res == 0) res = __string_stream_flush(&st);
+
+  return res;
+}
+
+/* str becomes the decimal string corresponding to a.
+
+   str needs to have sufficient length.
+
+*/
 void convert_to_decimal_string(char *str, const uint64_t *a, size_t n) {
-  uint64_t *q;
+  convert_to_string_base(str, a, n, 10u);
+}
+
+/* Number of chunks parsed at once by the character-level kernels */
+#define RADIX_PARSE_BATCH ((size_t) 64)
+
+/* a becomes the value of the len digits in radix r at str, mod
+   2^(64 * n)
+
+   The digits must have been checked before. 
+
+   This is the basecase: the digits are consumed in chunks of d
+   digits, each of which holds on a 64 bit digit. Every chunk costs one
+   pass of
+
+   a = a * base^d + chunk
+
+   over the digits of a that are already in use, which is at most n.
+
+*/
+static void __convert_from_string_basecase(uint64_t *a, size_t n,
+					   const char *str, size_t len,
+					   const __radix_t *r) {
+  size_t l, used, i, j, m, d;
+  uint64_t chunk, cout;
+  uint64_t c[RADIX_PARSE_BATCH];
+
+  /* Set a to zero */
+  __m_memset(a, 0, n, sizeof(*a));
+  if (n == ((size_t) 0)) return;
+
+  /* The first chunk takes the digits that are left over when cutting
+     the string into chunks of d digits, so that all other chunks are
+     full.
+  */
+  d = r->chunk_digits;
+  l = len % d;
+  if (l == ((size_t) 0)) l = d;
+
+  /* a only occupies its used low digits, everything above is zero */
+  chunk = __radix_chunk_value(r, str, l);
+  a[0] = chunk;
+  used = (chunk != ((uint64_t) 0)) ? ((size_t) 1) : ((size_t) 0);
+
+  /* The full chunks are parsed by batches */
+  for (i=l; i<len; i+=m*d) {
+    m = (len - i) / d;
+    if (m > RADIX_PARSE_BATCH) m = RADIX_PARSE_BATCH;
+    __radix_parse_chunks(r, c, &str[i], m);
+    for (j=0;j<m;j++) {
+      /* a = a * base^d + chunk */
+      cout = __mul_1_add_1(a, a, used, r->chunk_base, c[j]);
+      if ((cout != ((uint64_t) 0)) && (used < n)) {
+	a[used] = cout;
+	used++;
+      }
+    }
+  }
+}
+
+/* Arguments of a conversion of a part of a string to an integer,
+   forked as a task
+*/
+typedef struct {
+  uint64_t        *a;
+  size_t          n;
+  const char      *str;
+  size_t          len;
+  const __radix_t *r;
+} __convert_from_string_task_t;
+
+static void __convert_from_string_task(void *arg);
+
+/* Same as __convert_from_string_basecase, but subquadratic.
+
+   The digits are cut into a high part and a low part of d * 2^k
+   digits, where d * 2^k is about half of len. Both parts are 
+   converted recursively and put back together as
+
+   a = high * base^(d * 2^k) + low,
+
+   with base^(d * 2^k) taken from the table of powers.
+
+   Above the parallel threshold, the high part is converted by another
+   thread while the low part gets converted.
+
+*/
+static void __convert_from_string_rec(uint64_t *a, size_t n,
+				      const char *str, size_t len,
+				      const __radix_t *r) {
+  const __power_table_entry_t *e;
+  uint64_t *h;
+  uint64_t *l;
   uint64_t *t;
-  unsigned int r;
-  size_t i, k;
-  char c;
-  
+  size_t k, ll, lh, nh, nt, d;
+  __convert_from_string_task_t args;
+  thread_task_t task;
+  thread_scratch_mark_t mark;
+
+  d = r->chunk_digits;
+  if (len < RADIX_DC_THRESHOLD * d) {
+    __convert_from_string_basecase(a, n, str, len, r);
+    return;
+  }
+
+  /* Find the greatest power with at most half the digits */
+  for (k=(size_t) 0;(d << (k + ((size_t) 2))) <= len;k++);
+  ll = d << k;
+  lh = len - ll;
+  e = __radix_power(r, k);
+
+  /* Convert the high and low parts. The low part is less than the
+     power. The high part holds on lh / d + 1 digits as base^d < 2^64.
+  */
+  nh = lh / d + ((size_t) 1);
+  mark = thread_scratch_mark();
+  h = thread_scratch_alloc(nh, sizeof(*h));
+  l = thread_scratch_alloc(e->size, sizeof(*l));
+  if ((len >= RADIX_PARALLEL_THRESHOLD * d) &&
+      (utepnum_get_threads() > 1u)) {
+    args.a = h;
+    args.n = nh;
+    args.str = str;
+    args.len = lh;
+    args.r = r;
+    thread_pool_fork(&task, __convert_from_string_task, &args);
+    __convert_from_string_rec(l, e->size, &str[lh], ll, r);
+    thread_pool_join(&task);
+  } else {
+    __convert_from_string_rec(h, nh, str, lh, r);
+    __convert_from_string_rec(l, e->size, &str[lh], ll, r);
+  }
+  for (;(nh>((size_t) 0)) && (h[nh - ((size_t) 1)] == ((uint64_t) 0));nh--);
+
+  /* a = h * power + l, mod 2^(64 * n) */
+  nt = nh + e->size;
+  t = thread_scratch_alloc(nt, sizeof(*t));
+  if (nh > ((size_t) 0)) {
+    multiplication(t, h, nh, e->power, e->size);
+  } else {
+    __m_memset(t, 0, nt, sizeof(*t));
+  }
+  addition(t, t, nt, l, e->size);
+  __m_memset(a, 0, n, sizeof(*a));
+  __m_memcpy(a, t, (n < nt) ? n : nt, sizeof(*a));
+
+  thread_scratch_release(mark);
+}
+
+/* Runs a forked conversion from characters */
+static void __convert_from_string_task(void *arg) {
+  __convert_from_string_task_t *t = (__convert_from_string_task_t *) arg;
+
+  __convert_from_string_rec(t->a, t->n, t->str, t->len, t->r);
+}
+
+/* a becomes what is in the string in radix base mod 2^(64 * n)
+
+   Returns 0 if success
+   Returns -1 if failure (someone tries to convert "cheese" in a radix
+   below 35, or base is not between 2 and 62)
+
+   The string is checked completely before a gets touched. 
+
+   Radices that are powers of two are converted in linear time.
+   Otherwise, short strings, and strings that are long compared to n,
+   are converted one chunk at a time. Long strings are cut in halves
+   recursively, which costs O(M(n) log(n)), where M(n) is the cost of
+   multiplication.
+
+*/
+int convert_from_string_base(uint64_t *a, size_t n, const char *str,
+			     unsigned int base) {
+  const __radix_t *r;
+  uint64_t *t;
+  size_t len, nt;
+  thread_scratch_mark_t mark;
+
+  if ((base < RADIX_MIN) || (base > RADIX_MAX)) return -1;
+
+  /* Power-of-two radices need no arithmetic */
+  if ((base & (base - 1u)) == 0u) {
+    return convert_from_string_pow2(a, n, str, (unsigned int) __trailing_zeros_uint64((uint64_t) base), NULL);
+  }
+
+  /* Check the string, which also gives us its length */
+  r = __radix(base);
+  if (__check_radix_string(&len, str, r) < 0) return -1;
+
+  /* If n is small, there is little to gain from cutting the string */
+  nt = len / r->chunk_digits + ((size_t) 1);
+  if ((n < RADIX_DC_THRESHOLD) || (nt < RADIX_DC_THRESHOLD)) {
+    __convert_from_string_basecase(a, n, str, len, r);
+    return 0;
+  }
+
+  /* If a is great enough to hold the whole value, convert in place */
+  if (n >= nt) {
+    __convert_from_string_rec(a, n, str, len, r);
+    return 0;
+  }
+
+  /* Otherwise convert into a temporary and reduce mod 2^(64 * n) */
+  mark = thread_scratch_mark();
+  t = thread_scratch_alloc(nt, sizeof(*t));
+  __convert_from_string_rec(t, nt, str, len, r);
+  __m_memcpy(a, t, n, sizeof(*a));
+  thread_scratch_release(mark);
+
+  /* Indicate success */
+  return 0;
+}
+
+/* Streams of characters are parsed by blocks of d * 2^k digits, where
+   k is RADIX_STREAM_BLOCK_LOG.
+*/
+#define RADIX_STREAM_BLOCK_LOG ((size_t) 12)
+
+/* Maximum number of pending values when parsing a stream. Entry i
+   holds 2^i blocks at most, so this is never a limit in practice.
+*/
+#define RADIX_STREAM_STACK_MAX ((size_t) 64)
+
+/* A value parsed from a stream that still needs to be merged with
+   the digits that follow it: value has size significant digits and
+   stands for len characters of the stream.
+*/
+typedef struct {
+  uint64_t *value;
+  size_t   size;
+  size_t   len;
+} __stream_value_t;
+
+/* Strips the leading zero digits of the value v */
+static inline void __stream_value_normalize(__stream_value_t *v) {
+  for (;(v->size>((size_t) 0)) && (v->value[v->size - ((size_t) 1)] == ((uint64_t) 0));v->size--);
+}
+
+/* Returns base^e, with e > 0, as a freshly allocated integer of the
+   size set in the variable pointed to by n.
+
+   With e = d * q + s, base^e is the product of base^s and the entries
+   of the table of powers for the bits set in q.
+
+*/
+static uint64_t *__radix_power_any(size_t *n, const __radix_t *r, size_t e) {
+  const __power_table_entry_t *pe;
+  uint64_t *p;
+  uint64_t *t;
+  size_t q, k, m;
+
+  q = e / r->chunk_digits;
+  m = (size_t) 1;
+  p = __alloc_mem(m, sizeof(*p));
+  p[0] = __radix_chunk_power(r, e % r->chunk_digits);
+  for (k=(size_t) 0;q!=((size_t) 0);k++,q>>=1) {
+    if ((q & ((size_t) 1)) == ((size_t) 0)) continue;
+    pe = __radix_power(r, k);
+    t = __alloc_mem(m + pe->size, sizeof(*t));
+    multiplication(t, p, m, pe->power, pe->size);
+    m += pe->size;
+    if (t[m - ((size_t) 1)] == ((uint64_t) 0)) m--;
+    __free_mem(p);
+    p = t;
+  }
+  *n = m;
+  return p;
+}
+
+/* Returns the number of characters of a, which has n digits and is
+   not zero, in radix r.
+
+   As 2^(b - 1) <= a < 2^b, with b the bit length of a, the length is
+   known up to one from b. The remaining doubt is removed by comparing
+   a with a power of the radix.
+
+*/
+static size_t __radix_length(const __radix_t *r, const uint64_t *a, size_t n) {
+  uint64_t *p;
+  uint64_t bits;
+  size_t lo, hi, np;
+  double c;
+  int greater;
+
+  if (r->base == 10u) return (size_t) decimal_digit_count(a, n);
+
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  bits = bit_length(a, n);
+  c = log(2.0) / log((double) r->base);
+  lo = ((size_t) floor(((double) (bits - ((uint64_t) 1))) * c + 1.0 - 1e-3));
+  hi = ((size_t) floor(((double) bits) * c + 1e-3)) + ((size_t) 1);
+  if (lo < ((size_t) 1)) lo = (size_t) 1;
+
+  /* The length is the least l such that a < base^l */
+  for (;lo<hi;lo++) {
+    p = __radix_power_any(&np, r, lo);
+    greater = ((n > np) || ((n == np) && (comparison(a, p, n) >= 0)));
+    __free_mem(p);
+    if (!greater) break;
+  }
+
+  return lo;
+}
+
+/* Sets the value h to h * base^(l->len) + l and frees l.
+
+   If the length of l is d * 2^k for some k, the power is taken from
+   the table of powers directly.
+
+*/
+static void __stream_value_merge(__stream_value_t *h, __stream_value_t *l,
+				 const __radix_t *r) {
+  const __power_table_entry_t *pe;
+  const uint64_t *p;
+  uint64_t *pa;
+  uint64_t *t;
+  size_t k, np, nt;
+
+  pa = NULL;
+  for (k=(size_t) 0;(r->chunk_digits << k)<l->len;k++);
+  if ((r->chunk_digits << k) == l->len) {
+    pe = __radix_power(r, k);
+    p = pe->power;
+    np = pe->size;
+  } else {
+    pa = __radix_power_any(&np, r, l->len);
+    p = pa;
+  }
+
+  nt = ((h->size > l->size) ? h->size : l->size) + np + ((size_t) 1);
+  t = __alloc_mem(nt, sizeof(*t));
+  if (h->size > ((size_t) 0)) {
+    multiplication(t, h->value, h->size, p, np);
+  }
+  if (l->size > ((size_t) 0)) {
+    addition(t, t, nt, l->value, l->size);
+  }
+
+  __free_mem(pa);
+  __free_mem(h->value);
+  __free_mem(l->value);
+  h->value = t;
+  h->size = nt;
+  h->len += l->len;
+  __stream_value_normalize(h);
+}
+
+/* Parses the len checked characters at str into a fresh value */
+static void __stream_value_parse(__stream_value_t *v, const char *str,
+				 size_t len, const __radix_t *r) {
+  v->size = len / r->chunk_digits + ((size_t) 1);
+  v->value = __alloc_mem(v->size, sizeof(*(v->value)));
+  v->len = len;
+  __convert_from_string_rec(v->value, v->size, str, len, r);
+  __stream_value_normalize(v);
+}
+
+/* Parses a stream of digits in radix base of unknown length.
+
+   The characters are obtained by repeated calls to source, which
+   must set the variables pointed to by its str and len arguments to
+   the next piece of characters and return 1, return 0 at the end of
+   the stream and -1 on error. The pieces may have any length and stay
+   valid until the next call to source.
+
+   On success, sets the variable pointed to by a to a freshly
+   allocated integer holding the value of the stream, sets the
+   variable pointed to by n to its size, which is at least 1 and has no
+   leading zero digits except for zero itself, and returns 0. The
+   integer must be freed with free().
+
+   Returns -1 if base is not between 2 and 62, the stream is empty,
+   contains characters that are not digits or if source fails. 
+
+   hint is the expected number of characters or zero if unknown. It is
+   only used to set up the powers of the radix ahead of time.
+
+   Characters are parsed by blocks of d * 2^12 digits, which are
+   merged with the cached powers of the radix like a binary counter:
+   two pending values standing for the same number of digits are
+   merged as soon as they appear. This costs O(M(n) log(n)), where
+   M(n) is the cost of multiplication, and needs memory for the
+   binary value and one block of characters only.
+
+*/
+int convert_from_string_base_stream(uint64_t **a, size_t *n, unsigned int base,
+				    size_t hint, string_source_t source, void *arg) {
+  const __radix_t *r;
+  __stream_value_t stack[RADIX_STREAM_STACK_MAX];
+  __stream_value_t v;
+  const char *str;
+  char *block;
+  size_t len, bl, fill, sp, k, i;
+  int res, ret;
+
+  if ((base < RADIX_MIN) || (base > RADIX_MAX)) return -1;
+  r = __radix(base);
+  bl = r->chunk_digits << RADIX_STREAM_BLOCK_LOG;
+
+  /* Get the powers needed for merging in one go */
+  if (hint > bl) {
+    for (k=RADIX_STREAM_BLOCK_LOG;(r->chunk_digits << (k + ((size_t) 1))) < hint;k++);
+    __radix_power(r, k);
+  }
+
+  /* Characters of blocks that straddle pieces go to block */
+  block = __alloc_mem(bl, sizeof(*block));
+  fill = (size_t) 0;
+  sp = (size_t) 0;
+  len = (size_t) 0;
+  ret = 0;
+  for (;;) {
+    res = source(arg, &str, &len);
+    if (res <= 0) {
+      ret = res;
+      break;
+    }
+    if (__check_radix_chars(str, len, r) < 0) {
+      ret = -1;
+      break;
+    }
+    while (len > ((size_t) 0)) {
+      /* Parse a whole block from the piece if there is one, otherwise
+	 collect the characters 
+      */
+      if ((fill == ((size_t) 0)) && (len >= bl)) {
+	__stream_value_parse(&v, str, bl, r);
+	str += bl;
+	len -= bl;
+      } else {
+	k = ((bl - fill) < len) ? (bl - fill) : len;
+	memcpy(&block[fill], str, k);
+	fill += k;
+	str += k;
+	len -= k;
+	if (fill < bl) break;
+	__stream_value_parse(&v, block, bl, r);
+	fill = (size_t) 0;
+      }
+
+      /* Merge with the pending values of the same length */
+      while ((sp > ((size_t) 0)) && (stack[sp - ((size_t) 1)].len == v.len)) {
+	sp--;
+	__stream_value_merge(&stack[sp], &v, r);
+	v = stack[sp];
+      }
+      stack[sp] = v;
+      sp++;
+    }
+  }
+
+  /* Fold the pending values, starting with the least significant */
+  if ((ret == 0) && ((sp > ((size_t) 0)) || (fill > ((size_t) 0)))) {
+    if (fill > ((size_t) 0)) {
+      __stream_value_parse(&v, block, fill, r);
+    } else {
+      sp--;
+      v = stack[sp];
+    }
+    while (sp > ((size_t) 0)) {
+      sp--;
+      __stream_value_merge(&stack[sp], &v, r);
+      v = stack[sp];
+    }
+    if (v.size == ((size_t) 0)) v.size = (size_t) 1;
+    *a = v.value;
+    *n = v.size;
+  } else {
+    ret = -1;
+  }
+
+  for (i=0;i<sp;i++) {
+    __free_mem(stack[i].value);
+  }
+  __free_mem(block);
+
+  return ret;
+}
+
+/* a becomes what is in the decimal string mod 2^(64 * n)
+
+   Returns 0 if success
+   Returns -1 if failure  (someone tries to convert "cheese")
+
+*/
+int convert_from_decimal_string(uint64_t *a, size_t n,
+				const char *str) {
+  return convert_from_string_base(a, n, str, 10u);
+}
+
+/* Magnitude queries
+
+   The number of decimal digits, the decimal logarithm and the leading
+   decimal digits of an integer are obtained from its most significant
+   bits, without converting it entirely.
+
+   Powers of ten are then needed only approximately. They are computed
+   by truncated binary powering on a few digits: 10^E is enclosed as
+
+   p * 2^e <= 10^E < (p + u) * 2^e,
+
+   where p has m digits and its most significant bit set. Every
+   truncated multiplication makes a relative error of at most 
+   eps = 2^-(64 * m - 1), downwards. Powering by squaring multiplies
+   the errors of at most 2 * E such operations, so the relative error
+   of the result is at most 2.02 * E * eps as long as E * eps is tiny.
+   With p < 2^(64 * m), u = 5 * E + 5 is thus a safe bound.
+
+   Only if the most significant bits of the integer fall into such an
+   enclosure is the exact power computed from the table of powers,
+   which costs O(M(n)), where M(n) is the cost of multiplication. This
+   is rare for arbitrary integers, but it is what happens at the
+   boundaries: 10^N - 1 and 10^N are too close to 10^N for any
+   enclosure, and so are exact multiples of 10^(D - k), and integers
+   just below them, for the k leading digits.
+
+*/
+#define MAGNITUDE_PRECISION ((size_t) 4)
+
+/* log10(2) * 2^64, rounded down */
+#define MAGNITUDE_LOG10_2 ((uint64_t) 0x4d104d427de7fbccull)
+
+/* x = x * y, truncated to m digits, where x and y have m digits with
+   the most significant bit set. ex and ey are the binary exponents of
+   x and y. 
+*/
+static void __truncated_multiplication(uint64_t *x, int64_t *ex,
+				       const uint64_t *y, int64_t ey,
+				       size_t m, uint64_t *t) {
+  multiplication(t, x, m, y, m);
+  if ((t[(m << 1) - ((size_t) 1)] >> 63) != ((uint64_t) 0)) {
+    __m_memcpy(x, &t[m], m, sizeof(*x));
+    *ex += ey + ((int64_t) (m << 6));
+  } else {
+    lshift(x, &t[m], m, 1u);
+    x[0] |= t[m - ((size_t) 1)] >> 63;
+    *ex += ey + ((int64_t) (m << 6)) - ((int64_t) 1);
+  }
+}
+
+/* Encloses 10^E as p * 2^e <= 10^E < (p + u) * 2^e, where p has m 
+   digits and its most significant bit set.
+*/
+static void __power_of_ten_enclosure(uint64_t *p, int64_t *e, uint64_t *u,
+				     size_t m, uint64_t E) {
+  uint64_t *b;
+  uint64_t *t;
+  int64_t eb;
+  int k;
+
+  /* b = 10 = 0xa * 2^(64 * m - 4) * 2^-(64 * m - 4), exactly */
+  b = __alloc_mem(m, sizeof(*b));
+  t = __alloc_mem(m << 1, sizeof(*t));
+  b[m - ((size_t) 1)] = ((uint64_t) 10) << 60;
+  eb = ((int64_t) 4) - ((int64_t) (m << 6));
+
+  /* p = 1 */
+  __m_memset(p, 0, m, sizeof(*p));
+  p[m - ((size_t) 1)] = ((uint64_t) 1) << 63;
+  *e = ((int64_t) 1) - ((int64_t) (m << 6));
+
+  /* Left-to-right binary powering */
+  for (k=63;k>=0;k--) {
+    if ((E >> k) != ((uint64_t) 0)) {
+      __truncated_multiplication(p, e, p, *e, m, t);
+      if (((E >> k) & ((uint64_t) 1)) != ((uint64_t) 0)) {
+	__truncated_multiplication(p, e, b, eb, m, t);
+      }
+    }
+  }
+  *u = ((uint64_t) 5) * E + ((uint64_t) 5);
+
+  __free_mem(b);
+  __free_mem(t);
+}
+
+/* Returns the sign of x * 2^ex - y * 2^ey, where x has nx digits
+   and y has ny digits.
+*/
+static int __compare_scaled(const uint64_t *x, size_t nx, int64_t ex,
+			    const uint64_t *y, size_t ny, int64_t ey) {
+  uint64_t *t;
+  int64_t bx, by, d;
+  size_t n, w;
+  int res;
+
+  for (;(nx>((size_t) 0)) && (x[nx - ((size_t) 1)] == ((uint64_t) 0));nx--);
+  for (;(ny>((size_t) 0)) && (y[ny - ((size_t) 1)] == ((uint64_t) 0));ny--);
+  if (nx == ((size_t) 0)) return (ny == ((size_t) 0)) ? 0 : -1;
+  if (ny == ((size_t) 0)) return 1;
+
+  /* Compare the positions of the most significant bits first */
+  bx = ((int64_t) bit_length(x, nx)) + ex;
+  by = ((int64_t) bit_length(y, ny)) + ey;
+  if (bx != by) return (bx > by) ? 1 : -1;
+
+  /* Same position: align the one with the greater exponent on the
+     other and compare digit by digit. 
+  */
+  if (ex < ey) return -__compare_scaled(y, ny, ey, x, nx, ex);
+  d = ex - ey;
+  w = (size_t) (d >> 6);
+  n = ((nx + w + ((size_t) 1)) > ny) ? (nx + w + ((size_t) 1)) : ny;
+  t = __alloc_mem(n << 1, sizeof(*t));
+  __m_memcpy(&t[w], x, nx, sizeof(*t));
+  lshift(&t[w], &t[w], nx + ((size_t) 1), (unsigned int) (d & ((int64_t) 63)));
+  __m_memcpy(&t[n], y, ny, sizeof(*t));
+  res = comparison(t, &t[n], n);
+  __free_mem(t);
+
+  return res;
+}
+
+/* Returns the sign of a - 10^E, where a has n digits */
+static int __compare_power_of_ten(const uint64_t *a, size_t n, uint64_t E) {
+  uint64_t p[MAGNITUDE_PRECISION + ((size_t) 1)];
+  uint64_t *t;
+  const uint64_t *h;
+  int64_t e, s;
+  uint64_t u, one;
+  size_t m, nh, nt;
+  int res;
+
+  /* a is enclosed by h * 2^s <= a < (h + 1) * 2^s, exactly if all of
+     a is in h
+  */
+  m = MAGNITUDE_PRECISION;
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  nh = (n < (m + ((size_t) 1))) ? n : (m + ((size_t) 1));
+  h = &a[n - nh];
+  s = (int64_t) ((n - nh) << 6);
+
+  __power_of_ten_enclosure(p, &e, &u, m, E);
+  p[m] = (uint64_t) 0;
+
+  /* (h + 1) * 2^s <= p * 2^e implies a < 10^E */
+  t = __alloc_mem(nh + ((size_t) 1), sizeof(*t));
+  one = (uint64_t) 1;
+  addition(t, h, nh, &one, (size_t) 1);
+  t[nh] = (uint64_t) (comparison(t, h, nh) < 0);
+  res = __compare_scaled(t, nh + ((size_t) 1), s, p, m, e);
+  __free_mem(t);
+  if (res <= 0) return -1;
+
+  /* h * 2^s >= (p + u) * 2^e implies a > 10^E */
+  addition(p, p, m + ((size_t) 1), &u, (size_t) 1);
+  if (__compare_scaled(h, nh, s, p, m + ((size_t) 1), e) >= 0) return 1;
+
+  /* a is too close to 10^E: compare exactly */
+  t = __radix_power_any(&nt, __radix(10u), (size_t) E);
+  res = __compare_scaled(a, n, (int64_t) 0, t, nt, (int64_t) 0);
+  __free_mem(t);
+
+  return res;
+}
+
+/* Returns the number of decimal digits of a, which has n digits.
+
+   Zero has one decimal digit. If n is zero, 0 is returned. 
+
+   The count is estimated from the bit length of a, which gives it up
+   to one, and corrected by comparing a with a power of ten.
+
+*/
+uint64_t decimal_digit_count(const uint64_t *a, size_t n) {
+  uint64_t bits, d, lo;
+
+  if (n == ((size_t) 0)) return (uint64_t) 0;
+  bits = bit_length(a, n);
+  if (bits == ((uint64_t) 0)) return (uint64_t) 1;
+
+  /* 2^(bits - 1) <= a has floor((bits - 1) * log10(2)) + 1 digits.
+     The constant is rounded down, so this may be one too small.
+  */
+  __multiply_digits(&d, &lo, bits - ((uint64_t) 1), MAGNITUDE_LOG10_2);
+  d++;
+
+  /* Correct d such that 10^(d - 1) <= a < 10^d */
+  while (__compare_power_of_ten(a, n, d) >= 0) d++;
+  while ((d > ((uint64_t) 1)) &&
+	 (__compare_power_of_ten(a, n, d - ((uint64_t) 1)) < 0)) d--;
+
+  return d;
+}
+
+/* Returns an approximation of the decimal logarithm of a, which has
+   n digits, with a relative error of about 2^-52.
+
+   Returns -HUGE_VAL if a is zero.
+
+*/
+double log10_approx(const uint64_t *a, size_t n) {
+  uint64_t bits, h;
+  unsigned int s;
+  size_t i;
+
+  bits = bit_length(a, n);
+  if (bits == ((uint64_t) 0)) return -HUGE_VAL;
+
+  /* a is about h * 2^(bits - 64), where h are the 64 most significant
+     bits of a.
+  */
+  i = (size_t) ((bits - ((uint64_t) 1)) >> 6);
+  s = (unsigned int) (((uint64_t) 64) - (bits & ((uint64_t) 63))) & 63u;
+  h = a[i] << s;
+  if ((s != 0u) && (i > ((size_t) 0))) h |= a[i - ((size_t) 1)] >> (64u - s);
+  return log10((double) h) +
+    ((double) (((int64_t) bits) - ((int64_t) 64))) * 0.301029995663981195213738894724493;
+}
+
+/* str becomes the k leading decimal digits of a, which has n digits,
+   truncated, or all decimal digits of a if a has at most k of them.
+
+   str needs to have room for k + 1 characters.
+
+   Returns the number of digits written.
+
+   With D the number of decimal digits of a, the leading digits are 
+   floor(a / 10^(D - k)). They are obtained from the most significant
+   digits of a and an enclosure of 10^(D - k) on about k / 19 digits,
+   so that the cost depends on k, not on n.
+
+   If the enclosure does not determine the quotient, which needs a
+   long run of nines or zeros after the k-th digit, it leaves two
+   candidates c - 1 and c. The quotient is c if a >= c * 10^(D - k),
+   which is decided by building the exact power, multiplying it by
+   the short c and comparing from the most significant digit down. In
+   that case, the cost is O(M(n)), which is the worst case, and it
+   happens for 10^N, 10^N - 1 and exact multiples of 10^(D - k).
+
+*/
+size_t leading_decimal_digits(char *str, size_t k, const uint64_t *a, size_t n) {
+  uint64_t *p;
+  uint64_t *num;
+  uint64_t *den;
+  uint64_t *qlo;
+  uint64_t *qhi;
+  const uint64_t *h;
+  uint64_t D, u, one;
+  int64_t e, s, t;
+  size_t m, nh, nn, nd, nq, w;
+
+  str[0] = '\0';
+  if ((k == ((size_t) 0)) || (n == ((size_t) 0))) return (size_t) 0;
+
+  /* Short enough integers are converted entirely */
+  D = decimal_digit_count(a, n);
+  if (D <= ((uint64_t) k)) {
+    convert_to_decimal_string(str, a, n);
+    return (size_t) D;
+  }
+
+  /* Enclose 10^(D - k) and take the most significant digits of a */
+  m = k / DECIMAL_CHUNK_DIGITS + MAGNITUDE_PRECISION;
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  nh = (n < (m + ((size_t) 1))) ? n : (m + ((size_t) 1));
+  h = &a[n - nh];
+  s = (int64_t) ((n - nh) << 6);
+  p = __alloc_mem(m + ((size_t) 1), sizeof(*p));
+  __power_of_ten_enclosure(p, &e, &u, m, D - ((uint64_t) k));
+
+  /* The quotient lies between
+     
+     floor(h * 2^(s - e) / (p + u)) and floor((h + 1) * 2^(s - e) / p),
+
+     where the power of two goes to the numerator or the denominator,
+     depending on its sign. The quotient is less than 10^k.
+  */
+  t = s - e;
+  w = (size_t) (((t < ((int64_t) 0)) ? -t : t) >> 6) + ((size_t) 1);
+  nn = nh + ((size_t) 1) + ((t > ((int64_t) 0)) ? w : ((size_t) 0));
+  nd = m + ((size_t) 1) + ((t < ((int64_t) 0)) ? w : ((size_t) 0));
+  nq = (nn > nd) ? nn : nd;
+  num = __alloc_mem(nn, sizeof(*num));
+  den = __alloc_mem(nd, sizeof(*den));
+  qlo = __alloc_mem(nq, sizeof(*qlo));
+  qhi = __alloc_mem(nq, sizeof(*qhi));
+  one = (uint64_t) 1;
+
+  /* Lower bound */
+  __m_memcpy(num, h, nh, sizeof(*num));
+  __m_memcpy(den, p, m, sizeof(*den));
+  addition(den, den, m + ((size_t) 1), &u, (size_t) 1);
+  if (t > ((int64_t) 0)) {
+    shift_left(num, nn, (size_t) t);
+  } else {
+    shift_left(den, nd, (size_t) -t);
+  }
+  division(qlo, NULL, num, nn, den, nd);
+
+  /* Upper bound, unless h is all of a */
+  if (s == ((int64_t) 0)) {
+    __m_memset(num, 0, nn, sizeof(*num));
+    __m_memcpy(num, h, nh, sizeof(*num));
+  } else {
+    __m_memset(num, 0, nn, sizeof(*num));
+    addition(num, h, nh, &one, (size_t) 1);
+    num[nh] = (uint64_t) (comparison(num, h, nh) < 0);
+  }
+  __m_memset(den, 0, nd, sizeof(*den));
+  __m_memcpy(den, p, m, sizeof(*den));
+  if (t > ((int64_t) 0)) {
+    shift_left(num, nn, (size_t) t);
+  } else {
+    shift_left(den, nd, (size_t) -t);
+  }
+  division(qhi, NULL, num, nn, den, nd);
+  __free_mem(num);
+  __free_mem(den);
+  __free_mem(p);
+
+  /* If the bounds differ by one, the quotient is qhi if a >= qhi *
+     10^(D - k) and qlo otherwise. In the unlikely case that they
+     differ by more, divide exactly.
+  */
+  if (comparison(qlo, qhi, nq) != 0) {
+    p = __radix_power_any(&nd, __radix(10u), (size_t) (D - ((uint64_t) k)));
+    num = __alloc_mem(nq + nd, sizeof(*num));
+    subtraction(num, qhi, nq, qlo, nq);
+    if ((num[0] == one) && is_zero(&num[1], nq - ((size_t) 1))) {
+      multiplication(num, qhi, nq, p, nd);
+      if (__compare_scaled(a, n, (int64_t) 0, num, nq + nd, (int64_t) 0) >= 0) {
+	__m_memcpy(qlo, qhi, nq, sizeof(*qlo));
+      }
+    } else {
+      __free_mem(qlo);
+      qlo = __alloc_mem(n, sizeof(*qlo));
+      division(qlo, NULL, a, n, p, nd);
+      nq = n;
+    }
+    __free_mem(num);
+    __free_mem(p);
+  }
+  convert_to_decimal_string(str, qlo, nq);
+  __free_mem(qlo);
+  __free_mem(qhi);
+
+  return k;
+}
+
+/* Conversion in power-of-two radices
+
+   In radix 2^k, every character stands for k bits of the integer, so
+   conversion is a single linear pass that moves bits between limbs
+   and characters, without any multiplication, division or allocation.
+
+   k goes from 1 to 6, i.e. from binary to base 64. Unless a different
+   alphabet is given, characters are taken from
+
+   0123456789abcdefghijklmnopqrstuvwxyz 
+
+   for k up to 5, in which case upper case letters are accepted on
+   input as well, and from the RFC 4648 base64 alphabet for k = 6.
+
+*/
+static const char __pow2_digits_base64[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Returns the default alphabet for radix 2^k */
+static inline const char *__pow2_default_alphabet(unsigned int k) {
+  if (k == 6u) return __pow2_digits_base64;
+  return __radix_digits_lower;
+}
+
+/* Returns the k bits of a starting at bit pos, where bits beyond
+   64 * n are zero and k is at most 64.
+*/
+static inline uint64_t __extract_bits(const uint64_t *a, size_t n,
+				      uint64_t pos, unsigned int k) {
+  size_t w;
+  unsigned int s;
+  uint64_t res;
+
+  w = (size_t) (pos >> 6);
+  s = (unsigned int) (pos & ((uint64_t) 63));
+  if (w >= n) return (uint64_t) 0;
+  res = a[w] >> s;
+  if ((s != 0u) && ((s + k) > 64u) && ((w + ((size_t) 1)) < n)) {
+    res |= a[w + ((size_t) 1)] << (64u - s);
+  }
+  if (k < 64u) res &= (((uint64_t) 1) << k) - ((uint64_t) 1);
+  return res;
+}
+
+/* Sets the table rev, indexed by character, to the value of that
+   character in radix 2^k, or to 0xff for characters that are not
+   digits.
+*/
+static inline void __pow2_reverse_alphabet(unsigned char *rev, unsigned int k,
+					   const char *alphabet) {
+  unsigned int i, r;
+  unsigned char c;
+
+  r = 1u << k;
+  memset(rev, 0xff, (size_t) 256);
+  if (alphabet == NULL) {
+    alphabet = __pow2_default_alphabet(k);
+    if (k < 6u) {
+      for (i=10u;i<r;i++) {
+	rev[(unsigned char) (alphabet[i] - 'a' + 'A')] = (unsigned char) i;
+      }
+    }
+  }
+  for (i=0u;i<r;i++) {
+    c = (unsigned char) alphabet[i];
+    rev[c] = (unsigned char) i;
+  }
+}
+
+/* str becomes the representation of a in radix 2^k, without leading
+   zeros. 
+
+   The characters are taken from alphabet, which must hold at least 2^k
+   characters, or from the default alphabet if alphabet is NULL.
+
+   If a is zero, str is set to the first character of the alphabet. If
+   n is zero, str is set to the empty string.
+
+   str needs to have room for ceil(64 * n / k) + 1 characters.
+
+   Does nothing if k is not in 1 .. 6.
+
+*/
+void convert_to_string_pow2(char *str, const uint64_t *a, size_t n,
+			    unsigned int k, const char *alphabet) {
+  uint64_t bits, len, i, pos;
+
+  if ((k < 1u) || (k > 6u)) return;
+  if (alphabet == NULL) alphabet = __pow2_default_alphabet(k);
+
   /* If n is zero, set str to the empty string */
   if (n == ((size_t) 0)) {
     str[0] = '\0';
     return;
   }
 
-  /* If a is zero, set str to the string "0" */
-  if (is_zero(a, n)) {
-    str[0] = '0';
-    str[1] = '\0';
-    return;
+  /* Get the number of characters, which is at least one */
+  bits = bit_length(a, n);
+  len = (bits + ((uint64_t) (k - 1u))) / ((uint64_t) k);
+  if (len == ((uint64_t) 0)) len = (uint64_t) 1;
+
+  /* Write the characters, most significant first */
+  for (i=0,pos=(len - ((uint64_t) 1)) * ((uint64_t) k);
+       i<len;
+       i++,pos-=((uint64_t) k)) {
+    str[i] = alphabet[__extract_bits(a, n, pos, k)];
   }
+  str[len] = '\0';
+}
+
+/* a becomes the value of the radix 2^k string str mod 2^(64 * n)
+
+   The characters are taken from alphabet, which must hold at least 2^k
+   distinct characters, or from the default alphabet if alphabet is
+   NULL.
 
-  /* a is not zero. 
+   Returns 0 if success
+   Returns -1 if str is empty, contains characters that are not in the
+   alphabet or if k is not in 1 .. 6. 
+
+   The string is checked completely before a gets touched.
 
-     Allocate space for two temporaries t and q.
+*/
+int convert_from_string_pow2(uint64_t *a, size_t n, const char *str,
+			     unsigned int k, const char *alphabet) {
+  unsigned char rev[256];
+  size_t len, i, w;
+  uint64_t acc, d;
+  unsigned int s;
+
+  if ((k < 1u) || (k > 6u)) return -1;
+  __pow2_reverse_alphabet(rev, k, alphabet);
+
+  /* Check the string, which also gives us its length */
+  for (len=0;str[len]!='\0';len++) {
+    if (rev[(unsigned char) str[len]] == ((unsigned char) 0xff)) return -1;
+  }
+  if (len == ((size_t) 0)) return -1;
 
+  /* Move the characters into the digits of a, least significant
+     first. acc holds the bits of the digit w that are set so far, the
+     next bits go to position s.
   */
-  t = __alloc_mem(n, sizeof(*t));
-  q = __alloc_mem(n, sizeof(*q));
+  w = (size_t) 0;
+  s = 0u;
+  acc = (uint64_t) 0;
+  for (i=len;(i>((size_t) 0)) && (w<n);i--) {
+    d = (uint64_t) rev[(unsigned char) str[i - ((size_t) 1)]];
+    acc |= d << s;
+    s += k;
+    if (s >= 64u) {
+      a[w] = acc;
+      w++;
+      s -= 64u;
+      acc = (s == 0u) ? ((uint64_t) 0) : (d >> (k - s));
+    }
+  }
+  if (w < n) {
+    a[w] = acc;
+    w++;
+    __m_memset(&a[w], 0, n - w, sizeof(*a));
+  }
 
-  /* Copy a into t */
-  __m_memcpy(t, a, n, sizeof(*t));
+  /* Indicate success */
+  return 0;
+}
 
-  /* Loop until t is zero. */
-  i = (size_t) 0;
-  while (!is_zero(t, n)) {
-    /* Divide t by 10, put quotient into q,
-       remainder into r.
-    */
-    divide_by_ten(q, &r, t, n);
+/* str becomes the hexadecimal string, in lower case, corresponding to
+   a.
+
+   str needs to have room for 16 * n + 1 characters.
+
+*/
+void convert_to_hex_string(char *str, const uint64_t *a, size_t n) {
+  convert_to_string_pow2(str, a, n, 4u, NULL);
+}
 
-    /* Copy q into t */
-    __m_memcpy(t, q, n, sizeof(*t));
+/* a becomes what is in the hexadecimal string mod 2^(64 * n)
 
-    /* Convert remainder to a digit */
-    str[i] = (char) (((int) r) + ((int) '0'));
-    i++;
+   Both lower and upper case letters are accepted.
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int convert_from_hex_string(uint64_t *a, size_t n, const char *str) {
+  return convert_from_string_pow2(a, n, str, 4u, NULL);
+}
+
+/* Returns 1 if the processor stores 64 bit words least significant
+   byte first, 0 otherwise.
+*/
+static inline int __little_endian_host(void) {
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+  return (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+#else
+  uint64_t x;
+
+  x = (uint64_t) 1;
+  return (int) *((unsigned char *) &x);
+#endif
+}
+
+/* Writes a mod 2^(8 * len) to the len bytes at bytes, most significant
+   byte first if big_endian is non-zero, least significant byte first
+   otherwise. Bytes beyond the 8 * n bytes of a are set to zero.
+
+*/
+void convert_to_bytes(unsigned char *bytes, size_t len,
+		      const uint64_t *a, size_t n, int big_endian) {
+  size_t m, i, j;
+  uint64_t w;
+  
+  /* Number of bytes that come from a */
+  m = ((len >> 3) >= n) ? (n << 3) : len;
+
+  /* On a little endian processor, the little endian order is the
+     order of a in memory. 
+  */
+  if ((!big_endian) && __little_endian_host()) {
+    memcpy(bytes, a, m);
+    memset(&bytes[m], 0, len - m);
+    return;
   }
-  /* Set end marker in string */
-  str[i] = '\0';
 
-  /* Reverse string of length i */
-  for (k=0,i--;k<i;k++,i--) {
-    c = str[k];
-    str[k] = str[i];
-    str[i] = c;
+  for (i=0;i<m;i+=j) {
+    w = a[i >> 3];
+    for (j=0;(j<((size_t) 8)) && ((i + j) < m);j++) {
+      if (big_endian) {
+	bytes[len - ((size_t) 1) - (i + j)] = (unsigned char) w;
+      } else {
+	bytes[i + j] = (unsigned char) w;
+      }
+      w >>= 8;
+    }
+  }
+  if (big_endian) {
+    memset(bytes, 0, len - m);
+  } else {
+    memset(&bytes[m], 0, len - m);
   }
-  
-  /* Free the temporaries */
-  __free_mem(t);
-  __free_mem(q);
 }
 
-/* Returns the number of leading zero bits in a 64 bit integer.
+/* a becomes the value of the len bytes at bytes mod 2^(64 * n), where
+   the most significant byte comes first if big_endian is non-zero and
+   the least significant one otherwise.
 
-   If the integer is zero, 64 is returned.
-   
 */
-static inline uint64_t __leading_zeros_uint64(uint64_t a) {
-  uint64_t res, t;
-  
-  if (a == ((uint64_t) 0)) return (uint64_t) 64;
+void convert_from_bytes(uint64_t *a, size_t n,
+			const unsigned char *bytes, size_t len, int big_endian) {
+  size_t m, i, j;
+  uint64_t w;
 
-  res = (uint64_t) 0;
-  for (t=a;
-       (t & (((uint64_t) 1) << 63)) == ((uint64_t) 0);
-       t<<=1) {
-    res++;
+  /* Number of bytes that go to a */
+  m = ((len >> 3) >= n) ? (n << 3) : len;
+
+  __m_memset(a, 0, n, sizeof(*a));
+  if ((!big_endian) && __little_endian_host()) {
+    memcpy(a, bytes, m);
+    return;
+  }
+
+  for (i=0;i<m;i+=j) {
+    w = (uint64_t) 0;
+    for (j=0;(j<((size_t) 8)) && ((i + j) < m);j++) {
+      if (big_endian) {
+	w |= ((uint64_t) bytes[len - ((size_t) 1) - (i + j)]) << (j << 3);
+      } else {
+	w |= ((uint64_t) bytes[i + j]) << (j << 3);
+      }
+    }
+    a[i >> 3] = w;
   }
-  return res;
 }
 
 /* Returns the number of leading zero bits in the integer a of size n.
@@ -1411,3 +4217,402 @@ uint64_t leading_zeros(const uint64_t *a, size_t n) {
   return res;
 }
 
+/* Returns the number of trailing zero bits in the integer a of size n.
+   
+   If a is zero, 64 * n is returned.
+   If n is zero, 0 is returned.
+
+*/
+uint64_t trailing_zeros(const uint64_t *a, size_t n) {
+  uint64_t res;
+  size_t i;
+
+  res = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    if (a[i] != ((uint64_t) 0)) break;
+    res += (uint64_t) 64;
+  }
+  if (i < n) {
+    res += __trailing_zeros_uint64(a[i]);
+  }
+  return res;
+}
+
+/* Returns the number of bits set in the integer a of size n. 
+
+   The digits are processed four at a time, so that the compiler can
+   keep four independent population counts in flight.
+
+*/
+uint64_t popcount(const uint64_t *a, size_t n) {
+  uint64_t r0, r1, r2, r3;
+  size_t i;
+
+  r0 = (uint64_t) 0;
+  r1 = (uint64_t) 0;
+  r2 = (uint64_t) 0;
+  r3 = (uint64_t) 0;
+  for (i=0;i+((size_t) 4)<=n;i+=((size_t) 4)) {
+    r0 += __popcount_uint64(a[i]);
+    r1 += __popcount_uint64(a[i+((size_t) 1)]);
+    r2 += __popcount_uint64(a[i+((size_t) 2)]);
+    r3 += __popcount_uint64(a[i+((size_t) 3)]);
+  }
+  for (;i<n;i++) {
+    r0 += __popcount_uint64(a[i]);
+  }
+  return r0 + r1 + r2 + r3;
+}
+
+/* Returns the number of bits needed to write the integer a of size n,
+   i.e. the position of its most significant bit set, plus one.
+
+   If a is zero, 0 is returned.
+
+*/
+uint64_t bit_length(const uint64_t *a, size_t n) {
+  size_t i, k;
+
+  for (i=n-((size_t) 1),k=n;k>((size_t) 0);k--,i--) {
+    if (a[i] != ((uint64_t) 0)) {
+      return (((uint64_t) i) << 6) +
+	((uint64_t) 64) - __leading_zeros_uint64(a[i]);
+    }
+  }
+  return (uint64_t) 0;
+}
+
+/* Returns 1 if bit k of the integer a of size n is set, 0 otherwise.
+
+   Bits beyond 64 * n are considered to be zero.
+
+*/
+int test_bit(const uint64_t *a, size_t n, uint64_t k) {
+  uint64_t w;
+
+  w = k >> 6;
+  if (w >= ((uint64_t) n)) return 0;
+  return (int) ((a[w] >> (k & ((uint64_t) 63))) & ((uint64_t) 1));
+}
+
+/* Sets bit k of the integer a of size n.
+
+   Does nothing if k is not less than 64 * n.
+
+*/
+void set_bit(uint64_t *a, size_t n, uint64_t k) {
+  uint64_t w;
+
+  w = k >> 6;
+  if (w >= ((uint64_t) n)) return;
+  a[w] |= ((uint64_t) 1) << (k & ((uint64_t) 63));
+}
+
+/* Clears bit k of the integer a of size n.
+
+   Does nothing if k is not less than 64 * n.
+
+*/
+void clear_bit(uint64_t *a, size_t n, uint64_t k) {
+  uint64_t w;
+
+  w = k >> 6;
+  if (w >= ((uint64_t) n)) return;
+  a[w] &= ~(((uint64_t) 1) << (k & ((uint64_t) 63)));
+}
+
+/* Limb-wise logical operations
+
+   All operands and the result have size n. The result may be the same
+   array as any of the operands.
+
+   The digits are processed by vectors of four, which the compiler
+   maps onto the widest vector registers it has been allowed to
+   use. Unaligned arrays are fine, as the vectors are loaded and stored
+   with memcpy.
+
+*/
+typedef uint64_t __limb_vector_t __attribute__ ((vector_size (32)));
+
+#define LIMB_VECTOR_SIZE ((size_t) (sizeof(__limb_vector_t) / sizeof(uint64_t)))
+
+/* r = a & b */
+void bitwise_and(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n) {
+  __limb_vector_t va, vb;
+  size_t i;
+
+  for (i=0;i+LIMB_VECTOR_SIZE<=n;i+=LIMB_VECTOR_SIZE) {
+    memcpy(&va, &a[i], sizeof(va));
+    memcpy(&vb, &b[i], sizeof(vb));
+    va &= vb;
+    memcpy(&r[i], &va, sizeof(va));
+  }
+  for (;i<n;i++) {
+    r[i] = a[i] & b[i];
+  }
+}
+
+/* r = a | b */
+void bitwise_or(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n) {
+  __limb_vector_t va, vb;
+  size_t i;
+
+  for (i=0;i+LIMB_VECTOR_SIZE<=n;i+=LIMB_VECTOR_SIZE) {
+    memcpy(&va, &a[i], sizeof(va));
+    memcpy(&vb, &b[i], sizeof(vb));
+    va |= vb;
+    memcpy(&r[i], &va, sizeof(va));
+  }
+  for (;i<n;i++) {
+    r[i] = a[i] | b[i];
+  }
+}
+
+/* r = a ^ b */
+void bitwise_xor(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n) {
+  __limb_vector_t va, vb;
+  size_t i;
+
+  for (i=0;i+LIMB_VECTOR_SIZE<=n;i+=LIMB_VECTOR_SIZE) {
+    memcpy(&va, &a[i], sizeof(va));
+    memcpy(&vb, &b[i], sizeof(vb));
+    va ^= vb;
+    memcpy(&r[i], &va, sizeof(va));
+  }
+  for (;i<n;i++) {
+    r[i] = a[i] ^ b[i];
+  }
+}
+
+/* r = a & ~b */
+void bitwise_andnot(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n) {
+  __limb_vector_t va, vb;
+  size_t i;
+
+  for (i=0;i+LIMB_VECTOR_SIZE<=n;i+=LIMB_VECTOR_SIZE) {
+    memcpy(&va, &a[i], sizeof(va));
+    memcpy(&vb, &b[i], sizeof(vb));
+    va &= ~vb;
+    memcpy(&r[i], &va, sizeof(va));
+  }
+  for (;i<n;i++) {
+    r[i] = a[i] & ~b[i];
+  }
+}
+
+/* r = ~a */
+void bitwise_not(uint64_t *r, const uint64_t *a, size_t n) {
+  __limb_vector_t va;
+  size_t i;
+
+  for (i=0;i+LIMB_VECTOR_SIZE<=n;i+=LIMB_VECTOR_SIZE) {
+    memcpy(&va, &a[i], sizeof(va));
+    va = ~va;
+    memcpy(&r[i], &va, sizeof(va));
+  }
+  for (;i<n;i++) {
+    r[i] = ~a[i];
+  }
+}
+
+/* Batch operations
+
+   A batch is an array of independent operations. Every operation is
+   given an estimate of its cost, and the operations are sorted by
+   decreasing cost. Then every thread of the pool takes the next
+   operation in that order until none is left. Starting with the most
+   expensive operations and handing out the others one by one keeps
+   the threads busy until the end.
+
+   Each operation is computed by the thread that takes it. Its
+   temporaries come from that thread's scratch memory, which is kept
+   from one operation to the next.
+
+*/
+typedef struct {
+  double cost;
+  size_t index;
+} __batch_item_t;
+
+typedef struct {
+  __batch_item_t *items;
+  size_t         count;
+  size_t         next;
+  void           (*run)(void *ops, size_t i);
+  void           *ops;
+} __batch_t;
+
+/* Returns an estimate of the cost of multiplying m digits by n
+   digits: max(m, n) * min(m, n)^(log2(3) - 1), as for Karatsuba.
+*/
+static inline double __batch_cost(size_t m, size_t n) {
+  double s, l;
+
+  s = (double) ((m < n) ? m : n);
+  l = (double) ((m < n) ? n : m);
+  if (s < 1.0) return 0.0;
+  return l * pow(s, 0.5849625007211562);
+}
+
+/* Orders batch items by decreasing cost */
+static int __batch_compare(const void *x, const void *y) {
+  const __batch_item_t *a = (const __batch_item_t *) x;
+  const __batch_item_t *b = (const __batch_item_t *) y;
+
+  if (a->cost > b->cost) return -1;
+  if (a->cost < b->cost) return 1;
+  if (a->index < b->index) return -1;
+  if (a->index > b->index) return 1;
+  return 0;
+}
+
+/* Runs operations of batch until there are none left */
+static void __batch_worker(void *arg) {
+  __batch_t *batch = (__batch_t *) arg;
+  size_t i;
+
+  for (;;) {
+    i = __atomic_fetch_add(&batch->next, (size_t) 1, __ATOMIC_RELAXED);
+    if (i >= batch->count) break;
+    batch->run(batch->ops, batch->items[i].index);
+  }
+}
+
+/* Runs all operations of batch, whose items have their costs set, on
+   the threads of the pool
+*/
+static void __batch_execute(__batch_t *batch) {
+  thread_task_t *tasks;
+  size_t t, i;
+
+  if (batch->count == ((size_t) 0)) return;
+  qsort(batch->items, batch->count, sizeof(*batch->items), __batch_compare);
+  batch->next = (size_t) 0;
+
+  /* One task per thread besides the current one */
+  t = (size_t) utepnum_get_threads();
+  if (t > batch->count) t = batch->count;
+  t--;
+  tasks = __alloc_mem(t + ((size_t) 1), sizeof(*tasks));
+  for (i=0;i<t;i++) {
+    thread_pool_fork(&tasks[i], __batch_worker, batch);
+  }
+  __batch_worker(batch);
+  for (i=t;i>((size_t) 0);i--) {
+    thread_pool_join(&tasks[i - ((size_t) 1)]);
+  }
+  __free_mem(tasks);
+}
+
+static void __multiplication_batch_run(void *ops, size_t i) {
+  multiplication_desc_t *op = &((multiplication_desc_t *) ops)[i];
+
+  multiplication(op->p, op->a, op->m, op->b, op->n);
+}
+
+static void __division_batch_run(void *ops, size_t i) {
+  division_desc_t *op = &((division_desc_t *) ops)[i];
+
+  op->result = division(op->q, op->r, op->a, op->m, op->b, op->n);
+}
+
+static void __convert_to_decimal_string_batch_run(void *ops, size_t i) {
+  decimal_string_desc_t *op = &((decimal_string_desc_t *) ops)[i];
+
+  convert_to_decimal_string(op->str, op->a, op->n);
+}
+
+static void __convert_from_decimal_string_batch_run(void *ops, size_t i) {
+  decimal_string_desc_t *op = &((decimal_string_desc_t *) ops)[i];
+
+  op->result = convert_from_decimal_string(op->a, op->n, op->str);
+}
+
+/* Computes ops[i].p = ops[i].a * ops[i].b for i = 0 .. count - 1, as
+   multiplication does, spreading the products over the threads of
+   the pool.
+*/
+void multiplication_batch(multiplication_desc_t *ops, size_t count) {
+  __batch_t batch;
+  size_t i;
+
+  batch.items = __alloc_mem(count + ((size_t) 1), sizeof(*batch.items));
+  for (i=0;i<count;i++) {
+    batch.items[i].cost = __batch_cost(ops[i].m, ops[i].n);
+    batch.items[i].index = i;
+  }
+  batch.count = count;
+  batch.run = __multiplication_batch_run;
+  batch.ops = ops;
+  __batch_execute(&batch);
+  __free_mem(batch.items);
+}
+
+/* Divides ops[i].a by ops[i].b for i = 0 .. count - 1, as division
+   does, spreading the divisions over the threads of the pool.
+
+   ops[i].result is set to what division returns.
+
+*/
+void division_batch(division_desc_t *ops, size_t count) {
+  __batch_t batch;
+  size_t i;
+
+  batch.items = __alloc_mem(count + ((size_t) 1), sizeof(*batch.items));
+  for (i=0;i<count;i++) {
+    batch.items[i].cost = (ops[i].m > ops[i].n) ?
+      __batch_cost(ops[i].m - ops[i].n + ((size_t) 1), ops[i].n) :
+      (double) ops[i].n;
+    batch.items[i].index = i;
+  }
+  batch.count = count;
+  batch.run = __division_batch_run;
+  batch.ops = ops;
+  __batch_execute(&batch);
+  __free_mem(batch.items);
+}
+
+/* Converts ops[i].a, on ops[i].n digits, to the decimal string
+   ops[i].str for i = 0 .. count - 1, as convert_to_decimal_string
+   does, spreading the conversions over the threads of the pool.
+*/
+void convert_to_decimal_string_batch(decimal_string_desc_t *ops, size_t count) {
+  __batch_t batch;
+  size_t i;
+
+  batch.items = __alloc_mem(count + ((size_t) 1), sizeof(*batch.items));
+  for (i=0;i<count;i++) {
+    batch.items[i].cost = __batch_cost(ops[i].n, ops[i].n) *
+      log2((double) ops[i].n + 2.0);
+    batch.items[i].index = i;
+  }
+  batch.count = count;
+  batch.run = __convert_to_decimal_string_batch_run;
+  batch.ops = ops;
+  __batch_execute(&batch);
+  __free_mem(batch.items);
+}
+
+/* Converts the decimal strings ops[i].str to ops[i].a, on ops[i].n
+   digits, for i = 0 .. count - 1, as convert_from_decimal_string
+   does, spreading the conversions over the threads of the pool.
+
+   ops[i].result is set to what convert_from_decimal_string returns.
+
+*/
+void convert_from_decimal_string_batch(decimal_string_desc_t *ops, size_t count) {
+  __batch_t batch;
+  size_t i;
+
+  batch.items = __alloc_mem(count + ((size_t) 1), sizeof(*batch.items));
+  for (i=0;i<count;i++) {
+    batch.items[i].cost = __batch_cost(ops[i].n, ops[i].n) *
+      log2((double) ops[i].n + 2.0);
+    batch.items[i].index = i;
+  }
+  batch.count = count;
+  batch.run = __convert_from_decimal_string_batch_run;
+  batch.ops = ops;
+  __batch_execute(&batch);
+  __free_mem(batch.items);
+}
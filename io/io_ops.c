@@ -0,0 +1,769 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter 
+                   
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include "integer_ops.h"
+#include "widefloat_ops.h"
+#include "io_ops.h"
+
+/* Helper functions */
+
+static inline void *__alloc_mem(size_t nmemb, size_t size) {
+  void *ptr;
+
+  ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(errno));
+    exit(1);
+  }
+  
+  return ptr;
+}
+
+static inline void __free_mem(void *ptr) {
+  free(ptr);
+}
+
+/* Returns a non-zero value if c is white space */
+static inline int __is_space(char c) {
+  return ((c == ' ') || (c == '\t') || (c == '\n') ||
+	  (c == '\r') || (c == '\v') || (c == '\f'));
+}
+
+/* Reading decimal integers from files
+
+   The integer is read as a stream of pieces of characters that are
+   handed over to convert_from_string_base_stream, which parses them by
+   blocks and merges the blocks as it goes. The integer may be
+   preceded and followed by white space, such as a final newline.
+
+   In read() mode, pieces are read into a buffer of IO_READ_BUFFER
+   bytes. In mmap() mode, the whole file is mapped and handed over as
+   a single piece, so that no characters get copied.
+
+*/
+#define IO_READ_BUFFER ((size_t) 65536)
+
+typedef struct {
+  int        fd;
+  char       *buf;
+  const char *data;
+  size_t     len;
+  int        started;
+  int        trailing;
+} __io_reader_t;
+
+/* Sets the variables pointed to by str and len to the next piece of
+   the integer in the already read characters of reader. 
+
+   Returns 1 if there is such a piece, 0 if all characters have been
+   consumed and -1 if there are characters after the trailing white
+   space.
+
+*/
+static int __io_reader_piece(__io_reader_t *reader, const char **str, size_t *len) {
+  size_t i;
+
+  /* Skip leading white space */
+  if (!reader->started) {
+    for (;(reader->len > ((size_t) 0)) && __is_space(reader->data[0]);reader->data++,reader->len--);
+    if (reader->len == ((size_t) 0)) return 0;
+    reader->started = 1;
+  }
+
+  /* After the integer, there may only be white space */
+  if (reader->trailing) {
+    for (i=0;i<reader->len;i++) {
+      if (!__is_space(reader->data[i])) return -1;
+    }
+    reader->len = (size_t) 0;
+    return 0;
+  }
+
+  /* The piece ends at the first white space character */
+  if (reader->len == ((size_t) 0)) return 0;
+  for (i=0;(i<reader->len) && (!__is_space(reader->data[i]));i++);
+  if (i < reader->len) reader->trailing = 1;
+  *str = reader->data;
+  *len = i;
+  reader->data += i;
+  reader->len -= i;
+  if (i == ((size_t) 0)) return __io_reader_piece(reader, str, len);
+  return 1;
+}
+
+/* Source for convert_from_string_base_stream in mmap() mode */
+static int __io_mapped_source(void *arg, const char **str, size_t *len) {
+  return __io_reader_piece((__io_reader_t *) arg, str, len);
+}
+
+/* Source for convert_from_string_base_stream in read() mode */
+static int __io_read_source(void *arg, const char **str, size_t *len) {
+  __io_reader_t *reader;
+  ssize_t r;
+  int res;
+
+  reader = (__io_reader_t *) arg;
+  for (;;) {
+    res = __io_reader_piece(reader, str, len);
+    if (res != 0) return res;
+
+    /* Everything consumed, read more */
+    do {
+      r = read(reader->fd, reader->buf, IO_READ_BUFFER);
+    } while ((r < ((ssize_t) 0)) && (errno == EINTR));
+    if (r < ((ssize_t) 0)) return -1;
+    if (r == ((ssize_t) 0)) return 0;
+    reader->data = reader->buf;
+    reader->len = (size_t) r;
+  }
+}
+
+/* Sets the variable pointed to by a to a freshly allocated integer
+   holding the value of the decimal representation in the len
+   characters at data, which may be surrounded by white space, and the
+   variable pointed to by n to its size.
+
+   The integer must be freed with free().
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int read_decimal_mapped(uint64_t **a, size_t *n,
+			const char *data, size_t len) {
+  __io_reader_t reader;
+
+  memset(&reader, 0, sizeof(reader));
+  reader.fd = -1;
+  reader.data = data;
+  reader.len = len;
+  return convert_from_string_base_stream(a, n, 10u, len,
+					 __io_mapped_source, &reader);
+}
+
+/* Sets the variable pointed to by a to a freshly allocated integer
+   holding the value of the decimal representation read from fd, which
+   may be surrounded by white space, and the variable pointed to by n
+   to its size.
+
+   The integer must be freed with free().
+
+   size_hint is the expected number of characters, or zero if
+   unknown.
+
+   In IO_MODE_MMAP mode, fd is mapped into memory. If fd cannot be
+   mapped, e.g. because it is a pipe, it is read like in IO_MODE_READ
+   mode, with read() calls into a bounded buffer.
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int read_decimal_fd(uint64_t **a, size_t *n, int fd,
+		    size_t size_hint, iomode_t mode) {
+  __io_reader_t reader;
+  struct stat st;
+  void *map;
+  size_t len;
+  off_t pos;
+  int res;
+
+  if (mode == IO_MODE_MMAP) {
+    /* Map what is left of the file from the current position */
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) &&
+	((pos = lseek(fd, 0, SEEK_CUR)) >= ((off_t) 0)) &&
+	(st.st_size > pos)) {
+      len = (size_t) (st.st_size - pos);
+      map = mmap(NULL, len + ((size_t) pos), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+	madvise(map, len + ((size_t) pos), MADV_SEQUENTIAL);
+	res = read_decimal_mapped(a, n, ((const char *) map) + pos, len);
+	munmap(map, len + ((size_t) pos));
+	if (res == 0) lseek(fd, st.st_size, SEEK_SET);
+	return res;
+      }
+    }
+  }
+
+  memset(&reader, 0, sizeof(reader));
+  reader.fd = fd;
+  reader.buf = __alloc_mem(IO_READ_BUFFER, sizeof(*(reader.buf)));
+  res = convert_from_string_base_stream(a, n, 10u, size_hint,
+					__io_read_source, &reader);
+  __free_mem(reader.buf);
+
+  return res;
+}
+
+/* Writing decimal integers to files
+
+   The characters come from convert_to_string_base_stream in blocks of
+   IO_WRITE_BLOCK characters, most significant first, so that no
+   string of the whole length is ever built.
+
+   For file descriptors, IO_WRITE_BATCH blocks are collected and
+   written with a single writev() call. For FILE * streams, every block
+   goes to fwrite() as stdio does its own buffering.
+
+*/
+#define IO_WRITE_BLOCK ((size_t) 65536)
+#define IO_WRITE_BATCH ((size_t) 16)
+
+typedef struct {
+  int          fd;
+  FILE         *file;
+  char         *buf;
+  struct iovec iov[IO_WRITE_BATCH];
+  size_t       count;
+} __io_writer_t;
+
+/* Writes the count buffers in iov to fd, handling short writes.
+   Returns 0 on success and -1 on error.
+*/
+static int __io_writev_all(int fd, struct iovec *iov, size_t count) {
+  ssize_t r;
+  size_t w;
+
+  while (count > ((size_t) 0)) {
+    do {
+      r = writev(fd, iov, (int) count);
+    } while ((r < ((ssize_t) 0)) && (errno == EINTR));
+    if (r < ((ssize_t) 0)) return -1;
+
+    /* Skip what has been written */
+    w = (size_t) r;
+    while ((count > ((size_t) 0)) && (w >= iov->iov_len)) {
+      w -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > ((size_t) 0)) {
+      iov->iov_base = ((char *) iov->iov_base) + w;
+      iov->iov_len -= w;
+    }
+  }
+  return 0;
+}
+
+/* Sink for convert_to_string_base_stream writing to a file
+   descriptor
+*/
+static char *__io_fd_sink(void *arg, char *str, size_t len) {
+  __io_writer_t *writer;
+
+  writer = (__io_writer_t *) arg;
+  if (str != NULL) {
+    writer->iov[writer->count].iov_base = str;
+    writer->iov[writer->count].iov_len = len;
+    writer->count++;
+    if (writer->count == IO_WRITE_BATCH) {
+      if (__io_writev_all(writer->fd, writer->iov, writer->count) < 0) return NULL;
+      writer->count = (size_t) 0;
+    }
+  }
+  return &writer->buf[writer->count * IO_WRITE_BLOCK];
+}
+
+/* Sink for convert_to_string_base_stream writing to a FILE * stream */
+static char *__io_file_sink(void *arg, char *str, size_t len) {
+  __io_writer_t *writer;
+
+  writer = (__io_writer_t *) arg;
+  if (str != NULL) {
+    if (fwrite(str, sizeof(*str), len, writer->file) != len) return NULL;
+  }
+  return writer->buf;
+}
+
+/* Writes the decimal representation of a, which has n digits, to fd,
+   without any leading zeros or trailing newline.
+
+   Memory use is bounded by IO_WRITE_BATCH * IO_WRITE_BLOCK characters
+   plus about twice the size of a.
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int write_decimal_fd(int fd, const uint64_t *a, size_t n) {
+  __io_writer_t writer;
+  int res;
+
+  memset(&writer, 0, sizeof(writer));
+  writer.fd = fd;
+  writer.buf = __alloc_mem(IO_WRITE_BATCH * IO_WRITE_BLOCK, sizeof(*(writer.buf)));
+  res = convert_to_string_base_stream(a, n, 10u, IO_WRITE_BLOCK,
+				      __io_fd_sink, &writer);
+  if ((res == 0) && (writer.count > ((size_t) 0))) {
+    res = __io_writev_all(writer.fd, writer.iov, writer.count);
+  }
+  __free_mem(writer.buf);
+
+  return res;
+}
+
+/* Same as write_decimal_fd, but writes to the stream f */
+int write_decimal_file(FILE *f, const uint64_t *a, size_t n) {
+  __io_writer_t writer;
+  int res;
+
+  memset(&writer, 0, sizeof(writer));
+  writer.fd = -1;
+  writer.file = f;
+  writer.buf = __alloc_mem(IO_WRITE_BLOCK, sizeof(*(writer.buf)));
+  res = convert_to_string_base_stream(a, n, 10u, IO_WRITE_BLOCK,
+				      __io_file_sink, &writer);
+  __free_mem(writer.buf);
+
+  return res;
+}
+
+/* Binary container format
+
+   Integers and widefloats are saved as records of a 64 byte header
+   followed by the limbs, padded with zeros to a multiple of 64 bytes.
+   A file may hold any number of records, one after the other. As every
+   record starts at a multiple of 64 bytes, so does every payload,
+   which lets readers map a file and hand out pointers to the limbs
+   inside the mapping without copying them.
+
+   All fields are in the byte order of the machine that wrote the
+   record, which is given by the endianness field. Records written on
+   a machine of a different byte order are refused by the readers.
+
+   A record holds:
+
+   magic       "UTEPNUM" followed by a null character
+   version     BINARY_VERSION
+   kind        BINARY_KIND_INTEGER or BINARY_KIND_WIDEFLOAT
+   endianness  BINARY_LITTLE_ENDIAN or BINARY_BIG_ENDIAN
+   flags       zero for now, readers refuse flags they do not know
+   size        number of limbs of the payload
+   exponent    for widefloats, the exponent, zero otherwise
+   fpclass     for widefloats, the class, zero otherwise
+   sign        for widefloats, the sign, zero otherwise
+
+*/
+#define BINARY_ALIGNMENT      ((size_t) 64)
+#define BINARY_VERSION        ((uint16_t) 1)
+#define BINARY_KIND_INTEGER   ((uint8_t) 1)
+#define BINARY_KIND_WIDEFLOAT ((uint8_t) 2)
+#define BINARY_LITTLE_ENDIAN  ((uint8_t) 1)
+#define BINARY_BIG_ENDIAN     ((uint8_t) 2)
+
+static const char __binary_magic[8] = { 'U', 'T', 'E', 'P', 'N', 'U', 'M', '\0' };
+
+typedef struct {
+  char     magic[8];
+  uint16_t version;
+  uint8_t  kind;
+  uint8_t  endianness;
+  uint32_t flags;
+  uint64_t size;
+  int64_t  exponent;
+  uint32_t fpclass;
+  uint32_t sign;
+  uint8_t  reserved[24];
+} __binary_header_t;
+
+/* The header must take exactly one alignment unit */
+typedef char __binary_header_size_check[(sizeof(__binary_header_t) == BINARY_ALIGNMENT) ? 1 : -1];
+
+/* Returns the endianness of the machine in the format of the header */
+static inline uint8_t __binary_endianness(void) {
+  uint64_t x;
+
+  x = (uint64_t) 1;
+  return (*((unsigned char *) &x) != 0) ? BINARY_LITTLE_ENDIAN : BINARY_BIG_ENDIAN;
+}
+
+/* Writes a record with the header h and the h->size limbs at a to fd.
+
+   fd must be at a multiple of 64 bytes if it is seekable.
+
+   Returns 0 on success and -1 on error.
+
+*/
+static int __binary_write_record(int fd, __binary_header_t *h, const uint64_t *a) {
+  static const char zeros[BINARY_ALIGNMENT] = { 0 };
+  struct iovec iov[3];
+  size_t len, pad;
+  off_t pos;
+
+  pos = lseek(fd, 0, SEEK_CUR);
+  if ((pos >= ((off_t) 0)) &&
+      ((((size_t) pos) % BINARY_ALIGNMENT) != ((size_t) 0))) return -1;
+
+  memcpy(h->magic, __binary_magic, sizeof(h->magic));
+  h->version = BINARY_VERSION;
+  h->endianness = __binary_endianness();
+  h->flags = (uint32_t) 0;
+
+  len = ((size_t) h->size) * sizeof(*a);
+  pad = (BINARY_ALIGNMENT - (len % BINARY_ALIGNMENT)) % BINARY_ALIGNMENT;
+  iov[0].iov_base = h;
+  iov[0].iov_len = sizeof(*h);
+  iov[1].iov_base = (void *) a;
+  iov[1].iov_len = len;
+  iov[2].iov_base = (void *) zeros;
+  iov[2].iov_len = pad;
+
+  return __io_writev_all(fd, iov, (size_t) 3);
+}
+
+/* Appends the integer a, which has n digits, to fd as a record of the
+   binary container format.
+
+   Returns 0 if success
+   Returns -1 if failure, including if fd is seekable and not at a
+   multiple of 64 bytes
+
+*/
+int write_binary_integer(int fd, const uint64_t *a, size_t n) {
+  __binary_header_t h;
+
+  memset(&h, 0, sizeof(h));
+  h.kind = BINARY_KIND_INTEGER;
+  h.size = (uint64_t) n;
+  return __binary_write_record(fd, &h, a);
+}
+
+/* Appends the widefloat x to fd as a record of the binary container
+   format.
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int write_binary_widefloat(int fd, const widefloat_t *x) {
+  __binary_header_t h;
+
+  memset(&h, 0, sizeof(h));
+  h.kind = BINARY_KIND_WIDEFLOAT;
+  h.size = (uint64_t) x->mantissa_size;
+  h.exponent = (int64_t) x->exponent;
+  h.fpclass = (uint32_t) x->fpclass;
+  h.sign = (uint32_t) x->sign;
+  return __binary_write_record(fd, &h, x->mantissa);
+}
+
+/* Maps the whole file fd into memory for reading records.
+
+   The mapping is private: limbs handed out by the readers may be
+   written to, which makes the system copy the touched pages, but
+   such writes never reach the file.
+
+   Returns 0 if success
+   Returns -1 if failure
+
+*/
+int binary_map_open(binary_map_t *map, int fd) {
+  struct stat st;
+  void *p;
+
+  map->base = NULL;
+  map->length = (size_t) 0;
+  map->offset = (size_t) 0;
+  if (fstat(fd, &st) != 0) return -1;
+  if (st.st_size == ((off_t) 0)) return 0;
+  p = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) return -1;
+  map->base = p;
+  map->length = (size_t) st.st_size;
+  return 0;
+}
+
+/* Unmaps the file mapped by binary_map_open. Limbs handed out by the
+   readers become invalid.
+*/
+void binary_map_close(binary_map_t *map) {
+  if (map->base != NULL) munmap(map->base, map->length);
+  map->base = NULL;
+  map->length = (size_t) 0;
+  map->offset = (size_t) 0;
+}
+
+/* Checks the next record of map, which must be of the given kind,
+   and moves past it. 
+
+   Returns its header and sets the variable pointed to by payload to
+   its limbs, or returns NULL if there is no such record.
+
+*/
+static const __binary_header_t *__binary_map_next(binary_map_t *map, uint8_t kind,
+						  uint64_t **payload) {
+  const __binary_header_t *h;
+  size_t avail, len;
+
+  if (map->offset >= map->length) return NULL;
+  avail = map->length - map->offset;
+  if (avail < sizeof(*h)) return NULL;
+  h = (const __binary_header_t *) (((char *) map->base) + map->offset);
+  if (memcmp(h->magic, __binary_magic, sizeof(h->magic)) != 0) return NULL;
+  if (h->endianness != __binary_endianness()) return NULL;
+  if (h->version != BINARY_VERSION) return NULL;
+  if (h->flags != ((uint32_t) 0)) return NULL;
+  if (h->kind != kind) return NULL;
+  if (h->size > ((uint64_t) ((avail - sizeof(*h)) / sizeof(**payload)))) return NULL;
+
+  len = ((size_t) h->size) * sizeof(**payload);
+  len = (len + BINARY_ALIGNMENT - ((size_t) 1)) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+  *payload = (uint64_t *) (((char *) map->base) + map->offset + sizeof(*h));
+  map->offset += sizeof(*h) + len;
+  return h;
+}
+
+/* Reads the next record of map, which must be an integer, without
+   copying it: sets the variable pointed to by a to its limbs inside
+   the mapping and the variable pointed to by n to its size.
+
+   Returns 0 if success
+   Returns -1 if there is no next record or if it is no integer
+
+*/
+int binary_map_integer(binary_map_t *map, uint64_t **a, size_t *n) {
+  const __binary_header_t *h;
+  uint64_t *p;
+
+  h = __binary_map_next(map, BINARY_KIND_INTEGER, &p);
+  if (h == NULL) return -1;
+  *a = p;
+  *n = (size_t) h->size;
+  return 0;
+}
+
+/* Reads the next record of map, which must be a widefloat, without
+   copying it: x gets its mantissa pointed to the limbs inside the
+   mapping.
+
+   x must not be initialized nor be cleared with widefloat_clear.
+
+   Returns 0 if success
+   Returns -1 if there is no next record or if it is no widefloat
+
+*/
+int binary_map_widefloat(binary_map_t *map, widefloat_t *x) {
+  const __binary_header_t *h;
+  uint64_t *p;
+
+  h = __binary_map_next(map, BINARY_KIND_WIDEFLOAT, &p);
+  if (h == NULL) return -1;
+  if ((h->fpclass > ((uint32_t) FP_CLASS_NUMBER)) ||
+      (h->sign > ((uint32_t) 1)) ||
+      (h->exponent < ((int64_t) INT32_MIN)) ||
+      (h->exponent > ((int64_t) INT32_MAX))) return -1;
+  x->fpclass = (widefloatclass_t) h->fpclass;
+  x->sign = (unsigned int) h->sign;
+  x->exponent = (int32_t) h->exponent;
+  x->mantissa_size = (size_t) h->size;
+  x->mantissa = p;
+  return 0;
+}
+
+
+/* Out-of-core multiplication
+
+   The operands a and b are read from files and the product is written
+   to a file, all through shared mappings, so that neither the operands
+   nor the product need to fit into memory.
+
+   a and b are cut into tiles of T digits, with T chosen such that a
+   pair of tiles, their product and the temporaries of the in-memory
+   multiplication take about the given amount of memory. The product
+   is computed by product scanning over the tiles: for k = 0, 1, ...,
+   all products a_i * b_j with i + j = k are added into an accumulator
+   of 2 * T + 2 digits, after which the T least significant digits of
+   the accumulator are final. They are written to the product's
+   mapping, and the accumulator is shifted down by T digits.
+
+   So the product is written strictly sequentially. Every tile is
+   handed back to the kernel with MADV_DONTNEED once it has been
+   multiplied, and the tiles of the next pair are announced with
+   MADV_WILLNEED while the current pair gets multiplied, so the
+   resident memory stays bounded and reading overlaps with computing.
+
+   This costs about (m / T) * (n / T) multiplications on T digits, so
+   the less memory is given, the slower it gets, without ever failing
+   for lack of memory.
+
+*/
+#define OOC_MEMORY_DEFAULT ((size_t) 268435456)
+#define OOC_MEMORY_FACTOR ((size_t) 32)
+
+/* Sets the variables pointed to by start and len to the range of
+   whole pages that holds the n digits at a
+*/
+static inline void __ooc_pages(void **start, size_t *len, const uint64_t *a, size_t n) {
+  uintptr_t page, s, e;
+
+  page = (uintptr_t) sysconf(_SC_PAGESIZE);
+  s = ((uintptr_t) a) / page * page;
+  e = ((uintptr_t) (a + n) + page - ((uintptr_t) 1)) / page * page;
+  *start = (void *) s;
+  *len = (size_t) (e - s);
+}
+
+/* Applies advice to the pages that hold n digits at a */
+static inline void __ooc_advise(const uint64_t *a, size_t n, int advice) {
+  void *start;
+  size_t len;
+
+  if (n == ((size_t) 0)) return;
+  __ooc_pages(&start, &len, a, n);
+  madvise(start, len, advice);
+}
+
+/* Starts the write-back of the pages that hold n digits at a and
+   drops them from the resident memory
+*/
+static inline void __ooc_write_back(uint64_t *a, size_t n) {
+  void *start;
+  size_t len;
+
+  if (n == ((size_t) 0)) return;
+  __ooc_pages(&start, &len, a, n);
+  msync(start, len, MS_ASYNC);
+  madvise(start, len, MADV_DONTNEED);
+}
+
+/* Maps n digits of the file fd, for writing if writable is non-zero.
+
+   Returns NULL if the mapping fails or if the file is too short.
+
+*/
+static uint64_t *__ooc_map(int fd, size_t n, int writable) {
+  struct stat st;
+  void *ptr;
+
+  if (fstat(fd, &st) < 0) return NULL;
+  if ((n > ((size_t) SIZE_MAX) / sizeof(uint64_t)) ||
+      (((uint64_t) st.st_size) < ((uint64_t) n) * ((uint64_t) sizeof(uint64_t)))) return NULL;
+  ptr = mmap(NULL, n * sizeof(uint64_t),
+	     writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+	     MAP_SHARED, fd, (off_t) 0);
+  if (ptr == MAP_FAILED) return NULL;
+  return (uint64_t *) ptr;
+}
+
+/* p = a * b, with a on m digits, b on n digits and p on m + n digits,
+   all mapped from files, by product scanning over tiles of T digits.
+*/
+static void __ooc_multiplication(uint64_t *p, const uint64_t *a, size_t m,
+				 const uint64_t *b, size_t n, size_t T) {
+  uint64_t *acc;
+  uint64_t *prod;
+  size_t na, nb, nacc, k, i, j, i0, i1, ta, tb, l, q;
+
+  q = m + n;
+  na = (m + T - ((size_t) 1)) / T;
+  nb = (n + T - ((size_t) 1)) / T;
+  nacc = ((size_t) 2) * T + ((size_t) 2);
+  acc = __alloc_mem(nacc, sizeof(*acc));
+  prod = __alloc_mem(((size_t) 2) * T, sizeof(*prod));
+  for (k=0;k<na+nb-((size_t) 1);k++) {
+    /* acc = acc + sum of a_i * b_j for i + j = k */
+    i0 = (k >= nb) ? (k - nb + ((size_t) 1)) : ((size_t) 0);
+    i1 = (k < na) ? k : (na - ((size_t) 1));
+    for (i=i0;i<=i1;i++) {
+      j = k - i;
+      ta = ((i + ((size_t) 1)) * T <= m) ? T : (m - i * T);
+      tb = ((j + ((size_t) 1)) * T <= n) ? T : (n - j * T);
+      if (i < i1) {
+	__ooc_advise(&a[(i + ((size_t) 1)) * T], T, MADV_WILLNEED);
+	__ooc_advise(&b[(j - ((size_t) 1)) * T], T, MADV_WILLNEED);
+      }
+      multiplication(prod, &a[i * T], ta, &b[j * T], tb);
+      addition(acc, acc, nacc, prod, ta + tb);
+      __ooc_advise(&a[i * T], ta, MADV_DONTNEED);
+      __ooc_advise(&b[j * T], tb, MADV_DONTNEED);
+    }
+
+    /* The T least significant digits of acc are final */
+    l = (k * T + T <= q) ? T : (q - k * T);
+    memcpy(&p[k * T], acc, l * sizeof(*p));
+    __ooc_write_back(&p[k * T], l);
+    memmove(acc, &acc[T], (nacc - T) * sizeof(*acc));
+    memset(&acc[nacc - T], 0, T * sizeof(*acc));
+  }
+
+  /* Write what remains in the accumulator */
+  k = na + nb - ((size_t) 1);
+  if (k * T < q) {
+    memcpy(&p[k * T], acc, (q - k * T) * sizeof(*p));
+    __ooc_write_back(&p[k * T], q - k * T);
+  }
+
+  __free_mem(acc);
+  __free_mem(prod);
+}
+
+/* The file pfd becomes p = a * b, where the file afd holds a on m
+   digits and the file bfd holds b on n digits, stored as arrays of
+   uint64_t starting at offset 0. pfd is set to m + n digits.
+
+   At most about memory bytes of memory are used for the computation,
+   or 256 MiB if memory is zero.
+
+   Returns 0 if success
+   Returns -1 if failure (m or n is zero, a file cannot be mapped, or
+   afd or bfd are too short)
+
+*/
+int multiplication_out_of_core(int pfd, int afd, size_t m, int bfd, size_t n,
+			       size_t memory) {
+  uint64_t *a;
+  uint64_t *b;
+  uint64_t *p;
+  size_t T, align, q;
+  int res;
+
+  if ((m == ((size_t) 0)) || (n == ((size_t) 0))) return -1;
+  q = m + n;
+  if (q < m) return -1;
+
+  /* Get the tile size, a multiple of the page size */
+  if (memory == ((size_t) 0)) memory = OOC_MEMORY_DEFAULT;
+  align = ((size_t) sysconf(_SC_PAGESIZE)) / sizeof(uint64_t);
+  if (align == ((size_t) 0)) align = (size_t) 1;
+  T = memory / (OOC_MEMORY_FACTOR * sizeof(uint64_t)) / align * align;
+  if (T < align) T = align;
+
+  /* Map the operands and the product */
+  if ((ftruncate(pfd, (off_t) 0) < 0) ||
+      (ftruncate(pfd, (off_t) (q * sizeof(uint64_t))) < 0)) return -1;
+  a = __ooc_map(afd, m, 0);
+  b = __ooc_map(bfd, n, 0);
+  p = __ooc_map(pfd, q, 1);
+  res = -1;
+  if ((a != NULL) && (b != NULL) && (p != NULL)) {
+    __ooc_multiplication(p, a, m, b, n, T);
+    res = msync(p, q * sizeof(*p), MS_SYNC);
+  }
+  if (a != NULL) munmap(a, m * sizeof(*a));
+  if (b != NULL) munmap(b, n * sizeof(*b));
+  if (p != NULL) munmap(p, q * sizeof(*p));
+
+  return res;
+}
@@ -0,0 +1,657 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "integer_ops.h"
+#include "thread_pool.h"
+#include "rns_ops.h"
+
+/* Helper functions */
+
+static inline void *__alloc_mem(size_t nmemb, size_t size) {
+  void *ptr;
+
+  ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  return ptr;
+}
+
+static inline void __free_mem(void *ptr) {
+  free(ptr);
+}
+
+/* Residue number system
+
+   An RNS base is a set of k distinct primes p_1, ..., p_k between 2^61
+   and 2^62, with product M. An integer x with 0 <= x < M is
+   represented by its residues x mod p_i. Additions, subtractions and
+   multiplications act on every residue independently, without any
+   carries, so they are computed modulo M. As long as the true result
+   of a chain of operations stays below M, converting back gives it
+   exactly.
+
+   The residues are reduced by Barrett's method: with
+   mu = floor(2^124 / p) and t = x * y < p^2 < 2^124, the quotient
+   estimate floor(floor(t / 2^61) * mu / 2^63) is at most 2 below
+   floor(t / p).
+
+   The conversions use the subproduct tree of the primes: level 0
+   holds the primes, and every node of level j + 1 is the product of
+   two nodes of level j (or a copy of the last one, if their number is
+   odd).
+
+   +  To residues: the integer is reduced modulo both children of the
+      root, the remainders modulo their children, and so on down to
+      the primes (remainder tree).
+
+   +  From residues (Chinese remaindering): with c_i = x_i * ((M / p_i)
+      ^ -1 mod p_i) mod p_i, x = sum of c_i * M / p_i mod M. The sum is
+      computed bottom-up as V = V_0 * P_1 + V_1 * P_0 for a node with
+      children P_0 and P_1, whose sums are V_0 and V_1.
+
+   Both cost O(M(n) log(n)), where M(n) is the cost of multiplication,
+   and the two subtrees of every node are handled in parallel near the
+   root. The factors (M / p_i) mod p_i are computed once, by the same
+   kind of descent: (M / P_0) mod P_0 = ((M / P) mod P_0) * (P_1 mod
+   P_0) mod P_0 for a node P with children P_0 and P_1.
+
+*/
+#define RNS_PRIME_MIN ((uint64_t) 0x2000000000000000ull)
+#define RNS_PRIME_MAX ((uint64_t) 0x4000000000000000ull)
+#define RNS_PRIME_BITS ((uint64_t) 61)
+
+/* Nodes with at most this number of primes reduce integers modulo
+   each of their primes directly
+*/
+#define RNS_TREE_BASECASE ((size_t) 16)
+
+/* From this number of digits on, the subtrees of a node are handled
+   in parallel
+*/
+#define RNS_TREE_PARALLEL_THRESHOLD ((size_t) 256)
+
+/* From this number of residues on, the operations on residues are
+   spread over the threads of the pool
+*/
+#define RNS_PARALLEL_THRESHOLD ((size_t) 4096)
+
+typedef struct {
+  uint64_t *value;
+  size_t   size;
+} __rns_node_t;
+
+typedef struct {
+  size_t       levels;
+  size_t       *counts;
+  __rns_node_t **nodes;
+} __rns_tree_t;
+
+/* Returns floor(2^124 / p) for 2^61 < p < 2^62 */
+static inline uint64_t __rns_barrett(uint64_t p) {
+  return (uint64_t) ((((unsigned __int128) 1) << 124) / ((unsigned __int128) p));
+}
+
+/* Returns x * y mod p, where x, y < p, with mu = floor(2^124 / p) */
+static inline uint64_t __rns_mulmod(uint64_t x, uint64_t y, uint64_t p, uint64_t mu) {
+  unsigned __int128 t;
+  uint64_t q, r;
+
+  t = ((unsigned __int128) x) * ((unsigned __int128) y);
+  q = (uint64_t) ((((unsigned __int128) ((uint64_t) (t >> 61))) * ((unsigned __int128) mu)) >> 63);
+  r = ((uint64_t) t) - q * p;
+  if (r >= p) r -= p;
+  if (r >= p) r -= p;
+  return r;
+}
+
+/* Returns x^e mod p, where x < p */
+static inline uint64_t __rns_powmod(uint64_t x, uint64_t e, uint64_t p, uint64_t mu) {
+  uint64_t r;
+
+  r = (uint64_t) 1;
+  for (;e!=((uint64_t) 0);e>>=1) {
+    if ((e & ((uint64_t) 1)) != ((uint64_t) 0)) r = __rns_mulmod(r, x, p, mu);
+    x = __rns_mulmod(x, x, p, mu);
+  }
+  return r;
+}
+
+/* Returns 1 if n, with 2^61 < n < 2^62, is prime, 0 otherwise.
+
+   Small factors are found by trial division. The rest is decided by
+   the Miller-Rabin test with a set of bases that is known to have no
+   strong pseudoprime below 2^64.
+
+*/
+static int __rns_is_prime(uint64_t n) {
+  static const uint64_t small[] = { 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41,
+				    43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97 };
+  static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+  uint64_t d, x, a, mu;
+  unsigned int s, i, j;
+
+  if ((n & ((uint64_t) 1)) == ((uint64_t) 0)) return 0;
+  for (i=0u;i<sizeof(small)/sizeof(small[0]);i++) {
+    if ((n % small[i]) == ((uint64_t) 0)) return 0;
+  }
+
+  mu = __rns_barrett(n);
+  d = n - ((uint64_t) 1);
+  for (s=0u;(d & ((uint64_t) 1)) == ((uint64_t) 0);s++,d>>=1);
+  for (i=0u;i<sizeof(bases)/sizeof(bases[0]);i++) {
+    a = bases[i] % n;
+    if (a == ((uint64_t) 0)) continue;
+    x = __rns_powmod(a, d, n, mu);
+    if ((x == ((uint64_t) 1)) || (x == n - ((uint64_t) 1))) continue;
+    for (j=1u;j<s;j++) {
+      x = __rns_mulmod(x, x, n, mu);
+      if (x == n - ((uint64_t) 1)) break;
+    }
+    if (j >= s) return 0;
+  }
+  return 1;
+}
+
+/* Returns a freshly allocated copy of a mod the value of node, on
+   node->size digits
+*/
+static uint64_t *__rns_mod(const uint64_t *a, size_t n, const __rns_node_t *node) {
+  uint64_t *r;
+
+  r = __alloc_mem(node->size, sizeof(*r));
+  division(NULL, r, a, n, node->value, node->size);
+  return r;
+}
+
+/* Returns the number of significant digits of a, which has n digits */
+static inline size_t __rns_size(const uint64_t *a, size_t n) {
+  for (;(n>((size_t) 0)) && (a[n - ((size_t) 1)] == ((uint64_t) 0));n--);
+  return n;
+}
+
+/* Builds the subproduct tree of the primes of base */
+static __rns_tree_t *__rns_tree_build(const rns_base_t *base) {
+  __rns_tree_t *tree;
+  __rns_node_t *c0;
+  __rns_node_t *c1;
+  __rns_node_t *node;
+  size_t levels, count, j, t;
+
+  for (levels=(size_t) 1,count=base->count;count>((size_t) 1);levels++) {
+    count = (count + ((size_t) 1)) >> 1;
+  }
+  tree = __alloc_mem(((size_t) 1), sizeof(*tree));
+  tree->levels = levels;
+  tree->counts = __alloc_mem(levels, sizeof(*tree->counts));
+  tree->nodes = __alloc_mem(levels, sizeof(*tree->nodes));
+
+  tree->counts[0] = base->count;
+  tree->nodes[0] = __alloc_mem(base->count, sizeof(**tree->nodes));
+  for (t=0;t<base->count;t++) {
+    tree->nodes[0][t].value = __alloc_mem(((size_t) 1), sizeof(uint64_t));
+    tree->nodes[0][t].value[0] = base->primes[t];
+    tree->nodes[0][t].size = (size_t) 1;
+  }
+  for (j=1;j<levels;j++) {
+    tree->counts[j] = (tree->counts[j - ((size_t) 1)] + ((size_t) 1)) >> 1;
+    tree->nodes[j] = __alloc_mem(tree->counts[j], sizeof(**tree->nodes));
+    for (t=0;t<tree->counts[j];t++) {
+      node = &tree->nodes[j][t];
+      c0 = &tree->nodes[j - ((size_t) 1)][t << 1];
+      if (((t << 1) + ((size_t) 1)) < tree->counts[j - ((size_t) 1)]) {
+	c1 = &tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)];
+	node->value = __alloc_mem(c0->size + c1->size, sizeof(uint64_t));
+	multiplication(node->value, c0->value, c0->size, c1->value, c1->size);
+	node->size = __rns_size(node->value, c0->size + c1->size);
+      } else {
+	node->value = __alloc_mem(c0->size, sizeof(uint64_t));
+	memcpy(node->value, c0->value, c0->size * sizeof(uint64_t));
+	node->size = c0->size;
+      }
+    }
+  }
+
+  return tree;
+}
+
+/* Frees the subproduct tree */
+static void __rns_tree_free(__rns_tree_t *tree) {
+  size_t j, t;
+
+  for (j=0;j<tree->levels;j++) {
+    for (t=0;t<tree->counts[j];t++) {
+      __free_mem(tree->nodes[j][t].value);
+    }
+    __free_mem(tree->nodes[j]);
+  }
+  __free_mem(tree->counts);
+  __free_mem(tree->nodes);
+  __free_mem(tree);
+}
+
+/* Returns 1 if node t of level j of tree has two children, 0 if it
+   is a copy of its only child
+*/
+static inline int __rns_tree_pair(const __rns_tree_t *tree, size_t j, size_t t) {
+  return (((t << 1) + ((size_t) 1)) < tree->counts[j - ((size_t) 1)]);
+}
+
+/* Arguments of a descent or ascent in the subproduct tree, forked as
+   a task
+*/
+typedef struct {
+  const rns_base_t *base;
+  uint64_t         *out;
+  const uint64_t   *in;
+  size_t           j;
+  size_t           t;
+  const uint64_t   *v;
+  size_t           n;
+  uint64_t         *res;
+  size_t           res_size;
+} __rns_tree_task_t;
+
+/* Sets out[i] to v mod p_i for all primes p_i below node t of level
+   j, where v has n digits.
+*/
+static void __rns_reduce(const rns_base_t *base, uint64_t *out, size_t j, size_t t,
+			 const uint64_t *v, size_t n);
+
+static void __rns_reduce_task(void *arg) {
+  __rns_tree_task_t *task = (__rns_tree_task_t *) arg;
+
+  __rns_reduce(task->base, task->out, task->j, task->t, task->v, task->n);
+}
+
+static void __rns_reduce(const rns_base_t *base, uint64_t *out, size_t j, size_t t,
+			 const uint64_t *v, size_t n) {
+  const __rns_tree_t *tree = (const __rns_tree_t *) base->tree;
+  __rns_tree_task_t args;
+  thread_task_t task;
+  uint64_t *r0;
+  uint64_t *r1;
+  size_t lo, hi, i;
+
+  lo = t << j;
+  hi = (t + ((size_t) 1)) << j;
+  if (hi > base->count) hi = base->count;
+  if ((j == ((size_t) 0)) || ((hi - lo) <= RNS_TREE_BASECASE)) {
+    for (i=lo;i<hi;i++) {
+      out[i] = divrem_1(NULL, v, n, base->primes[i]);
+    }
+    return;
+  }
+  if (!__rns_tree_pair(tree, j, t)) {
+    __rns_reduce(base, out, j - ((size_t) 1), t << 1, v, n);
+    return;
+  }
+
+  r0 = __rns_mod(v, n, &tree->nodes[j - ((size_t) 1)][t << 1]);
+  r1 = __rns_mod(v, n, &tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)]);
+  if ((tree->nodes[j][t].size >= RNS_TREE_PARALLEL_THRESHOLD) &&
+      (utepnum_get_threads() > 1u)) {
+    args.base = base;
+    args.out = out;
+    args.j = j - ((size_t) 1);
+    args.t = (t << 1) + ((size_t) 1);
+    args.v = r1;
+    args.n = tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)].size;
+    thread_pool_fork(&task, __rns_reduce_task, &args);
+    __rns_reduce(base, out, j - ((size_t) 1), t << 1, r0,
+		 tree->nodes[j - ((size_t) 1)][t << 1].size);
+    thread_pool_join(&task);
+  } else {
+    __rns_reduce(base, out, j - ((size_t) 1), t << 1, r0,
+		 tree->nodes[j - ((size_t) 1)][t << 1].size);
+    __rns_reduce(base, out, j - ((size_t) 1), (t << 1) + ((size_t) 1), r1,
+		 tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)].size);
+  }
+  __free_mem(r0);
+  __free_mem(r1);
+}
+
+/* Returns the sum of c_i * P / p_i over the primes p_i below node t of
+   level j, whose value is P, as a freshly allocated integer of the
+   size set in the variable pointed to by n.
+*/
+static uint64_t *__rns_combine(const rns_base_t *base, const uint64_t *c,
+			       size_t j, size_t t, size_t *n);
+
+static void __rns_combine_task(void *arg) {
+  __rns_tree_task_t *task = (__rns_tree_task_t *) arg;
+
+  task->res = __rns_combine(task->base, task->in, task->j, task->t, &task->res_size);
+}
+
+static uint64_t *__rns_combine(const rns_base_t *base, const uint64_t *c,
+			       size_t j, size_t t, size_t *n) {
+  const __rns_tree_t *tree = (const __rns_tree_t *) base->tree;
+  const __rns_node_t *p0;
+  const __rns_node_t *p1;
+  __rns_tree_task_t args;
+  thread_task_t task;
+  uint64_t *v0;
+  uint64_t *v1;
+  uint64_t *w;
+  uint64_t *v;
+  size_t n0, n1, l0, l1, l;
+
+  if (j == ((size_t) 0)) {
+    v = __alloc_mem(((size_t) 1), sizeof(*v));
+    v[0] = c[t];
+    *n = (size_t) 1;
+    return v;
+  }
+  if (!__rns_tree_pair(tree, j, t)) {
+    return __rns_combine(base, c, j - ((size_t) 1), t << 1, n);
+  }
+
+  /* Get the sums of both children */
+  if ((tree->nodes[j][t].size >= RNS_TREE_PARALLEL_THRESHOLD) &&
+      (utepnum_get_threads() > 1u)) {
+    args.base = base;
+    args.in = c;
+    args.j = j - ((size_t) 1);
+    args.t = (t << 1) + ((size_t) 1);
+    thread_pool_fork(&task, __rns_combine_task, &args);
+    v0 = __rns_combine(base, c, j - ((size_t) 1), t << 1, &n0);
+    thread_pool_join(&task);
+    v1 = args.res;
+    n1 = args.res_size;
+  } else {
+    v0 = __rns_combine(base, c, j - ((size_t) 1), t << 1, &n0);
+    v1 = __rns_combine(base, c, j - ((size_t) 1), (t << 1) + ((size_t) 1), &n1);
+  }
+
+  /* v = v0 * P1 + v1 * P0 */
+  p0 = &tree->nodes[j - ((size_t) 1)][t << 1];
+  p1 = &tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)];
+  l0 = n0 + p1->size;
+  l1 = n1 + p0->size;
+  l = ((l0 > l1) ? l0 : l1) + ((size_t) 1);
+  v = __alloc_mem(l, sizeof(*v));
+  w = __alloc_mem(l1, sizeof(*w));
+  multiplication(v, v0, n0, p1->value, p1->size);
+  multiplication(w, v1, n1, p0->value, p0->size);
+  addition(v, v, l, w, l1);
+  __free_mem(v0);
+  __free_mem(v1);
+  __free_mem(w);
+
+  *n = __rns_size(v, l);
+  if (*n == ((size_t) 0)) *n = (size_t) 1;
+  return v;
+}
+
+/* Sets base->cofactors[i] to ((M / p_i) mod p_i)^-1 mod p_i for all
+   primes p_i below node t of level j, whose value is P, where u, on n
+   digits, is (M / P) mod P.
+*/
+static void __rns_cofactors(rns_base_t *base, size_t j, size_t t,
+			    const uint64_t *u, size_t n) {
+  const __rns_tree_t *tree = (const __rns_tree_t *) base->tree;
+  const __rns_node_t *p0;
+  const __rns_node_t *p1;
+  uint64_t *a;
+  uint64_t *b;
+  uint64_t *ab;
+  uint64_t *u0;
+  uint64_t *u1;
+  uint64_t p;
+
+  if (j == ((size_t) 0)) {
+    p = base->primes[t];
+    base->cofactors[t] = __rns_powmod(divrem_1(NULL, u, n, p), p - ((uint64_t) 2),
+				      p, base->barrett[t]);
+    return;
+  }
+  if (!__rns_tree_pair(tree, j, t)) {
+    __rns_cofactors(base, j - ((size_t) 1), t << 1, u, n);
+    return;
+  }
+
+  p0 = &tree->nodes[j - ((size_t) 1)][t << 1];
+  p1 = &tree->nodes[j - ((size_t) 1)][(t << 1) + ((size_t) 1)];
+
+  /* u0 = (u mod P0) * (P1 mod P0) mod P0 */
+  a = __rns_mod(u, n, p0);
+  b = __rns_mod(p1->value, p1->size, p0);
+  ab = __alloc_mem(((size_t) 2) * p0->size, sizeof(*ab));
+  multiplication(ab, a, p0->size, b, p0->size);
+  u0 = __rns_mod(ab, ((size_t) 2) * p0->size, p0);
+  __free_mem(a);
+  __free_mem(b);
+  __free_mem(ab);
+
+  /* u1 = (u mod P1) * (P0 mod P1) mod P1 */
+  a = __rns_mod(u, n, p1);
+  b = __rns_mod(p0->value, p0->size, p1);
+  ab = __alloc_mem(((size_t) 2) * p1->size, sizeof(*ab));
+  multiplication(ab, a, p1->size, b, p1->size);
+  u1 = __rns_mod(ab, ((size_t) 2) * p1->size, p1);
+  __free_mem(a);
+  __free_mem(b);
+  __free_mem(ab);
+
+  __rns_cofactors(base, j - ((size_t) 1), t << 1, u0, p0->size);
+  __rns_cofactors(base, j - ((size_t) 1), (t << 1) + ((size_t) 1), u1, p1->size);
+  __free_mem(u0);
+  __free_mem(u1);
+}
+
+/* Initializes base with enough primes for integers of bits bits, i.e.
+   such that the product M of the primes is greater than 2^bits.
+
+   The primes are the greatest primes below 2^62.
+
+   Returns 0 if success
+   Returns -1 if failure (bits is too great for the available primes)
+
+*/
+int rns_base_init(rns_base_t *base, uint64_t bits) {
+  uint64_t one, c;
+  size_t count, i;
+
+  /* Every prime is greater than 2^61 */
+  if (bits / RNS_PRIME_BITS >= ((uint64_t) (SIZE_MAX / sizeof(uint64_t)))) return -1;
+  count = (size_t) (bits / RNS_PRIME_BITS) + ((size_t) 1);
+
+  base->count = count;
+  base->primes = __alloc_mem(count, sizeof(*base->primes));
+  base->barrett = __alloc_mem(count, sizeof(*base->barrett));
+  base->cofactors = __alloc_mem(count, sizeof(*base->cofactors));
+  c = RNS_PRIME_MAX - ((uint64_t) 1);
+  for (i=0;i<count;i++) {
+    for (;(c > RNS_PRIME_MIN) && (!__rns_is_prime(c));c-=((uint64_t) 2));
+    if (c <= RNS_PRIME_MIN) {
+      __free_mem(base->primes);
+      __free_mem(base->barrett);
+      __free_mem(base->cofactors);
+      return -1;
+    }
+    base->primes[i] = c;
+    base->barrett[i] = __rns_barrett(c);
+    c -= (uint64_t) 2;
+  }
+
+  /* Build the tree and get the cofactors, starting with M / M = 1 */
+  base->tree = __rns_tree_build(base);
+  one = (uint64_t) 1;
+  __rns_cofactors(base, ((__rns_tree_t *) base->tree)->levels - ((size_t) 1),
+		  (size_t) 0, &one, (size_t) 1);
+
+  return 0;
+}
+
+/* Frees the memory used by base */
+void rns_base_clear(rns_base_t *base) {
+  __rns_tree_free((__rns_tree_t *) base->tree);
+  __free_mem(base->primes);
+  __free_mem(base->barrett);
+  __free_mem(base->cofactors);
+  base->tree = NULL;
+  base->count = (size_t) 0;
+}
+
+/* Initializes x as zero in base, which must stay in place as long as
+   x is used
+*/
+void rns_init(rns_t *x, const rns_base_t *base) {
+  x->base = base;
+  x->residues = __alloc_mem(base->count, sizeof(*x->residues));
+}
+
+/* Frees the memory used by x */
+void rns_clear(rns_t *x) {
+  __free_mem(x->residues);
+  x->residues = NULL;
+}
+
+/* x becomes a mod M, where a has n digits */
+void rns_set_integer(rns_t *x, const uint64_t *a, size_t n) {
+  const __rns_tree_t *tree = (const __rns_tree_t *) x->base->tree;
+
+  __rns_reduce(x->base, x->residues, tree->levels - ((size_t) 1), (size_t) 0, a, n);
+}
+
+/* a becomes the integer 0 <= a < M represented by x, mod 2^(64 * n) */
+void rns_get_integer(uint64_t *a, size_t n, const rns_t *x) {
+  const rns_base_t *base = x->base;
+  const __rns_tree_t *tree = (const __rns_tree_t *) base->tree;
+  const __rns_node_t *root;
+  uint64_t *c;
+  uint64_t *v;
+  uint64_t *r;
+  size_t i, nv;
+
+  /* c_i = x_i * cofactor_i mod p_i */
+  c = __alloc_mem(base->count, sizeof(*c));
+  for (i=0;i<base->count;i++) {
+    c[i] = __rns_mulmod(x->residues[i], base->cofactors[i], base->primes[i], base->barrett[i]);
+  }
+
+  /* The sum of c_i * M / p_i, reduced mod M */
+  root = &tree->nodes[tree->levels - ((size_t) 1)][0];
+  v = __rns_combine(base, c, tree->levels - ((size_t) 1), (size_t) 0, &nv);
+  r = __rns_mod(v, nv, root);
+  memset(a, 0, n * sizeof(*a));
+  memcpy(a, r, ((n < root->size) ? n : root->size) * sizeof(*a));
+
+  __free_mem(c);
+  __free_mem(v);
+  __free_mem(r);
+}
+
+/* Operations on residues, spread over the threads of the pool */
+#define RNS_OP_ADD 0
+#define RNS_OP_SUB 1
+#define RNS_OP_MUL 2
+
+typedef struct {
+  int              op;
+  const rns_base_t *base;
+  uint64_t         *r;
+  const uint64_t   *x;
+  const uint64_t   *y;
+  size_t           lo;
+  size_t           hi;
+} __rns_map_t;
+
+/* Applies the operation of arg to the residues lo .. hi - 1 */
+static void __rns_map_range(void *arg) {
+  const __rns_map_t *m = (const __rns_map_t *) arg;
+  const uint64_t *p = m->base->primes;
+  const uint64_t *mu = m->base->barrett;
+  uint64_t s;
+  size_t i;
+
+  switch (m->op) {
+  case RNS_OP_ADD:
+    for (i=m->lo;i<m->hi;i++) {
+      s = m->x[i] + m->y[i];
+      m->r[i] = (s >= p[i]) ? (s - p[i]) : s;
+    }
+    break;
+  case RNS_OP_SUB:
+    for (i=m->lo;i<m->hi;i++) {
+      s = m->x[i] - m->y[i];
+      m->r[i] = (m->x[i] < m->y[i]) ? (s + p[i]) : s;
+    }
+    break;
+  default:
+    for (i=m->lo;i<m->hi;i++) {
+      m->r[i] = __rns_mulmod(m->x[i], m->y[i], p[i], mu[i]);
+    }
+    break;
+  }
+}
+
+/* r = x op y, residue by residue. Does nothing if r, x and y do not
+   have the same base.
+*/
+static void __rns_map(int op, rns_t *r, const rns_t *x, const rns_t *y) {
+  __rns_map_t *ranges;
+  thread_task_t *tasks;
+  size_t count, t, i;
+
+  if ((r->base != x->base) || (r->base != y->base)) return;
+  count = r->base->count;
+  t = (size_t) utepnum_get_threads();
+  if (count < RNS_PARALLEL_THRESHOLD) t = (size_t) 1;
+
+  ranges = __alloc_mem(t, sizeof(*ranges));
+  tasks = __alloc_mem(t, sizeof(*tasks));
+  for (i=0;i<t;i++) {
+    ranges[i].op = op;
+    ranges[i].base = r->base;
+    ranges[i].r = r->residues;
+    ranges[i].x = x->residues;
+    ranges[i].y = y->residues;
+    ranges[i].lo = count * i / t;
+    ranges[i].hi = count * (i + ((size_t) 1)) / t;
+  }
+  for (i=1;i<t;i++) {
+    thread_pool_fork(&tasks[i], __rns_map_range, &ranges[i]);
+  }
+  __rns_map_range(&ranges[0]);
+  for (i=t-((size_t) 1);i>((size_t) 0);i--) {
+    thread_pool_join(&tasks[i]);
+  }
+  __free_mem(ranges);
+  __free_mem(tasks);
+}
+
+/* r = x + y mod M */
+void rns_add(rns_t *r, const rns_t *x, const rns_t *y) {
+  __rns_map(RNS_OP_ADD, r, x, y);
+}
+
+/* r = x - y mod M */
+void rns_sub(rns_t *r, const rns_t *x, const rns_t *y) {
+  __rns_map(RNS_OP_SUB, r, x, y);
+}
+
+/* r = x * y mod M */
+void rns_mul(rns_t *r, const rns_t *x, const rns_t *y) {
+  __rns_map(RNS_OP_MUL, r, x, y);
+}
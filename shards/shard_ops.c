@@ -0,0 +1,427 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "integer_ops.h"
+#include "shard_ops.h"
+
+/* Helper functions */
+
+static inline void *__alloc_mem(size_t nmemb, size_t size) {
+  void *ptr;
+
+  ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  return ptr;
+}
+
+static inline void __free_mem(void *ptr) {
+  free(ptr);
+}
+
+/* Sharded multiplication
+
+   A shard engine is a set of worker processes, each connected to the
+   coordinator by a stream socket. To compute p = a * b, the
+   coordinator places a and b into a POSIX shared memory object, cuts
+   both operands into blocks, so that the grid of block pairs has at
+   most one pair per worker, and sends every worker a request to
+   multiply the two blocks of its pair. The workers map the shared
+   memory object by its name, write their partial products into it
+   and answer. The coordinator then adds the partial products into p
+   at the sums of the offsets of their blocks, propagating the
+   carries.
+
+   The protocol consists of fixed-size messages in native byte order:
+   a request names the shared memory object, its size and where the
+   operands and the partial product are inside it, and the answer
+   gives a status. As everything the workers need is in the request,
+   any process that serves the protocol with shard_worker_serve can be
+   a worker. The engine starts local workers with fork().
+
+*/
+#define SHARD_MAGIC ((uint32_t) 0x53484152)
+#define SHARD_OP_MULTIPLY ((uint32_t) 1)
+#define SHARD_OP_EXIT ((uint32_t) 2)
+#define SHARD_NAME_MAX ((size_t) 64)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t op;
+  char     name[SHARD_NAME_MAX];
+  uint64_t size;
+  uint64_t a_offset;
+  uint64_t a_size;
+  uint64_t b_offset;
+  uint64_t b_size;
+  uint64_t p_offset;
+} __shard_request_t;
+
+typedef struct {
+  uint32_t magic;
+  int32_t  status;
+} __shard_answer_t;
+
+struct __shard_engine_struct_t {
+  unsigned int workers;
+  int          *fds;
+  pid_t        *pids;
+  unsigned int shards;
+};
+
+/* Sends the len bytes at buf over the socket fd.
+
+   Returns 0 if success, -1 otherwise.
+
+*/
+static int __shard_send(int fd, const void *buf, size_t len) {
+  const char *ptr = (const char *) buf;
+  ssize_t res;
+
+  while (len > ((size_t) 0)) {
+    res = send(fd, ptr, len, MSG_NOSIGNAL);
+    if (res < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    ptr += res;
+    len -= (size_t) res;
+  }
+  return 0;
+}
+
+/* Receives exactly len bytes from the socket fd into buf.
+
+   Returns 0 if success, -1 if the connection fails or gets closed.
+
+*/
+static int __shard_receive(int fd, void *buf, size_t len) {
+  char *ptr = (char *) buf;
+  ssize_t res;
+
+  while (len > ((size_t) 0)) {
+    res = recv(fd, ptr, len, 0);
+    if (res < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if (res == 0) return -1;
+    ptr += res;
+    len -= (size_t) res;
+  }
+  return 0;
+}
+
+/* Executes the multiplication request req.
+
+   Returns 0 if success, -1 otherwise.
+
+*/
+static int __shard_multiply(const __shard_request_t *req) {
+  uint64_t *base;
+  size_t size;
+  int fd;
+
+  /* Check that the operands and the product are in the object */
+  if (req->size > ((uint64_t) (SIZE_MAX / sizeof(uint64_t)))) return -1;
+  if ((req->a_size == ((uint64_t) 0)) || (req->b_size == ((uint64_t) 0))) return -1;
+  if ((req->a_offset > req->size) || (req->a_size > req->size - req->a_offset) ||
+      (req->b_offset > req->size) || (req->b_size > req->size - req->b_offset) ||
+      (req->p_offset > req->size) ||
+      (req->a_size + req->b_size > req->size - req->p_offset)) return -1;
+  if (memchr(req->name, '\0', SHARD_NAME_MAX) == NULL) return -1;
+
+  size = ((size_t) req->size) * sizeof(uint64_t);
+  fd = shm_open(req->name, O_RDWR, 0);
+  if (fd < 0) return -1;
+  base = (uint64_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) 0);
+  close(fd);
+  if (base == MAP_FAILED) return -1;
+
+  multiplication(&base[req->p_offset],
+		 &base[req->a_offset], (size_t) req->a_size,
+		 &base[req->b_offset], (size_t) req->b_size);
+
+  munmap(base, size);
+  return 0;
+}
+
+/* Serves the shard protocol on the socket fd until the coordinator
+   asks to exit or closes the connection.
+
+   Returns 0 if the coordinator asked to exit, -1 otherwise.
+
+*/
+int shard_worker_serve(int fd) {
+  __shard_request_t req;
+  __shard_answer_t ans;
+
+  for (;;) {
+    if (__shard_receive(fd, &req, sizeof(req)) < 0) return -1;
+    if (req.magic != SHARD_MAGIC) return -1;
+    if (req.op == SHARD_OP_EXIT) return 0;
+    memset(&ans, 0, sizeof(ans));
+    ans.magic = SHARD_MAGIC;
+    ans.status = (req.op == SHARD_OP_MULTIPLY) ? ((int32_t) __shard_multiply(&req)) : ((int32_t) -1);
+    if (__shard_send(fd, &ans, sizeof(ans)) < 0) return -1;
+  }
+}
+
+/* Asks the workers of engine to exit, closes the connections and
+   waits for the processes. Frees engine.
+*/
+void shard_engine_stop(shard_engine_t *engine) {
+  __shard_request_t req;
+  unsigned int i;
+
+  if (engine == NULL) return;
+  memset(&req, 0, sizeof(req));
+  req.magic = SHARD_MAGIC;
+  req.op = SHARD_OP_EXIT;
+  for (i=0u;i<engine->workers;i++) {
+    __shard_send(engine->fds[i], &req, sizeof(req));
+    close(engine->fds[i]);
+  }
+  for (i=0u;i<engine->workers;i++) {
+    while ((waitpid(engine->pids[i], NULL, 0) < 0) && (errno == EINTR));
+  }
+  __free_mem(engine->fds);
+  __free_mem(engine->pids);
+  __free_mem(engine);
+}
+
+/* Starts a shard engine with the given number of local worker
+   processes, at least one.
+
+   Returns the engine, or NULL if the workers cannot be started.
+
+*/
+shard_engine_t *shard_engine_start(unsigned int workers) {
+  shard_engine_t *engine;
+  int sv[2];
+  unsigned int i, j;
+  pid_t pid;
+
+  if (workers < 1u) workers = 1u;
+  engine = (shard_engine_t *) __alloc_mem(((size_t) 1), sizeof(*engine));
+  engine->fds = (int *) __alloc_mem((size_t) workers, sizeof(*engine->fds));
+  engine->pids = (pid_t *) __alloc_mem((size_t) workers, sizeof(*engine->pids));
+  for (i=0u;i<workers;i++) {
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) break;
+    pid = fork();
+    if (pid < 0) {
+      close(sv[0]);
+      close(sv[1]);
+      break;
+    }
+    if (pid == 0) {
+      /* The worker keeps its end of the connection only */
+      close(sv[0]);
+      for (j=0u;j<i;j++) close(engine->fds[j]);
+      _exit((shard_worker_serve(sv[1]) < 0) ? 1 : 0);
+    }
+    close(sv[1]);
+    engine->fds[i] = sv[0];
+    engine->pids[i] = pid;
+    engine->workers = i + 1u;
+  }
+  if (engine->workers < workers) {
+    shard_engine_stop(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+/* p = p + t, where p has q digits and t has n <= q digits. The sum
+   must hold on q digits.
+*/
+static inline void __shard_add(uint64_t *p, size_t q, const uint64_t *t, size_t n) {
+  uint64_t carry, s, c;
+  size_t i;
+
+  carry = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    s = p[i] + carry;
+    c = (uint64_t) (s < carry);
+    p[i] = s + t[i];
+    carry = c + ((uint64_t) (p[i] < s));
+  }
+  for (;(i<q) && (carry != ((uint64_t) 0));i++) {
+    p[i]++;
+    carry = (uint64_t) (p[i] == ((uint64_t) 0));
+  }
+}
+
+/* Returns the number of shards the last product computed by engine
+   was cut into, 0 if there was none.
+*/
+unsigned int shard_engine_last_shards(const shard_engine_t *engine) {
+  return engine->shards;
+}
+
+/* Chooses the grid for a product of operands of m and n digits on
+   the given number of workers: a is cut into *sa blocks of *la
+   digits and b into *sb blocks of *lb digits, the last blocks being
+   possibly shorter, with *sa * *sb <= workers. The grid minimizes the
+   size *la * *lb of the largest block product, and among equal sizes
+   the difference between *la and *lb, as balanced blocks multiply
+   faster.
+*/
+static void __shard_grid(size_t *sa, size_t *la, size_t *sb, size_t *lb,
+			 size_t m, size_t n, size_t workers) {
+  size_t i, j, k, l, c, d, best, diff;
+
+  best = ((size_t) 0);
+  diff = ((size_t) 0);
+  *sa = (size_t) 1; *la = m;
+  *sb = (size_t) 1; *lb = n;
+  for (j=((size_t) 1);(j<=workers) && (j<=n);j++) {
+    i = workers / j;
+    if (i > m) i = m;
+    k = (m + i - ((size_t) 1)) / i;
+    l = (n + j - ((size_t) 1)) / j;
+    c = k * l;
+    d = (k > l) ? (k - l) : (l - k);
+    if ((best != ((size_t) 0)) && ((c > best) || ((c == best) && (d >= diff)))) continue;
+    best = c;
+    diff = d;
+    *la = k; *sa = (m + k - ((size_t) 1)) / k;
+    *lb = l; *sb = (n + l - ((size_t) 1)) / l;
+  }
+}
+
+/* p = a * b, computed by the workers of engine
+
+   a is on m digits
+   b is on n digits
+
+   p must have m + n digits.
+
+   Both operands are cut into blocks, so that even products of
+   operands of about the same length keep all workers busy. Each
+   shard multiplies one block of a by one block of b.
+
+   An engine computes one product at a time.
+
+   Returns 0 if success
+   Returns -1 if failure (m or n is zero, the shared memory object
+   cannot be created, or a worker fails)
+
+*/
+int multiplication_sharded(shard_engine_t *engine, uint64_t *p,
+			   const uint64_t *a, size_t m,
+			   const uint64_t *b, size_t n) {
+  static unsigned long counter = 0ul;
+  const uint64_t *t;
+  __shard_request_t req;
+  __shard_answer_t ans;
+  uint64_t *base;
+  size_t size, bytes, s, sa, la, sb, lb, offa, offb, i, k;
+  int fd, res;
+
+  engine->shards = 0u;
+  if ((m == ((size_t) 0)) || (n == ((size_t) 0))) return -1;
+
+  /* Make a the longer operand */
+  if (m < n) {
+    t = a; a = b; b = t;
+    k = m; m = n; n = k;
+  }
+
+  /* Shard i multiplies block i / sb of a by block i % sb of b */
+  __shard_grid(&sa, &la, &sb, &lb, m, n, (size_t) engine->workers);
+  s = sa * sb;
+
+  /* Layout: a, b, then the partial products of la + lb digits each */
+  size = m + n + s * (la + lb);
+  bytes = size * sizeof(uint64_t);
+  memset(&req, 0, sizeof(req));
+  req.magic = SHARD_MAGIC;
+  req.op = SHARD_OP_MULTIPLY;
+  snprintf(req.name, SHARD_NAME_MAX, "/utepnum-%ld-%lu", (long) getpid(),
+	   __atomic_fetch_add(&counter, 1ul, __ATOMIC_RELAXED));
+  req.size = (uint64_t) size;
+  fd = shm_open(req.name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return -1;
+  if (ftruncate(fd, (off_t) bytes) < 0) {
+    close(fd);
+    shm_unlink(req.name);
+    return -1;
+  }
+  base = (uint64_t *) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(req.name);
+    return -1;
+  }
+  memcpy(base, a, m * sizeof(*a));
+  memcpy(&base[m], b, n * sizeof(*b));
+
+  /* Dispatch the shards */
+  res = 0;
+  for (i=0;i<s;i++) {
+    offa = (i / sb) * la;
+    offb = (i % sb) * lb;
+    req.a_offset = (uint64_t) offa;
+    req.a_size = (uint64_t) (((offa + la) <= m) ? la : (m - offa));
+    req.b_offset = (uint64_t) (m + offb);
+    req.b_size = (uint64_t) (((offb + lb) <= n) ? lb : (n - offb));
+    req.p_offset = (uint64_t) (m + n + i * (la + lb));
+    if (__shard_send(engine->fds[i], &req, sizeof(req)) < 0) {
+      res = -1;
+      break;
+    }
+  }
+  k = i;
+  engine->shards = (unsigned int) k;
+
+  /* Collect the answers of all workers that got a request */
+  for (i=0;i<k;i++) {
+    if ((__shard_receive(engine->fds[i], &ans, sizeof(ans)) < 0) ||
+	(ans.magic != SHARD_MAGIC) || (ans.status != ((int32_t) 0))) res = -1;
+  }
+  shm_unlink(req.name);
+
+  /* Add the partial products with carry propagation */
+  if (res == 0) {
+    memset(p, 0, (m + n) * sizeof(*p));
+    for (i=0;i<s;i++) {
+      offa = (i / sb) * la;
+      offb = (i % sb) * lb;
+      k = (((offa + la) <= m) ? la : (m - offa)) + (((offb + lb) <= n) ? lb : (n - offb));
+      __shard_add(&p[offa + offb], m + n - (offa + offb),
+		  &base[m + n + i * (la + lb)], k);
+    }
+  }
+
+  munmap(base, bytes);
+  return res;
+}
@@ -0,0 +1,221 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include "utepnum.h"
+
+
+/* Fills a with n pseudo-random digits derived from seed */
+static void fill_array(uint64_t *a, size_t n, uint64_t seed) {
+  size_t i;
+
+  for (i=0;i<n;i++) {
+    seed = seed * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    a[i] = seed ^ (seed >> 29);
+  }
+}
+
+/* Counts the callbacks and checks the results they get */
+static pthread_mutex_t callback_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int callback_count = 0;
+static int callback_errors = 0;
+
+static void count_callback(async_job_t *job, int result, void *arg) {
+  pthread_mutex_lock(&callback_mutex);
+  callback_count++;
+  if (result != *((int *) arg)) callback_errors++;
+  if (async_poll(job) != ASYNC_RUNNING) callback_errors++;
+  pthread_mutex_unlock(&callback_mutex);
+}
+
+/* Blocks the executor until the pipe whose read end is in arg gets
+   written to
+*/
+static void blocking_callback(async_job_t *job, int result, void *arg) {
+  char c;
+
+  if (read(*((int *) arg), &c, 1) != 1) {
+    fprintf(stderr, "Cannot read from pipe\n");
+  }
+}
+
+/* Checks jobs of all kinds and priorities against the synchronous
+   operations
+*/
+static int test_jobs(void) {
+  size_t m = 3000, n = 1000, i, len;
+  uint64_t a[m];
+  uint64_t b[n];
+  uint64_t p[m + n], pp[m + n];
+  uint64_t q[m], qq[m];
+  uint64_t r[n], rr[n];
+  uint64_t c[m];
+  uint64_t s[8][16], ss[8][16];
+  async_job_t *jobs[12];
+  char *str1;
+  char *str2;
+  int zero = 0;
+
+  fill_array(a, m, (uint64_t) 1);
+  fill_array(b, n, (uint64_t) 2);
+  len = convert_to_string_base_size(a, m, 10u);
+  str1 = calloc(len, sizeof(*str1));
+  str2 = calloc(len, sizeof(*str2));
+  if ((str1 == NULL) || (str2 == NULL)) return -1;
+  convert_to_decimal_string(str1, a, m);
+
+  /* Large jobs first, then small urgent ones */
+  jobs[0] = async_multiplication(pp, a, m, b, n, ASYNC_PRIORITY_LOW, count_callback, &zero);
+  jobs[1] = async_division(qq, rr, a, m, b, n, ASYNC_PRIORITY_AUTO, count_callback, &zero);
+  jobs[2] = async_convert_to_string_base(str2, a, m, 10u, ASYNC_PRIORITY_NORMAL, count_callback, &zero);
+  jobs[3] = async_convert_from_string_base(c, m, str1, 10u, ASYNC_PRIORITY_AUTO, count_callback, &zero);
+  for (i=0;i<8;i++) {
+    jobs[4 + i] = async_multiplication(ss[i], &a[i], 8, &b[i], 8, ASYNC_PRIORITY_HIGH,
+				       count_callback, &zero);
+  }
+  for (i=0;i<12;i++) {
+    if (jobs[i] == NULL) return -1;
+  }
+  for (i=0;i<12;i++) {
+    if (async_wait(jobs[i]) != 0) return -1;
+    if (async_poll(jobs[i]) != ASYNC_DONE) return -1;
+    if (async_cancel(jobs[i]) != -1) return -1;
+    async_release(jobs[i]);
+  }
+  if ((callback_count != 12) || (callback_errors != 0)) return -1;
+
+  /* Compare with the synchronous operations */
+  multiplication(p, a, m, b, n);
+  if (comparison(p, pp, m + n) != 0) return -1;
+  if (division(q, r, a, m, b, n) < 0) return -1;
+  if (comparison(q, qq, m) != 0) return -1;
+  if (comparison(r, rr, n) != 0) return -1;
+  if (strcmp(str1, str2) != 0) return -1;
+  if (comparison(a, c, m) != 0) return -1;
+  for (i=0;i<8;i++) {
+    multiplication(s[i], &a[i], 8, &b[i], 8);
+    if (comparison(s[i], ss[i], 16) != 0) return -1;
+  }
+  free(str1);
+  free(str2);
+
+  return 0;
+}
+
+/* Checks cancellation and eventfd notification with a single
+   executor that is kept busy
+*/
+static int test_cancel(void) {
+  uint64_t a[4], b[4], p[8], pp[8];
+  async_job_t *busy;
+  async_job_t *job;
+  struct pollfd pfd;
+  int fds[2];
+  char c = 'x';
+  int res;
+
+  fill_array(a, 4, (uint64_t) 3);
+  fill_array(b, 4, (uint64_t) 4);
+  if (pipe(fds) < 0) return -1;
+  async_set_executors(1u);
+
+  /* The executor blocks in the callback of busy, so job stays pending */
+  busy = async_multiplication(p, a, 4, b, 4, ASYNC_PRIORITY_HIGH, blocking_callback, &fds[0]);
+  job = async_multiplication(pp, a, 4, b, 4, ASYNC_PRIORITY_HIGH, NULL, NULL);
+  if ((busy == NULL) || (job == NULL)) return -1;
+  if (async_poll(job) != ASYNC_PENDING) return -1;
+  if (async_cancel(job) != 0) return -1;
+  if (async_poll(job) != ASYNC_CANCELLED) return -1;
+  if (async_wait(job) != -1) return -1;
+  async_release(job);
+
+  /* Wait for busy through its eventfd */
+  pfd.fd = async_eventfd(busy);
+  if (pfd.fd < 0) return -1;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, 0) != 0) return -1;
+  if (write(fds[1], &c, 1) != 1) return -1;
+  if (poll(&pfd, 1, -1) != 1) return -1;
+  if (async_poll(busy) != ASYNC_DONE) return -1;
+  res = async_wait(busy);
+  async_release(busy);
+  multiplication(pp, a, 4, b, 4);
+  if (comparison(p, pp, 8) != 0) return -1;
+  close(fds[0]);
+  close(fds[1]);
+  async_set_executors(2u);
+
+  return res;
+}
+
+/* Checks that waiting for its own job from a callback fails instead
+   of blocking
+*/
+static void self_wait_callback(async_job_t *job, int result, void *arg) {
+  *((int *) arg) = async_wait(job);
+}
+
+/* Checks several large conversions in flight at once, each in a radix
+   not used so far, so that the executors grow the tables of powers
+   concurrently while they fork into the pool
+*/
+static int test_conversions(void) {
+  size_t n = 2048, i;
+  uint64_t a[n];
+  uint64_t c[6][n];
+  char *str[6];
+  async_job_t *to[6];
+  async_job_t *from[6];
+  unsigned int base;
+  int waited = 0;
+
+  fill_array(a, n, (uint64_t) 5);
+  async_set_executors(4u);
+  utepnum_set_threads(4u);
+  for (i=0;i<6;i++) {
+    base = 20u + ((unsigned int) i);
+    str[i] = calloc(convert_to_string_base_size(a, n, base), sizeof(*str[i]));
+    if (str[i] == NULL) return -1;
+    to[i] = async_convert_to_string_base(str[i], a, n, base, ASYNC_PRIORITY_AUTO,
+					 (i == 0) ? self_wait_callback : NULL, &waited);
+    if (to[i] == NULL) return -1;
+  }
+  for (i=0;i<6;i++) {
+    if (async_wait(to[i]) != 0) return -1;
+    async_release(to[i]);
+    from[i] = async_convert_from_string_base(c[i], n, str[i], 20u + ((unsigned int) i),
+					     ASYNC_PRIORITY_AUTO, NULL, NULL);
+    if (from[i] == NULL) return -1;
+  }
+  for (i=0;i<6;i++) {
+    if (async_wait(from[i]) != 0) return -1;
+    async_release(from[i]);
+    if (comparison(c[i], a, n) != 0) return -1;
+    free(str[i]);
+  }
+  utepnum_set_threads(1u);
+  async_set_executors(2u);
+  if (waited != -1) return -1;
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  /* Run the jobs with one thread, then with a pool of several */
+  if (test_jobs() < 0) return 1;
+  utepnum_set_threads(3u);
+  callback_count = 0;
+  if (test_jobs() < 0) return 1;
+  utepnum_set_threads(1u);
+
+  if (test_cancel() < 0) return 1;
+  if (test_conversions() < 0) return 1;
+
+  /* Signal success */
+  printf("async jobs ok\n");
+  return 0;
+}
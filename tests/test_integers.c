@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 #include "utepnum.h"
 
 
@@ -38,11 +41,661 @@ static void print_array(const char *str, const uint64_t *a, size_t n) {
   printf("]\n");
 }
 
+/* Checks the bit queries and limb-wise logical operations on a */
+static int test_bits(const uint64_t *a, size_t n) {
+  uint64_t t[n];
+  uint64_t u[n];
+  uint64_t k, lz, tz, len, cnt, c;
+
+  lz = leading_zeros(a, n);
+  tz = trailing_zeros(a, n);
+  len = bit_length(a, n);
+  cnt = popcount(a, n);
+  printf("lz(a) = %llu, tz(a) = %llu, len(a) = %llu, popcount(a) = %llu\n",
+	 (unsigned long long int) lz, (unsigned long long int) tz,
+	 (unsigned long long int) len, (unsigned long long int) cnt);
+  if (lz + len != ((uint64_t) n) * ((uint64_t) 64)) return -1;
+
+  /* Rebuild a bit by bit and count the bits on the way */
+  memset(t, 0, sizeof(t));
+  c = (uint64_t) 0;
+  for (k=0;k<((uint64_t) n) * ((uint64_t) 64);k++) {
+    if (test_bit(a, n, k)) {
+      if (c == ((uint64_t) 0) && k != tz) return -1;
+      set_bit(t, n, k);
+      c++;
+    }
+  }
+  if (c != cnt) return -1;
+  if (comparison(t, a, n) != 0) return -1;
+
+  /* a & ~a = 0, a | ~a = ~0 and a ^ a = 0 */
+  bitwise_not(u, a, n);
+  bitwise_and(t, a, u, n);
+  if (!is_zero(t, n)) return -1;
+  bitwise_or(t, a, u, n);
+  bitwise_not(t, t, n);
+  if (!is_zero(t, n)) return -1;
+  bitwise_xor(t, a, a, n);
+  if (!is_zero(t, n)) return -1;
+
+  /* a andnot a = 0, then clear all bits of a copy of a */
+  bitwise_andnot(t, a, a, n);
+  if (!is_zero(t, n)) return -1;
+  memcpy(t, a, sizeof(t));
+  for (k=0;k<((uint64_t) n) * ((uint64_t) 64);k++) {
+    clear_bit(t, n, k);
+  }
+  if (!is_zero(t, n)) return -1;
+
+  return 0;
+}
+
+/* Checks the out-of-place and fused shifts against the in-place ones */
+static int test_shifts(const uint64_t *a, const uint64_t *b, size_t n) {
+  uint64_t t[n];
+  uint64_t u[n];
+  uint64_t v[n];
+  uint64_t w, x, l, i;
+  unsigned int k;
+
+  for (k=0u;k<64u;k+=7u) {
+    /* lshift and rshift */
+    memcpy(u, a, sizeof(u));
+    shift_left(u, n, (size_t) k);
+    w = lshift(t, a, n, k);
+    if (comparison(t, u, n) != 0) return -1;
+    if (w != ((k == 0u) ? ((uint64_t) 0) : (a[n - 1] >> (64u - k)))) return -1;
+    memcpy(u, a, sizeof(u));
+    shift_right(u, n, (size_t) k);
+    rshift(t, a, n, k);
+    if (comparison(t, u, n) != 0) return -1;
+
+    /* addlsh and sublsh */
+    memcpy(u, b, sizeof(u));
+    shift_left(u, n, (size_t) k);
+    addition(v, a, n, u, n);
+    w = addlsh(t, a, b, n, k);
+    if (comparison(t, v, n) != 0) return -1;
+    x = sublsh(t, t, b, n, k);
+    if (comparison(t, a, n) != 0) return -1;
+    if (w != x) return -1;
+  }
+
+  /* Shifts by one digit or more, checked bit by bit */
+  for (l=(uint64_t) 64;l<((uint64_t) n) * ((uint64_t) 64);l+=(uint64_t) 71) {
+    memcpy(u, a, sizeof(u));
+    shift_right(u, n, (size_t) l);
+    for (i=0;i<((uint64_t) n) * ((uint64_t) 64);i++) {
+      if ((!!test_bit(u, n, i)) !=
+	  ((i + l < ((uint64_t) n) * ((uint64_t) 64)) && test_bit(a, n, i + l))) return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* Checks that a, of size m, divided by b, of size n, gives a quotient
+   and remainder that recompose a.
+*/
+static int test_division(const uint64_t *a, size_t m,
+			 const uint64_t *b, size_t n) {
+  uint64_t q[m];
+  uint64_t r[n];
+  uint64_t p[m + n];
+  uint64_t s[m + n];
+
+  if (is_zero(b, n)) {
+    return (division(q, r, a, m, b, n) < 0) ? 0 : -1;
+  }
+  if (division(q, r, a, m, b, n) < 0) return -1;
+  print_array("q = ", q, m);
+  print_array("r = ", r, n);
+
+  /* r < b and q * b + r = a */
+  if (comparison(r, b, n) >= 0) return -1;
+  multiplication(p, q, m, b, n);
+  addition(s, p, m + n, r, n);
+  memset(p, 0, sizeof(p));
+  memcpy(p, a, m * sizeof(*a));
+  if (comparison(s, p, m + n) != 0) return -1;
+
+  return 0;
+}
+
+/* Checks that converting a, of size n, to decimal and back gives a */
+static int test_conversion(const uint64_t *a, size_t n) {
+  char str[20 * n + 2];
+  char pstr[64 * n + 2];
+  unsigned char bytes[8 * n];
+  uint64_t t[n];
+  unsigned int k;
+
+  convert_to_decimal_string(str, a, n);
+  printf("str = %s\n", str);
+  if (convert_from_decimal_string(t, n, str) < 0) return -1;
+  if (comparison(t, a, n) != 0) return -1;
+
+  /* Check the magnitude queries against the full conversion */
+  if (decimal_digit_count(a, n) != (uint64_t) strlen(str)) return -1;
+  for (k=1u;k<=40u;k+=13u) {
+    if (leading_decimal_digits(pstr, (size_t) k, a, n) != ((strlen(str) < k) ? strlen(str) : k)) return -1;
+    if (strncmp(pstr, str, k) != 0) return -1;
+  }
+
+  /* Round trip through all radices */
+  for (k=2u;k<=62u;k++) {
+    convert_to_string_base(pstr, a, n, k);
+    if (convert_from_string_base(t, n, pstr, k) < 0) return -1;
+    if (comparison(t, a, n) != 0) return -1;
+  }
+  convert_to_string_base(pstr, a, n, 10u);
+  if (strcmp(pstr, str) != 0) return -1;
+
+  /* Round trip through all power-of-two radices */
+  for (k=1u;k<=6u;k++) {
+    convert_to_string_pow2(pstr, a, n, k, NULL);
+    if (convert_from_string_pow2(t, n, pstr, k, NULL) < 0) return -1;
+    if (comparison(t, a, n) != 0) return -1;
+  }
+  convert_to_hex_string(pstr, a, n);
+  printf("hex = %s\n", pstr);
+  if (convert_from_hex_string(t, n, pstr) < 0) return -1;
+  if (comparison(t, a, n) != 0) return -1;
+
+  /* Round trip through bytes in both orders */
+  convert_to_bytes(bytes, 8 * n, a, n, 1);
+  convert_from_bytes(t, n, bytes, 8 * n, 1);
+  if (comparison(t, a, n) != 0) return -1;
+  if ((bytes[8 * n - 1] != (unsigned char) a[0]) ||
+      (bytes[0] != (unsigned char) (a[n - 1] >> 56))) return -1;
+  convert_to_bytes(bytes, 8 * n, a, n, 0);
+  convert_from_bytes(t, n, bytes, 8 * n, 0);
+  if (comparison(t, a, n) != 0) return -1;
+
+  return 0;
+}
+
+/* Fills str with len pseudo-random decimal digits derived from seed,
+   the first of which is not zero, and the terminating null character
+*/
+static void fill_decimal(char *str, size_t len, uint64_t seed) {
+  size_t i;
+
+  for (i=0;i<len;i++) {
+    seed = seed * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    str[i] = (char) ('0' + ((seed >> 33) % ((uint64_t) 10)));
+  }
+  if ((len > ((size_t) 0)) && (str[0] == '0')) str[0] = '7';
+  str[len] = '\0';
+}
+
+/* a becomes the decimal string str mod 2^(64 * n), computed one
+   character at a time
+*/
+static void parse_decimal_reference(uint64_t *a, size_t n, const char *str) {
+  uint64_t d;
+
+  memset(a, 0, n * sizeof(*a));
+  for (;*str!='\0';str++) {
+    mul_1(a, a, n, (uint64_t) 10);
+    d = (uint64_t) (*str - '0');
+    addition(a, a, n, &d, (size_t) 1);
+  }
+}
+
+/* Checks the decimal input by chunks of 19 digits, processed in
+   batches, on lengths around the boundaries of the chunks and of the
+   batches. The integers have less than 24 digits, so that the string
+   is never cut in halves. Strings that fit are converted back.
+*/
+static int test_chunked_parse(void) {
+  static const size_t lens[] = { 1, 2, 18, 19, 20, 37, 38, 39, 57, 436, 437, 438, 443,
+				 1215, 1216, 1217, 1234, 1235, 1236, 2432, 2433, 2451 };
+  size_t n = 23, i, len;
+  uint64_t a[n];
+  uint64_t b[n];
+  char str[2452];
+  char back[20 * n + 2];
+
+  for (i=0;i<(sizeof(lens) / sizeof(lens[0]));i++) {
+    len = lens[i];
+    fill_decimal(str, len, (uint64_t) (len + 1));
+    parse_decimal_reference(b, n, str);
+    if (convert_from_decimal_string(a, n, str) < 0) return -1;
+    if (comparison(a, b, n) != 0) return -1;
+    if (len <= ((size_t) 443)) {
+      convert_to_decimal_string(back, a, n);
+      if (strcmp(back, str) != 0) return -1;
+    }
+
+    /* A bad character in the last chunk is found before a changes */
+    str[len - ((size_t) 1)] = 'x';
+    if (convert_from_decimal_string(a, n, str) != -1) return -1;
+    if (comparison(a, b, n) != 0) return -1;
+  }
+
+  return 0;
+}
+
+/* Checks the decimal input by divide and conquer on lengths around
+   its cutover and around the splits by powers of ten, with one thread
+   and with several, against the reference and by converting back.
+   Strings of more than 30 digits are also parsed into 30 digits,
+   which must give the low 30 digits of the full result.
+*/
+static int test_dc_parse(void) {
+  static const size_t lens[] = { 436, 437, 455, 456, 457, 911, 912, 1216, 1217,
+				 4863, 4864, 4865, 9727, 9728, 9729 };
+  size_t i, len, n;
+  uint64_t *a;
+  uint64_t *b;
+  uint64_t c[30];
+  char *str;
+  char *back;
+  unsigned int t;
+  int res = 0;
+
+  for (i=0;(i<(sizeof(lens) / sizeof(lens[0]))) && (res == 0);i++) {
+    len = lens[i];
+    n = len / ((size_t) 19) + ((size_t) 2);
+    a = calloc(n, sizeof(*a));
+    b = calloc(n, sizeof(*b));
+    str = calloc(len + ((size_t) 1), sizeof(*str));
+    back = calloc(len + ((size_t) 2), sizeof(*back));
+    if ((a == NULL) || (b == NULL) || (str == NULL) || (back == NULL)) return -1;
+    fill_decimal(str, len, (uint64_t) (len + 7));
+    parse_decimal_reference(b, n, str);
+    for (t=1u;(t<=3u) && (res == 0);t+=2u) {
+      utepnum_set_threads(t);
+      if ((convert_from_decimal_string(a, n, str) < 0) ||
+	  (comparison(a, b, n) != 0)) res = -1;
+      convert_to_decimal_string(back, a, n);
+      if (strcmp(back, str) != 0) res = -1;
+      if ((n > ((size_t) 30)) &&
+	  ((convert_from_decimal_string(c, (size_t) 30, str) < 0) ||
+	   (comparison(c, b, (size_t) 30) != 0))) res = -1;
+    }
+    utepnum_set_threads(1u);
+    free(a);
+    free(b);
+    free(str);
+    free(back);
+  }
+
+  return res;
+}
+
+/* Checks the magnitude queries on 10^k - 1, 10^k and 10^k + 1, where
+   an estimate from the bit length is most likely to be off by one,
+   and log10_approx on these and on zero
+*/
+static int test_magnitude_boundaries(void) {
+  static const size_t ks[] = { 1, 2, 15, 18, 19, 20, 38, 39, 40, 100, 301, 700 };
+  size_t n = ((size_t) 700) / ((size_t) 19) + ((size_t) 2);
+  char str[722];
+  char pstr[722];
+  char dec[722];
+  uint64_t x[n];
+  uint64_t one = (uint64_t) 1;
+  size_t i, j, k, len;
+  double l, v;
+  int d;
+
+  memset(x, 0, sizeof(x));
+  if (log10_approx(x, n) != -HUGE_VAL) return -1;
+  for (i=0;i<(sizeof(ks) / sizeof(ks[0]));i++) {
+    k = ks[i];
+    for (d=-1;d<=1;d++) {
+      /* x = 10^k + d */
+      str[0] = '1';
+      memset(&str[1], '0', k);
+      str[k + ((size_t) 1)] = '\0';
+      if (convert_from_decimal_string(x, n, str) < 0) return -1;
+      if (d < 0) subtraction(x, x, n, &one, (size_t) 1);
+      if (d > 0) addition(x, x, n, &one, (size_t) 1);
+      convert_to_decimal_string(dec, x, n);
+      len = strlen(dec);
+      if (len != ((d < 0) ? k : (k + ((size_t) 1)))) return -1;
+
+      if (decimal_digit_count(x, n) != (uint64_t) len) return -1;
+      for (j=1;j<=len+((size_t) 1);j++) {
+	if (leading_decimal_digits(pstr, j, x, n) != ((len < j) ? len : j)) return -1;
+	if (strncmp(pstr, dec, j) != 0) return -1;
+      }
+
+      /* log10(10^k + d) differs from k by less than 10^-k */
+      l = log10_approx(x, n);
+      v = (k <= ((size_t) 15)) ? log10(strtod(dec, NULL)) : ((double) k);
+      if (fabs(l - v) > ((double) (k + ((size_t) 1))) * 1e-15) return -1;
+    }
+  }
+
+  /* x = c * 10^k + d, whose leading digits are c or c - 1 */
+  for (k=45;k<=((size_t) 700);k+=((size_t) 160)) {
+    for (d=-1;d<=0;d++) {
+      memcpy(str, "31415926535897932384", 20);
+      memset(&str[20], '0', k - ((size_t) 20));
+      str[k] = '\0';
+      if (convert_from_decimal_string(x, n, str) < 0) return -1;
+      if (d < 0) subtraction(x, x, n, &one, (size_t) 1);
+      convert_to_decimal_string(dec, x, n);
+      for (j=1;j<=((size_t) 25);j++) {
+	if (leading_decimal_digits(pstr, j, x, n) != j) return -1;
+	if (strncmp(pstr, dec, j) != 0) return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/* Checks that multiplying two operands derived from a, of size n,
+   and converting the product to decimal and back gives the same
+   results with several threads as with one
+*/
+static int test_parallel(const uint64_t *a, size_t n) {
+  size_t k = 1500;
+  uint64_t x[k];
+  uint64_t y[k];
+  uint64_t p[k + k];
+  uint64_t pp[k + k];
+  uint64_t s;
+  size_t i, len;
+  unsigned int t;
+  char *str1;
+  char *str2;
+
+  s = a[0] ^ ((uint64_t) n);
+  for (i=0;i<k;i++) {
+    s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    x[i] = s ^ a[i % n];
+    s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    y[i] = s;
+  }
+  multiplication(p, x, k, y, k);
+  len = convert_to_string_base_size(p, k + k, 10u);
+  str1 = calloc(len, sizeof(*str1));
+  str2 = calloc(len, sizeof(*str2));
+  if ((str1 == NULL) || (str2 == NULL)) return -1;
+  convert_to_decimal_string(str1, p, k + k);
+  for (t=2u;t<=5u;t++) {
+    utepnum_set_threads(t);
+    if (utepnum_get_threads() != t) return -1;
+    memset(pp, 0, sizeof(pp));
+    multiplication(pp, x, k, y, k);
+    if (comparison(p, pp, k + k) != 0) return -1;
+    convert_to_decimal_string(str2, p, k + k);
+    if (strcmp(str1, str2) != 0) return -1;
+    memset(pp, 0, sizeof(pp));
+    if (convert_from_decimal_string(pp, k + k, str1) < 0) return -1;
+    if (comparison(p, pp, k + k) != 0) return -1;
+  }
+  utepnum_set_threads(1u);
+  free(str1);
+  free(str2);
+
+  return 0;
+}
+
+#define CONCURRENT_CALLERS 6
+#define CONCURRENT_SIZE    ((size_t) 2000)
+
+typedef struct {
+  uint64_t x[CONCURRENT_SIZE];
+  uint64_t y[CONCURRENT_SIZE];
+  uint64_t p[2 * CONCURRENT_SIZE];
+  int      res;
+} concurrent_caller_t;
+
+/* Multiplies the operands of a caller a few times and compares with
+   the product computed before
+*/
+static void *concurrent_multiply(void *arg) {
+  concurrent_caller_t *c = (concurrent_caller_t *) arg;
+  uint64_t pp[2 * CONCURRENT_SIZE];
+  int i;
+
+  c->res = 0;
+  for (i=0;i<3;i++) {
+    memset(pp, 0, sizeof(pp));
+    multiplication(pp, c->x, CONCURRENT_SIZE, c->y, CONCURRENT_SIZE);
+    if (comparison(pp, c->p, 2 * CONCURRENT_SIZE) != 0) c->res = -1;
+  }
+  return NULL;
+}
+
+/* Checks multiplications by several threads of the caller at once,
+   which all fork into the same pool
+*/
+static int test_concurrent(const uint64_t *a, size_t n) {
+  concurrent_caller_t *c;
+  pthread_t ids[CONCURRENT_CALLERS];
+  uint64_t s;
+  size_t i, j;
+  int res = 0;
+
+  c = calloc(CONCURRENT_CALLERS, sizeof(*c));
+  if (c == NULL) return -1;
+  s = a[0];
+  for (i=0;i<CONCURRENT_CALLERS;i++) {
+    for (j=0;j<CONCURRENT_SIZE;j++) {
+      s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+      c[i].x[j] = s ^ a[j % n];
+      s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+      c[i].y[j] = s;
+    }
+    multiplication(c[i].p, c[i].x, CONCURRENT_SIZE, c[i].y, CONCURRENT_SIZE);
+  }
+
+  utepnum_set_threads(4u);
+  for (i=0;i<CONCURRENT_CALLERS;i++) {
+    if (pthread_create(&ids[i], NULL, concurrent_multiply, &c[i]) != 0) return -1;
+  }
+  for (i=0;i<CONCURRENT_CALLERS;i++) {
+    pthread_join(ids[i], NULL);
+    if (c[i].res < 0) res = -1;
+  }
+  utepnum_set_threads(1u);
+  free(c);
+
+  return res;
+}
+
+#define CONVERSION_CALLERS 16
+#define CONVERSION_SIZE    ((size_t) 2048)
+
+typedef struct {
+  const uint64_t *a;
+  unsigned int   base;
+  int            res;
+} conversion_caller_t;
+
+/* Converts the operand of a caller to its radix and back */
+static void *concurrent_convert(void *arg) {
+  conversion_caller_t *c = (conversion_caller_t *) arg;
+  uint64_t *t;
+  char *str;
+
+  c->res = -1;
+  t = calloc(CONVERSION_SIZE, sizeof(*t));
+  str = calloc(convert_to_string_base_size(c->a, CONVERSION_SIZE, c->base), sizeof(*str));
+  if ((t == NULL) || (str == NULL)) return NULL;
+  convert_to_string_base(str, c->a, CONVERSION_SIZE, c->base);
+  if ((convert_from_string_base(t, CONVERSION_SIZE, str, c->base) == 0) &&
+      (comparison(t, c->a, CONVERSION_SIZE) == 0)) c->res = 0;
+  free(t);
+  free(str);
+  return NULL;
+}
+
+/* Checks conversions by several threads of the caller at once, each
+   in a radix whose table of powers is still empty, on operands large
+   enough to fork while the tables grow
+*/
+static int test_concurrent_conversion(const uint64_t *a, size_t n) {
+  conversion_caller_t c[CONVERSION_CALLERS];
+  pthread_t ids[CONVERSION_CALLERS];
+  uint64_t *x;
+  uint64_t s;
+  size_t i;
+  int res = 0;
+
+  x = calloc(CONVERSION_SIZE, sizeof(*x));
+  if (x == NULL) return -1;
+  s = a[0] ^ ((uint64_t) n);
+  for (i=0;i<CONVERSION_SIZE;i++) {
+    s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    x[i] = s ^ a[i % n];
+  }
+
+  utepnum_set_threads(8u);
+  for (i=0;i<CONVERSION_CALLERS;i++) {
+    c[i].a = x;
+    c[i].base = 3u + ((unsigned int) i);
+    if (c[i].base >= 10u) c[i].base++;
+    if (pthread_create(&ids[i], NULL, concurrent_convert, &c[i]) != 0) return -1;
+  }
+  for (i=0;i<CONVERSION_CALLERS;i++) {
+    pthread_join(ids[i], NULL);
+    if (c[i].res < 0) res = -1;
+  }
+  utepnum_set_threads(1u);
+  free(x);
+
+  return res;
+}
+
+/* Checks the batch operations on operands of various sizes derived
+   from a, of size n, against the single operations
+*/
+static int test_batch(const uint64_t *a, size_t n) {
+  size_t count = 24, k = 700, i, l;
+  uint64_t x[k];
+  uint64_t p[count][k + k], pp[k + k];
+  uint64_t q[count][k], qq[k];
+  uint64_t r[count][k], rr[k];
+  uint64_t c[count][k + k];
+  char *str[count];
+  char *s;
+  multiplication_desc_t mops[count];
+  division_desc_t dops[count];
+  decimal_string_desc_t tops[count], fops[count];
+  size_t sz[count];
+  uint64_t t;
+
+  t = a[0] ^ ((uint64_t) n);
+  for (i=0;i<k;i++) {
+    t = t * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    x[i] = t ^ a[i % n];
+  }
+  utepnum_set_threads(3u);
+  for (i=0;i<count;i++) {
+    sz[i] = ((i * ((size_t) 7919)) % k) + ((size_t) 1);
+    l = ((i * ((size_t) 104729)) % sz[i]) + ((size_t) 1);
+    mops[i].p = p[i];
+    mops[i].a = x;
+    mops[i].m = sz[i];
+    mops[i].b = &x[k - l];
+    mops[i].n = l;
+    dops[i].q = q[i];
+    dops[i].r = r[i];
+    dops[i].a = x;
+    dops[i].m = sz[i];
+    dops[i].b = &x[k - l];
+    dops[i].n = l;
+    str[i] = calloc(convert_to_string_base_size(x, sz[i], 10u), sizeof(*str[i]));
+    if (str[i] == NULL) return -1;
+    tops[i].str = str[i];
+    tops[i].a = x;
+    tops[i].n = sz[i];
+    fops[i].str = str[i];
+    fops[i].a = c[i];
+    fops[i].n = sz[i] + sz[i];
+  }
+  multiplication_batch(mops, count);
+  division_batch(dops, count);
+  convert_to_decimal_string_batch(tops, count);
+  convert_from_decimal_string_batch(fops, count);
+  utepnum_set_threads(1u);
+
+  for (i=0;i<count;i++) {
+    multiplication(pp, mops[i].a, mops[i].m, mops[i].b, mops[i].n);
+    if (comparison(p[i], pp, mops[i].m + mops[i].n) != 0) return -1;
+    if (division(qq, rr, dops[i].a, dops[i].m, dops[i].b, dops[i].n) != dops[i].result) return -1;
+    if ((dops[i].result == 0) &&
+	((comparison(q[i], qq, dops[i].m) != 0) ||
+	 (comparison(r[i], rr, dops[i].n) != 0))) return -1;
+    s = calloc(convert_to_string_base_size(x, sz[i], 10u), sizeof(*s));
+    if (s == NULL) return -1;
+    convert_to_decimal_string(s, x, sz[i]);
+    if (strcmp(s, str[i]) != 0) return -1;
+    free(s);
+    if ((fops[i].result != 0) ||
+	(comparison(c[i], x, sz[i]) != 0) ||
+	(!is_zero(&c[i][sz[i]], sz[i]))) return -1;
+    free(str[i]);
+  }
+
+  return 0;
+}
+
+/* Checks batch conversions while the decimal table of powers is still
+   empty, so that the threads of the batch grow it concurrently while
+   they fork into the pool. Must run before any other decimal
+   conversion in the process.
+*/
+static int test_cold_batch(void) {
+  size_t count = 8, k = 2048, i;
+  uint64_t *x;
+  uint64_t *c;
+  char *str[count];
+  decimal_string_desc_t tops[count], fops[count];
+  uint64_t t;
+  int res = 0;
+
+  x = calloc(k, sizeof(*x));
+  c = calloc(count * k, sizeof(*c));
+  if ((x == NULL) || (c == NULL)) return -1;
+  t = (uint64_t) 42;
+  for (i=0;i<k;i++) {
+    t = t * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    x[i] = t ^ (t >> 29);
+  }
+  utepnum_set_threads(8u);
+  for (i=0;i<count;i++) {
+    str[i] = calloc(convert_to_string_base_size(x, k - i, 10u), sizeof(*str[i]));
+    if (str[i] == NULL) return -1;
+    tops[i].str = str[i];
+    tops[i].a = x;
+    tops[i].n = k - i;
+    fops[i].str = str[i];
+    fops[i].a = &c[i * k];
+    fops[i].n = k;
+  }
+  convert_to_decimal_string_batch(tops, count);
+  convert_from_decimal_string_batch(fops, count);
+  utepnum_set_threads(1u);
+
+  for (i=0;i<count;i++) {
+    if ((fops[i].result != 0) ||
+	(comparison(&c[i * k], x, k - i) != 0) ||
+	(!is_zero(&c[i * k + k - i], i))) res = -1;
+    free(str[i]);
+  }
+  free(x);
+  free(c);
+
+  return res;
+}
+
 int test_integers(size_t m, size_t n, const char *str1, const char *str2) {
   size_t q = (m > n) ? m : n;
   uint64_t a[m];
   uint64_t b[n];
   uint64_t c[q];
+  uint64_t aa[q];
+  uint64_t bb[q];
 
   /* Convert the two strings str1 and str2 */
   if (convert_from_decimal_string(a, m, str1) < 0) return -1;
@@ -57,6 +710,39 @@ int test_integers(size_t m, size_t n, const char *str1, const char *str2) {
 
   /* Display the addition result */
   print_array("c = ", c, q);
+
+  /* Check the bit queries on a */
+  if (test_bits(a, m) < 0) return -1;
+
+  /* Check the shifts on a and b, extended to the same size */
+  memset(aa, 0, sizeof(aa));
+  memcpy(aa, a, sizeof(a));
+  memset(bb, 0, sizeof(bb));
+  memcpy(bb, b, sizeof(b));
+  if (test_shifts(aa, bb, q) < 0) return -1;
+  if (test_shifts(bb, aa, q) < 0) return -1;
+
+  /* Check the division of c by a and b */
+  if (test_division(c, q, a, m) < 0) return -1;
+  if (test_division(c, q, b, n) < 0) return -1;
+
+  /* Check concurrent conversions in radices not used so far */
+  if (test_concurrent_conversion(c, q) < 0) return -1;
+
+  /* Check the decimal conversion of c */
+  if (test_conversion(c, q) < 0) return -1;
+  if (test_chunked_parse() < 0) return -1;
+  if (test_dc_parse() < 0) return -1;
+  if (test_magnitude_boundaries() < 0) return -1;
+
+  /* Check the multiplication and conversion with several threads */
+  if (test_parallel(c, q) < 0) return -1;
+
+  /* Check concurrent callers sharing the thread pool */
+  if (test_concurrent(c, q) < 0) return -1;
+
+  /* Check the batch operations */
+  if (test_batch(c, q) < 0) return -1;
   
   /* TODO */
 
@@ -78,6 +764,9 @@ int main(int argc, char **argv) {
   if (m == ((size_t) 0)) return 1;
   if (n == ((size_t) 0)) return 1;
   
+  /* Check the batch conversions before anything warms the tables */
+  if (test_cold_batch() < 0) return 1;
+
   /* Run the actual test function */
   if (test_integers(m, n, argv[3], argv[4]) < 0) return 1;
 
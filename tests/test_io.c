@@ -0,0 +1,283 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "utepnum.h"
+
+
+/* Source for convert_from_string_base_stream that hands out the
+   characters of a string by small pieces of irregular length
+*/
+typedef struct {
+  const char *str;
+  size_t     len;
+  size_t     piece;
+} test_source_t;
+
+static int test_source(void *arg, const char **str, size_t *len) {
+  test_source_t *src = (test_source_t *) arg;
+  size_t l;
+
+  if (src->len == ((size_t) 0)) return 0;
+  src->piece = (src->piece * ((size_t) 7) + ((size_t) 3)) % ((size_t) 5000) + ((size_t) 1);
+  l = (src->piece < src->len) ? src->piece : src->len;
+  *str = src->str;
+  *len = l;
+  src->str += l;
+  src->len -= l;
+  return 1;
+}
+
+/* Checks that b, of size m, has the value a, of size n */
+static int check_value(const uint64_t *a, size_t n, const uint64_t *b, size_t m) {
+  size_t i;
+
+  for (i=0;i<((n > m) ? n : m);i++) {
+    if (((i < n) ? a[i] : ((uint64_t) 0)) != ((i < m) ? b[i] : ((uint64_t) 0))) return -1;
+  }
+  return 0;
+}
+
+/* Checks the streaming decimal reader on str, using the file name as
+   scratch space
+*/
+static int test_read(const char *name, const char *str) {
+  size_t len = strlen(str);
+  size_t n = len / ((size_t) 19) + ((size_t) 2);
+  uint64_t *a;
+  uint64_t *b;
+  size_t m;
+  test_source_t src;
+  FILE *f;
+  int fd, res;
+  iomode_t mode;
+
+  a = calloc(n, sizeof(*a));
+  if (a == NULL) return -1;
+  if (convert_from_decimal_string(a, n, str) < 0) return -1;
+
+  /* Irregular pieces */
+  src.str = str;
+  src.len = len;
+  src.piece = (size_t) 0;
+  if (convert_from_string_base_stream(&b, &m, 10u, (size_t) 0, test_source, &src) < 0) return -1;
+  res = check_value(a, n, b, m);
+  free(b);
+  if (res < 0) return -1;
+
+  /* A file, with white space around, in both modes */
+  f = fopen(name, "w");
+  if (f == NULL) return -1;
+  fprintf(f, " \n%s\n\n", str);
+  fclose(f);
+  for (mode=IO_MODE_READ;mode<=IO_MODE_MMAP;mode++) {
+    fd = open(name, O_RDONLY);
+    if (fd < 0) return -1;
+    res = read_decimal_fd(&b, &m, fd, (size_t) 0, mode);
+    close(fd);
+    if (res < 0) return -1;
+    res = check_value(a, n, b, m);
+    free(b);
+    if (res < 0) return -1;
+    printf("read in mode %d: %zu digits\n", (int) mode, m);
+  }
+
+  /* Garbage after the integer must be refused */
+  f = fopen(name, "w");
+  if (f == NULL) return -1;
+  fprintf(f, "%s\n17\n", str);
+  fclose(f);
+  fd = open(name, O_RDONLY);
+  if (fd < 0) return -1;
+  res = read_decimal_fd(&b, &m, fd, (size_t) 0, IO_MODE_READ);
+  close(fd);
+  if (res == 0) return -1;
+
+  unlink(name);
+  free(a);
+
+  return 0;
+}
+
+/* Checks the streaming decimal writers on str, which must not have
+   leading zeros, using the file name as scratch space
+*/
+static int test_write(const char *name, const char *str) {
+  size_t len = strlen(str);
+  size_t n = len / ((size_t) 19) + ((size_t) 2);
+  uint64_t *a;
+  char *t;
+  FILE *f;
+  int fd, k, res;
+
+  a = calloc(n, sizeof(*a));
+  t = calloc(len + ((size_t) 2), sizeof(*t));
+  if ((a == NULL) || (t == NULL)) return -1;
+  if (convert_from_decimal_string(a, n, str) < 0) return -1;
+  if (convert_to_string_base_size(a, n, 10u) < len + ((size_t) 1)) return -1;
+
+  for (k=0;k<2;k++) {
+    if (k == 0) {
+      fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+      if (fd < 0) return -1;
+      res = write_decimal_fd(fd, a, n);
+      close(fd);
+    } else {
+      f = fopen(name, "w");
+      if (f == NULL) return -1;
+      res = write_decimal_file(f, a, n);
+      fclose(f);
+    }
+    if (res < 0) return -1;
+
+    /* Read back what has been written */
+    f = fopen(name, "r");
+    if (f == NULL) return -1;
+    res = (fread(t, sizeof(*t), len + ((size_t) 1), f) == len) ? 0 : -1;
+    fclose(f);
+    if ((res < 0) || (memcmp(t, str, len) != 0)) return -1;
+  }
+
+  unlink(name);
+  free(a);
+  free(t);
+
+  return 0;
+}
+
+/* Checks the binary container format on the value of str, using the
+   file name as scratch space
+*/
+static int test_binary(const char *name, const char *str) {
+  size_t len = strlen(str);
+  size_t n = len / ((size_t) 19) + ((size_t) 2);
+  uint64_t *a;
+  uint64_t *b;
+  size_t m;
+  widefloat_t x, y;
+  binary_map_t map;
+  int fd, res;
+
+  a = calloc(n, sizeof(*a));
+  if (a == NULL) return -1;
+  if (convert_from_decimal_string(a, n, str) < 0) return -1;
+  widefloat_init(&x, (size_t) 3);
+  widefloat_set_from_integer(&x, a, n);
+
+  /* An integer, a widefloat, then the integer cut to one limb */
+  fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) return -1;
+  if ((write_binary_integer(fd, a, n) < 0) ||
+      (write_binary_widefloat(fd, &x) < 0) ||
+      (write_binary_integer(fd, a, (size_t) 1) < 0)) return -1;
+
+  /* Map them back and compare without copying */
+  if (binary_map_open(&map, fd) < 0) return -1;
+  close(fd);
+  res = 0;
+  if ((binary_map_integer(&map, &b, &m) < 0) ||
+      (m != n) || (comparison(a, b, n) != 0) ||
+      ((((uintptr_t) b) % ((uintptr_t) 64)) != ((uintptr_t) 0))) res = -1;
+  if ((res == 0) && (binary_map_integer(&map, &b, &m) == 0)) res = -1;
+  if ((res == 0) &&
+      ((binary_map_widefloat(&map, &y) < 0) ||
+       (y.fpclass != x.fpclass) || (y.sign != x.sign) ||
+       (y.exponent != x.exponent) || (y.mantissa_size != x.mantissa_size) ||
+       (comparison(y.mantissa, x.mantissa, x.mantissa_size) != 0))) res = -1;
+  if ((res == 0) &&
+      ((binary_map_integer(&map, &b, &m) < 0) ||
+       (m != ((size_t) 1)) || (b[0] != a[0]))) res = -1;
+  if ((res == 0) && (binary_map_integer(&map, &b, &m) == 0)) res = -1;
+  binary_map_close(&map);
+
+  unlink(name);
+  widefloat_clear(&x);
+  free(a);
+
+  return res;
+}
+
+/* Writes the n digits of a to a new file name and returns a
+   descriptor on it, or -1
+*/
+static int write_limbs(const char *name, const uint64_t *a, size_t n) {
+  int fd;
+
+  fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) return -1;
+  if (write(fd, a, n * sizeof(*a)) != (ssize_t) (n * sizeof(*a))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Checks the out-of-core multiplication of operands derived from the
+   value of str against the in-memory one, using file names derived
+   from name as scratch space
+*/
+static int test_out_of_core(const char *name, const char *str) {
+  size_t m = 1500, n = 2300, i, l;
+  uint64_t a[m], b[n], p[m + n], pp[m + n];
+  uint64_t s;
+  char na[strlen(name) + 3], nb[strlen(name) + 3], np[strlen(name) + 3];
+  size_t memory[3] = { 0, 131072, 1 };
+  int afd, bfd, pfd, res;
+
+  memset(a, 0, sizeof(a));
+  l = strlen(str) / ((size_t) 19) + ((size_t) 1);
+  if (convert_from_decimal_string(a, (l < m) ? l : m, str) < 0) return -1;
+  s = a[0];
+  for (i=0;i<n;i++) {
+    s = s * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    b[i] = s;
+    if ((i < m) && (i >= l)) a[i] = s ^ (s >> 31);
+  }
+  multiplication(p, a, m, b, n);
+
+  snprintf(na, sizeof(na), "%s.a", name);
+  snprintf(nb, sizeof(nb), "%s.b", name);
+  snprintf(np, sizeof(np), "%s.p", name);
+  afd = write_limbs(na, a, m);
+  bfd = write_limbs(nb, b, n);
+  pfd = open(np, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if ((afd < 0) || (bfd < 0) || (pfd < 0)) return -1;
+
+  /* One tile, tiles of 512 digits, and the smallest tiles */
+  res = 0;
+  for (i=0;(i<3) && (res == 0);i++) {
+    if ((multiplication_out_of_core(pfd, afd, m, bfd, n, memory[i]) < 0) ||
+	(pread(pfd, pp, sizeof(pp), 0) != (ssize_t) sizeof(pp)) ||
+	(comparison(p, pp, m + n) != 0)) res = -1;
+  }
+
+  /* Operands that are too short are refused */
+  if ((res == 0) && (multiplication_out_of_core(pfd, afd, m + 1, bfd, n, 0) == 0)) res = -1;
+
+  close(afd);
+  close(bfd);
+  close(pfd);
+  unlink(na);
+  unlink(nb);
+  unlink(np);
+
+  return res;
+}
+
+int main(int argc, char **argv) {
+  
+  /* Check if we have at least 3 arguments */
+  if (argc < 3) return 1;
+
+  /* Run the actual test function */
+  if (test_read(argv[1], argv[2]) < 0) return 1;
+  if (test_write(argv[1], argv[2]) < 0) return 1;
+  if (test_binary(argv[1], argv[2]) < 0) return 1;
+  if (test_out_of_core(argv[1], argv[2]) < 0) return 1;
+
+  /* Signal success */
+  return 0;
+}
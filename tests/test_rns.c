@@ -0,0 +1,96 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utepnum.h"
+
+
+/* Fills a with n pseudo-random digits derived from seed */
+static void fill_array(uint64_t *a, size_t n, uint64_t seed) {
+  size_t i;
+
+  for (i=0;i<n;i++) {
+    seed = seed * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    a[i] = seed ^ (seed >> 29);
+  }
+}
+
+/* Checks conversions, additions, subtractions and multiplications in
+   a base for bits bits against the operations on integers, on
+   operands of n digits, with 128 * n < bits
+*/
+static int test_base(uint64_t bits, size_t n) {
+  rns_base_t base;
+  rns_t x, y, z;
+  uint64_t *a;
+  uint64_t *b;
+  uint64_t *c;
+  uint64_t *p;
+  uint64_t *s;
+  int res = 0;
+
+  if (rns_base_init(&base, bits) < 0) return -1;
+  a = calloc(n, sizeof(*a));
+  b = calloc(n, sizeof(*b));
+  c = calloc(((size_t) 3) * n, sizeof(*c));
+  p = calloc(((size_t) 3) * n, sizeof(*p));
+  s = calloc(((size_t) 3) * n, sizeof(*s));
+  if ((a == NULL) || (b == NULL) || (c == NULL) || (p == NULL) || (s == NULL)) return -1;
+  fill_array(a, n, (uint64_t) bits);
+  fill_array(b, n, (uint64_t) n);
+  rns_init(&x, &base);
+  rns_init(&y, &base);
+  rns_init(&z, &base);
+
+  /* Round trip */
+  rns_set_integer(&x, a, n);
+  rns_get_integer(c, n, &x);
+  if (comparison(a, c, n) != 0) res = -1;
+
+  /* z = a * b + a - b, in this order to stay nonnegative */
+  rns_set_integer(&y, b, n);
+  rns_mul(&z, &x, &y);
+  rns_add(&z, &z, &x);
+  rns_sub(&z, &z, &y);
+  rns_get_integer(c, ((size_t) 3) * n, &z);
+  multiplication(p, a, n, b, n);
+  addition(s, p, ((size_t) 2) * n + ((size_t) 1), a, n);
+  subtraction(p, s, ((size_t) 2) * n + ((size_t) 1), b, n);
+  if (comparison(p, c, ((size_t) 3) * n) != 0) res = -1;
+
+  /* Wrap around: 0 - a + a = 0 */
+  memset(s, 0, n * sizeof(*s));
+  rns_set_integer(&y, s, n);
+  rns_sub(&z, &y, &x);
+  rns_add(&z, &z, &x);
+  rns_get_integer(c, n, &z);
+  if (!is_zero(c, n)) res = -1;
+
+  rns_clear(&x);
+  rns_clear(&y);
+  rns_clear(&z);
+  rns_base_clear(&base);
+  free(a);
+  free(b);
+  free(c);
+  free(p);
+  free(s);
+
+  return res;
+}
+
+int main(int argc, char **argv) {
+  /* Small bases, with one thread */
+  if (test_base((uint64_t) 200, (size_t) 1) < 0) return 1;
+  if (test_base((uint64_t) 3000, (size_t) 23) < 0) return 1;
+
+  /* A large base, spread over several threads */
+  utepnum_set_threads(3u);
+  if (test_base((uint64_t) 300000, (size_t) 2300) < 0) return 1;
+  utepnum_set_threads(1u);
+
+  /* Signal success */
+  printf("rns ok\n");
+  return 0;
+}
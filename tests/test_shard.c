@@ -0,0 +1,74 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utepnum.h"
+
+
+/* Fills a with n pseudo-random digits derived from seed */
+static void fill_array(uint64_t *a, size_t n, uint64_t seed) {
+  size_t i;
+
+  for (i=0;i<n;i++) {
+    seed = seed * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    a[i] = seed ^ (seed >> 29);
+  }
+}
+
+/* Checks the sharded product of operands of m and n digits against
+   the one computed in this process
+*/
+static int test_product(shard_engine_t *engine, size_t m, size_t n, int ones) {
+  uint64_t a[m], b[n], p[m + n], pp[m + n];
+
+  if (ones) {
+    /* All digits maximal, so that the carries run through */
+    memset(a, 0xff, sizeof(a));
+    memset(b, 0xff, sizeof(b));
+  } else {
+    fill_array(a, m, (uint64_t) m);
+    fill_array(b, n, (uint64_t) n);
+  }
+  multiplication(p, a, m, b, n);
+  if (multiplication_sharded(engine, pp, a, m, b, n) < 0) return -1;
+  if (comparison(p, pp, m + n) != 0) return -1;
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  shard_engine_t *engine;
+  int res;
+
+  engine = shard_engine_start(3u);
+  if (engine == NULL) return 1;
+  res = 0;
+  if ((test_product(engine, 2000, 1500, 0) < 0) ||
+      (shard_engine_last_shards(engine) != 3u) ||
+      (test_product(engine, 1000, 1000, 1) < 0) ||
+      (shard_engine_last_shards(engine) != 3u) ||
+      (test_product(engine, 1001, 999, 0) < 0) ||
+      (shard_engine_last_shards(engine) < 2u) ||
+      (test_product(engine, 700, 5000, 0) < 0) ||
+      (test_product(engine, 1000, 100, 1) < 0) ||
+      (test_product(engine, 1, 1, 0) < 0) ||
+      (test_product(engine, 3, 17, 1) < 0)) res = -1;
+  if ((res == 0) && (multiplication_sharded(engine, NULL, NULL, 0, NULL, 0) == 0)) res = -1;
+  shard_engine_stop(engine);
+  if (res < 0) return 1;
+
+  /* Balanced operands on four workers are cut into a grid of 2 x 2 */
+  engine = shard_engine_start(4u);
+  if (engine == NULL) return 1;
+  if ((test_product(engine, 1200, 1200, 0) < 0) ||
+      (shard_engine_last_shards(engine) != 4u) ||
+      (test_product(engine, 1201, 1199, 1) < 0) ||
+      (test_product(engine, 2, 3, 0) < 0)) res = -1;
+  shard_engine_stop(engine);
+  if (res < 0) return 1;
+
+  /* Signal success */
+  printf("sharded multiplication ok\n");
+  return 0;
+}
@@ -0,0 +1,972 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "utepnum.h"
+
+
+/* Fills a with n pseudo-random digits derived from seed */
+static void fill_array(uint64_t *a, size_t n, uint64_t seed) {
+  size_t i;
+
+  for (i=0;i<n;i++) {
+    seed = seed * ((uint64_t) 6364136223846793005ull) + ((uint64_t) 1442695040888963407ull);
+    a[i] = seed ^ (seed >> 29);
+  }
+}
+
+/* Sets x to (-1)^s * 2^E * m, where m has k pseudo-random digits, or
+   all digits set if seed is zero
+*/
+static void set_random(widefloat_t *x, int s, int64_t E, size_t k, uint64_t seed) {
+  uint64_t m[k];
+
+  if (seed == ((uint64_t) 0)) {
+    memset(m, 0xff, sizeof(m));
+  } else {
+    fill_array(m, k, seed);
+  }
+  widefloat_set_from_scaled_integer(x, s, E, m, k);
+}
+
+/* Returns 0 if x and y are the same floating-point number, -1
+   otherwise
+*/
+static int check_equal(const widefloat_t *x, const widefloat_t *y) {
+  if (x->fpclass != y->fpclass) return -1;
+  if (x->sign != y->sign) return -1;
+  if (x->exponent != y->exponent) return -1;
+  if (x->mantissa_size != y->mantissa_size) return -1;
+  if (comparison(x->mantissa, y->mantissa, x->mantissa_size) != 0) return -1;
+  return 0;
+}
+
+/* Sets the variable pointed to by E to the scale of x, such that
+   x = (-1)^sign * 2^E * m, where m is the integer in the mantissa
+*/
+static void get_scaled(int64_t *E, const widefloat_t *x) {
+  *E = ((int64_t) x->exponent) - ((int64_t) (x->mantissa_size << 6)) +
+    ((int64_t) WIDEFLOAT_OVERHEAD) + ((int64_t) 1);
+}
+
+/* Sets r to a + (-1)^neg * b, computed exactly on integers and rounded
+   by widefloat_set_from_scaled_integer. a and b must be non-zero
+   numbers.
+*/
+static void reference_add(widefloat_t *r, const widefloat_t *a, const widefloat_t *b, int neg) {
+  int64_t Ea, Eb, E;
+  size_t la, lb, l;
+  uint64_t *A;
+  uint64_t *B;
+  uint64_t *C;
+  int sa, sb, s;
+
+  get_scaled(&Ea, a);
+  get_scaled(&Eb, b);
+  E = (Ea < Eb) ? Ea : Eb;
+  la = a->mantissa_size + ((size_t) ((Ea - E) >> 6)) + ((size_t) 1);
+  lb = b->mantissa_size + ((size_t) ((Eb - E) >> 6)) + ((size_t) 1);
+  l = ((la > lb) ? la : lb) + ((size_t) 1);
+  A = calloc(l, sizeof(*A));
+  B = calloc(l, sizeof(*B));
+  C = calloc(l, sizeof(*C));
+  memcpy(A, a->mantissa, a->mantissa_size * sizeof(*A));
+  memcpy(B, b->mantissa, b->mantissa_size * sizeof(*B));
+  shift_left(A, l, (size_t) (Ea - E));
+  shift_left(B, l, (size_t) (Eb - E));
+  sa = a->sign;
+  sb = (!!(b->sign)) ^ (!!neg);
+  if (sa == sb) {
+    addition(C, A, l, B, l);
+    s = sa;
+  } else if (comparison(A, B, l) >= 0) {
+    subtraction(C, A, l, B, l);
+    s = sa;
+  } else {
+    subtraction(C, B, l, A, l);
+    s = sb;
+  }
+  if (is_zero(C, l)) s = 0;
+  widefloat_set_from_scaled_integer(r, s, E, C, l);
+  free(A);
+  free(B);
+  free(C);
+}
+
+/* Sets r to a * b, computed exactly on integers and rounded by
+   widefloat_set_from_scaled_integer
+*/
+static void reference_mul(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  int64_t Ea, Eb;
+  uint64_t *C;
+
+  get_scaled(&Ea, a);
+  get_scaled(&Eb, b);
+  C = calloc(a->mantissa_size + b->mantissa_size, sizeof(*C));
+  multiplication(C, a->mantissa, a->mantissa_size, b->mantissa, b->mantissa_size);
+  widefloat_set_from_scaled_integer(r, (!!(a->sign)) ^ (!!(b->sign)), Ea + Eb,
+				    C, a->mantissa_size + b->mantissa_size);
+  free(C);
+}
+
+/* Sets r to a / b, computed exactly on integers and rounded by
+   widefloat_set_from_scaled_integer
+*/
+static void reference_div(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  int64_t Ea, Eb;
+  size_t l;
+  uint64_t *A;
+  uint64_t *Q;
+
+  get_scaled(&Ea, a);
+  get_scaled(&Eb, b);
+  l = a->mantissa_size + b->mantissa_size + r->mantissa_size + ((size_t) 1);
+  A = calloc(l, sizeof(*A));
+  Q = calloc(l, sizeof(*Q));
+  memcpy(&A[l - a->mantissa_size], a->mantissa, a->mantissa_size * sizeof(*A));
+  division(Q, NULL, A, l, b->mantissa, b->mantissa_size);
+  widefloat_set_from_scaled_integer(r, (!!(a->sign)) ^ (!!(b->sign)),
+				    Ea - Eb - ((int64_t) ((l - a->mantissa_size) << 6)), Q, l);
+  free(A);
+  free(Q);
+}
+
+/* Returns 0 if x is y or within 2^k units in the last place of y, -1
+   otherwise
+*/
+static int check_close(const widefloat_t *x, const widefloat_t *y, int k) {
+  widefloat_t d;
+  size_t n = y->mantissa_size;
+  int res;
+
+  if (check_equal(x, y) == 0) return 0;
+  if ((x->fpclass != FP_CLASS_NUMBER) || (y->fpclass != FP_CLASS_NUMBER)) return -1;
+  widefloat_init(&d, n + ((size_t) 2));
+  widefloat_sub(&d, x, y);
+  res = 0;
+  if ((!is_zero(d.mantissa, d.mantissa_size)) &&
+      (((int64_t) d.exponent) > ((int64_t) y->exponent) -
+       ((int64_t) ((n << 6) - WIDEFLOAT_OVERHEAD - ((size_t) 1))) + ((int64_t) k))) res = -1;
+  widefloat_clear(&d);
+  return res;
+}
+
+/* Returns 0 if x is y or the floating-point number just below y in
+   magnitude, -1 otherwise
+*/
+static int check_faithful(const widefloat_t *x, const widefloat_t *y) {
+  widefloat_t t;
+  uint64_t one = (uint64_t) 1;
+  size_t n = y->mantissa_size;
+  int res;
+
+  if (check_equal(x, y) == 0) return 0;
+  if ((y->fpclass != FP_CLASS_NUMBER) || is_zero(y->mantissa, n)) return -1;
+  widefloat_init(&t, n);
+  memcpy(t.mantissa, y->mantissa, n * sizeof(*(t.mantissa)));
+  t.fpclass = y->fpclass;
+  t.sign = y->sign;
+  t.exponent = y->exponent;
+  subtraction(t.mantissa, t.mantissa, n, &one, (size_t) 1);
+  if (leading_zeros(t.mantissa, n) > WIDEFLOAT_OVERHEAD) {
+    shift_left(t.mantissa, n, (size_t) 1);
+    t.mantissa[0] |= one;
+    t.exponent--;
+  }
+  res = check_equal(x, &t);
+  widefloat_clear(&t);
+  return res;
+}
+
+/* Checks widefloat_set_from_scaled_integer on integers that are
+   shorter and longer than the mantissa
+*/
+static int test_set(void) {
+  widefloat_t x;
+  uint64_t m[5] = { 1, 0, 0, 0, 0 };
+
+  widefloat_init(&x, (size_t) 3);
+  widefloat_set_from_integer(&x, m, (size_t) 1);
+  if ((x.fpclass != FP_CLASS_NUMBER) || (x.exponent != 0)) return -1;
+  widefloat_set_from_integer(&x, m, (size_t) 5);
+  if (x.exponent != 0) return -1;
+  m[4] = (uint64_t) 1;
+  widefloat_set_from_integer(&x, m, (size_t) 5);
+  if (x.exponent != 256) return -1;
+  widefloat_set_from_scaled_integer(&x, 1, (int64_t) -300, m, (size_t) 5);
+  if ((x.exponent != -44) || (!x.sign)) return -1;
+  widefloat_clear(&x);
+  return 0;
+}
+
+/* Checks additions and subtractions with operands of na and nb digits
+   into a result of nr digits, against the reference, for a range of
+   exponent differences and all signs. r may also be one of the
+   operands.
+*/
+static int test_add_sizes(size_t na, size_t nb, size_t nr) {
+  static const int64_t diffs[] = { 0, 1, 2, 5, 10, 11, 12, 63, 64, 65, 127, 128, 129,
+				   190, 191, 192, 193, 250, 1000, -1, -11, -64, -65, -300 };
+  widefloat_t a, b, r, s, t;
+  size_t i, sg, op, seed;
+  int64_t d;
+
+  widefloat_init(&a, na);
+  widefloat_init(&b, nb);
+  widefloat_init(&r, nr);
+  widefloat_init(&s, nr);
+  widefloat_init(&t, nr);
+  for (seed=0;seed<3;seed++) {
+    for (i=0;i<sizeof(diffs)/sizeof(diffs[0]);i++) {
+      d = diffs[i];
+      for (sg=0;sg<4;sg++) {
+	for (op=0;op<2;op++) {
+	  set_random(&a, (int) (sg & 1), (int64_t) 17, na, (uint64_t) seed);
+	  set_random(&b, (int) (sg >> 1), ((int64_t) 17) - d, nb, (uint64_t) (seed * 7));
+	  if (op) {
+	    widefloat_sub(&r, &a, &b);
+	  } else {
+	    widefloat_add(&r, &a, &b);
+	  }
+	  reference_add(&s, &a, &b, (int) op);
+	  if (check_equal(&r, &s) < 0) return -1;
+
+	  /* The result replaces an operand of the same size */
+	  if (na == nr) {
+	    set_random(&t, (int) (sg & 1), (int64_t) 17, na, (uint64_t) seed);
+	    if (op) {
+	      widefloat_sub(&t, &t, &b);
+	    } else {
+	      widefloat_add(&t, &t, &b);
+	    }
+	    if (check_equal(&t, &s) < 0) return -1;
+	  }
+	  if (nb == nr) {
+	    set_random(&t, (int) (sg >> 1), ((int64_t) 17) - d, nb, (uint64_t) (seed * 7));
+	    if (op) {
+	      widefloat_sub(&t, &a, &t);
+	    } else {
+	      widefloat_add(&t, &a, &t);
+	    }
+	    if (check_equal(&t, &s) < 0) return -1;
+	  }
+	}
+      }
+    }
+  }
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  widefloat_clear(&s);
+  widefloat_clear(&t);
+  return 0;
+}
+
+/* Checks cancellation, zeros and special values */
+static int test_add_special(void) {
+  widefloat_t a, b, r;
+  uint64_t one = (uint64_t) 1;
+  uint64_t two = (uint64_t) 2;
+
+  widefloat_init(&a, (size_t) 2);
+  widefloat_init(&b, (size_t) 2);
+  widefloat_init(&r, (size_t) 2);
+
+  /* a - a and a + a */
+  set_random(&a, 1, (int64_t) 5, (size_t) 2, (uint64_t) 42);
+  widefloat_sub(&r, &a, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || r.sign || (!is_zero(r.mantissa, 2))) return -1;
+  widefloat_add(&r, &a, &a);
+  if ((r.exponent != a.exponent + 1) || (comparison(r.mantissa, a.mantissa, 2) != 0)) return -1;
+
+  /* 1 - 2^-200, rounded toward zero, is the greatest number below 1 */
+  widefloat_set_from_integer(&a, &one, (size_t) 1);
+  widefloat_set_from_scaled_integer(&b, 0, (int64_t) -200, &one, (size_t) 1);
+  widefloat_sub(&r, &a, &b);
+  if ((r.exponent != -1) || (r.mantissa[0] != ~((uint64_t) 0)) ||
+      (r.mantissa[1] != (((uint64_t) 1) << 53) - ((uint64_t) 1))) return -1;
+  widefloat_add(&r, &a, &b);
+  if ((r.exponent != 0) || (comparison(r.mantissa, a.mantissa, 2) != 0)) return -1;
+
+  /* Zeros */
+  widefloat_set_from_integer(&b, NULL, (size_t) 0);
+  widefloat_add(&r, &a, &b);
+  if (comparison(r.mantissa, a.mantissa, 2) != 0) return -1;
+  widefloat_sub(&r, &b, &a);
+  if ((!r.sign) || (r.exponent != 0)) return -1;
+  a.sign = 1;
+  b.sign = 1;
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0, NULL, (size_t) 0);
+  widefloat_add(&r, &a, &b);
+  if ((!r.sign) || (!is_zero(r.mantissa, 2))) return -1;
+
+  /* Infinities and NaN */
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) 0x7fffffff, &one, (size_t) 1);
+  widefloat_set_from_scaled_integer(&b, 0, (int64_t) 0x7fffffff, &one, (size_t) 1);
+  widefloat_add(&r, &a, &b);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0x7fffffff, &two, (size_t) 1);
+  if (a.fpclass != FPCLASS_NEG_INF) return -1;
+  widefloat_add(&r, &r, &a);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+  widefloat_sub(&r, &b, &a);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_sub(&r, &a, &b);
+  if (r.fpclass != FPCLASS_NEG_INF) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  return 0;
+}
+
+/* Checks multiplications with operands of na and nb digits into a
+   result of nr digits against the reference, also with the result in
+   place of the operands
+*/
+static int test_mul_sizes(size_t na, size_t nb, size_t nr) {
+  widefloat_t a, b, r, s, t;
+  size_t seed;
+
+  widefloat_init(&a, na);
+  widefloat_init(&b, nb);
+  widefloat_init(&r, nr);
+  widefloat_init(&s, nr);
+  widefloat_init(&t, nr);
+  for (seed=0;seed<8;seed++) {
+    set_random(&a, (int) (seed & 1), ((int64_t) seed) - 4, na, (uint64_t) seed);
+    set_random(&b, (int) ((seed >> 1) & 1), ((int64_t) 100) * ((int64_t) seed), nb,
+	       (uint64_t) (seed * 3));
+    widefloat_mul(&r, &a, &b);
+    reference_mul(&s, &a, &b);
+    if (check_faithful(&r, &s) < 0) return -1;
+    if (na == nr) {
+      set_random(&t, (int) (seed & 1), ((int64_t) seed) - 4, na, (uint64_t) seed);
+      widefloat_mul(&t, &t, &b);
+      if (check_equal(&t, &r) < 0) return -1;
+      set_random(&t, (int) (seed & 1), ((int64_t) seed) - 4, na, (uint64_t) seed);
+      widefloat_mul(&t, &t, &t);
+      reference_mul(&s, &a, &a);
+      if (check_faithful(&t, &s) < 0) return -1;
+    }
+  }
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  widefloat_clear(&s);
+  widefloat_clear(&t);
+  return 0;
+}
+
+/* Checks products of zeros and special values */
+static int test_mul_special(void) {
+  widefloat_t a, b, r;
+  uint64_t one = (uint64_t) 1;
+  uint64_t two = (uint64_t) 2;
+
+  widefloat_init(&a, (size_t) 2);
+  widefloat_init(&b, (size_t) 2);
+  widefloat_init(&r, (size_t) 2);
+
+  /* Powers of two are exact, overflow gives infinity */
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 1000000000, &one, (size_t) 1);
+  widefloat_set_from_scaled_integer(&b, 0, (int64_t) 1000000000, &two, (size_t) 1);
+  widefloat_mul(&r, &a, &b);
+  if ((r.fpclass != FP_CLASS_NUMBER) || (!r.sign) || (r.exponent != 2000000001) ||
+      (comparison(r.mantissa, a.mantissa, 2) != 0)) return -1;
+  widefloat_mul(&r, &r, &b);
+  if (r.fpclass != FPCLASS_NEG_INF) return -1;
+
+  /* Zero and infinity */
+  widefloat_set_from_integer(&b, NULL, (size_t) 0);
+  widefloat_mul(&a, &a, &b);
+  if ((a.fpclass != FP_CLASS_NUMBER) || (!a.sign) || (!is_zero(a.mantissa, 2))) return -1;
+  widefloat_mul(&a, &a, &r);
+  if (a.fpclass != FPCLASS_NAN) return -1;
+  widefloat_mul(&a, &r, &r);
+  if (a.fpclass != FPCLASS_POS_INF) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  return 0;
+}
+
+/* Checks reciprocals and divisions with operands of na and nb digits
+   into a result of nr digits against the reference. Up to 32 digits,
+   results must be exactly rounded.
+*/
+static int test_div_sizes(size_t na, size_t nb, size_t nr) {
+  widefloat_t a, b, r, s, t, one;
+  uint64_t u = (uint64_t) 1;
+  size_t seed;
+  int k;
+
+  k = (nr <= ((size_t) 32)) ? -1 : 2;
+  widefloat_init(&a, na);
+  widefloat_init(&b, nb);
+  widefloat_init(&r, nr);
+  widefloat_init(&s, nr);
+  widefloat_init(&t, nr);
+  widefloat_init(&one, (size_t) 1);
+  widefloat_set_from_integer(&one, &u, (size_t) 1);
+  for (seed=0;seed<8;seed++) {
+    set_random(&a, (int) (seed & 1), ((int64_t) 1000) * ((int64_t) seed) - 4000, na,
+	       (uint64_t) (seed + 1));
+    set_random(&b, (int) ((seed >> 1) & 1), ((int64_t) 10) - ((int64_t) seed), nb,
+	       (uint64_t) (seed * 5));
+    widefloat_div(&r, &a, &b);
+    reference_div(&s, &a, &b);
+    if (((k < 0) ? check_equal(&r, &s) : check_close(&r, &s, k)) < 0) return -1;
+    widefloat_inv(&r, &b);
+    reference_div(&s, &one, &b);
+    if (((k < 0) ? check_equal(&r, &s) : check_close(&r, &s, k)) < 0) return -1;
+    if (nb == nr) {
+      set_random(&t, (int) ((seed >> 1) & 1), ((int64_t) 10) - ((int64_t) seed), nb,
+		 (uint64_t) (seed * 5));
+      widefloat_inv(&t, &t);
+      if (check_equal(&t, &r) < 0) return -1;
+      set_random(&t, (int) ((seed >> 1) & 1), ((int64_t) 10) - ((int64_t) seed), nb,
+		 (uint64_t) (seed * 5));
+      widefloat_div(&t, &t, &t);
+      if (check_close(&t, &one, 1) < 0) return -1;
+    }
+  }
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  widefloat_clear(&s);
+  widefloat_clear(&t);
+  widefloat_clear(&one);
+  return 0;
+}
+
+/* Checks quotients of zeros and special values */
+static int test_div_special(void) {
+  widefloat_t a, b, r;
+  uint64_t one = (uint64_t) 1;
+  uint64_t three = (uint64_t) 3;
+
+  widefloat_init(&a, (size_t) 2);
+  widefloat_init(&b, (size_t) 2);
+  widefloat_init(&r, (size_t) 2);
+
+  widefloat_set_from_integer(&a, &three, (size_t) 1);
+  widefloat_set_from_integer(&b, NULL, (size_t) 0);
+  widefloat_div(&r, &a, &b);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_inv(&r, &r);
+  if ((r.fpclass != FP_CLASS_NUMBER) || (!is_zero(r.mantissa, 2))) return -1;
+  widefloat_div(&r, &b, &b);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+  widefloat_set_from_scaled_integer(&b, 1, (int64_t) 0x7fffffff, &three, (size_t) 1);
+  widefloat_div(&r, &a, &b);
+  if ((r.fpclass != FP_CLASS_NUMBER) || (!r.sign) || (!is_zero(r.mantissa, 2))) return -1;
+  widefloat_div(&r, &b, &a);
+  if (r.fpclass != FPCLASS_NEG_INF) return -1;
+  widefloat_div(&r, &b, &b);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+
+  /* Exponents out of range */
+  widefloat_set_from_scaled_integer(&b, 0, ((int64_t) INT32_MIN), &one, (size_t) 1);
+  if ((b.fpclass != FP_CLASS_NUMBER) || (b.exponent != INT32_MIN)) return -1;
+  widefloat_inv(&r, &b);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_div(&r, &b, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || (!is_zero(r.mantissa, 2))) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&r);
+  return 0;
+}
+
+/* Checks square roots and reciprocal square roots of n digits by
+   squaring them back
+*/
+static int test_sqrt_sizes(size_t n) {
+  widefloat_t a, r, s, t, one;
+  uint64_t u = (uint64_t) 1;
+  uint64_t nine = (uint64_t) 9;
+  size_t seed;
+
+  widefloat_init(&a, n);
+  widefloat_init(&r, n);
+  widefloat_init(&s, n);
+  widefloat_init(&t, n);
+  widefloat_init(&one, n);
+  widefloat_set_from_integer(&one, &u, (size_t) 1);
+  for (seed=0;seed<8;seed++) {
+    set_random(&a, 0, ((int64_t) 333) * ((int64_t) seed) - 1000, n, (uint64_t) (seed + 2));
+    widefloat_sqrt(&r, &a);
+    widefloat_mul(&s, &r, &r);
+    if (check_close(&s, &a, 3) < 0) return -1;
+    memcpy(t.mantissa, a.mantissa, n * sizeof(*(t.mantissa)));
+    t.fpclass = a.fpclass;
+    t.sign = a.sign;
+    t.exponent = a.exponent;
+    widefloat_sqrt(&t, &t);
+    if (check_equal(&t, &r) < 0) return -1;
+
+    widefloat_rsqrt(&r, &a);
+    widefloat_mul(&s, &r, &r);
+    widefloat_mul(&s, &s, &a);
+    if (check_close(&s, &one, 3) < 0) return -1;
+  }
+
+  /* sqrt(9 * 4^-7) = 3 * 2^-7 */
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) -14, &nine, (size_t) 1);
+  widefloat_sqrt(&r, &a);
+  u = (uint64_t) 3;
+  widefloat_set_from_scaled_integer(&s, 0, (int64_t) -7, &u, (size_t) 1);
+  if (check_close(&r, &s, 1) < 0) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&r);
+  widefloat_clear(&s);
+  widefloat_clear(&t);
+  widefloat_clear(&one);
+  return 0;
+}
+
+/* Checks square roots of zeros, negative numbers and special values */
+static int test_sqrt_special(void) {
+  widefloat_t a, r;
+  uint64_t one = (uint64_t) 1;
+  uint64_t two = (uint64_t) 2;
+
+  widefloat_init(&a, (size_t) 2);
+  widefloat_init(&r, (size_t) 2);
+
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0, &one, (size_t) 1);
+  widefloat_sqrt(&r, &a);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+  widefloat_rsqrt(&r, &a);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0, NULL, (size_t) 0);
+  widefloat_sqrt(&r, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || (!r.sign) || (!is_zero(r.mantissa, 2))) return -1;
+  widefloat_rsqrt(&r, &a);
+  if (r.fpclass != FPCLASS_NEG_INF) return -1;
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) 0x7fffffff, &two, (size_t) 1);
+  widefloat_sqrt(&r, &a);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_rsqrt(&r, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || r.sign || (!is_zero(r.mantissa, 2))) return -1;
+
+  /* The greatest and the least exponents */
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) 0x7fffffff, &one, (size_t) 1);
+  widefloat_sqrt(&r, &a);
+  if (r.exponent != 0x3fffffff) return -1;
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) INT32_MIN, &one, (size_t) 1);
+  widefloat_rsqrt(&r, &a);
+  if ((r.exponent != 0x40000000) || (comparison(r.mantissa, a.mantissa, 2) != 0)) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&r);
+  return 0;
+}
+
+/* Checks exp and log on count pseudo-random numbers of n digits:
+   log(exp(a)) = a, exp(a + b) = exp(a) * exp(b), and the result on n
+   digits against the one on n + 4 digits, which may take the other
+   method
+*/
+static int test_exp_log_sizes(size_t n, size_t count) {
+  widefloat_t a, b, c, r, s, t, w, zero;
+  size_t seed;
+
+  widefloat_init(&a, n);
+  widefloat_init(&b, n);
+  widefloat_init(&c, n + ((size_t) 2));
+  widefloat_init(&r, n);
+  widefloat_init(&s, n);
+  widefloat_init(&t, n);
+  widefloat_init(&w, n + ((size_t) 4));
+  widefloat_init(&zero, (size_t) 1);
+  widefloat_set_from_integer(&zero, NULL, (size_t) 0);
+  for (seed=0;seed<count;seed++) {
+    set_random(&a, (int) (seed & 1), ((int64_t) seed) - ((int64_t) (n << 6)) - 1,
+	       n, (uint64_t) (seed + 3));
+    set_random(&b, (int) ((seed >> 1) & 1), ((int64_t) seed) - ((int64_t) (n << 6)) - 3,
+	       n, (uint64_t) (seed + 11));
+    widefloat_exp(&r, &a);
+    widefloat_log(&s, &r);
+    if (check_close(&s, &a, 4) < 0) return -1;
+
+    widefloat_add(&c, &a, &b);
+    widefloat_exp(&s, &c);
+    widefloat_exp(&t, &b);
+    widefloat_mul(&t, &t, &r);
+    if (check_close(&t, &s, 4) < 0) return -1;
+
+    widefloat_exp(&w, &a);
+    widefloat_add(&t, &w, &zero);
+    if (check_close(&r, &t, 3) < 0) return -1;
+    widefloat_log(&w, &r);
+    widefloat_add(&t, &w, &zero);
+    widefloat_log(&s, &r);
+    if (check_close(&s, &t, 3) < 0) return -1;
+  }
+
+  widefloat_clear(&a);
+  widefloat_clear(&b);
+  widefloat_clear(&c);
+  widefloat_clear(&r);
+  widefloat_clear(&s);
+  widefloat_clear(&t);
+  widefloat_clear(&w);
+  widefloat_clear(&zero);
+  return 0;
+}
+
+/* Checks exp on n > 256 digits, which cuts the argument into
+   bit-burst chunks, against exp on 250 digits, which uses the Taylor
+   series: the result on n digits, rounded down to 250 digits, must be
+   close to the other one. The arguments have at most 240 digits, so
+   that both see the same value.
+*/
+static int test_exp_methods(size_t n, size_t count) {
+  widefloat_t a, r, t, u, zero;
+  size_t seed;
+
+  widefloat_init(&a, n);
+  widefloat_init(&r, n);
+  widefloat_init(&t, (size_t) 250);
+  widefloat_init(&u, (size_t) 250);
+  widefloat_init(&zero, (size_t) 1);
+  widefloat_set_from_integer(&zero, NULL, (size_t) 0);
+  for (seed=0;seed<count;seed++) {
+    set_random(&a, (int) (seed & 1), ((int64_t) seed) - ((int64_t) (240 << 6)) + 2,
+	       (size_t) 240, (uint64_t) (seed + 5));
+    widefloat_exp(&r, &a);
+    widefloat_add(&t, &r, &zero);
+    widefloat_exp(&u, &a);
+    if (check_close(&t, &u, 4) < 0) return -1;
+  }
+
+  widefloat_clear(&a);
+  widefloat_clear(&r);
+  widefloat_clear(&t);
+  widefloat_clear(&u);
+  widefloat_clear(&zero);
+  return 0;
+}
+
+/* Checks exp(1) against the double precision constant, and exp and
+   log on special values
+*/
+static int test_exp_log_special(void) {
+  widefloat_t a, r;
+  uint64_t one = (uint64_t) 1;
+  uint64_t two = (uint64_t) 2;
+  double v;
+
+  widefloat_init(&a, (size_t) 3);
+  widefloat_init(&r, (size_t) 3);
+
+  /* exp(1) and exp(0) */
+  widefloat_set_from_integer(&a, &one, (size_t) 1);
+  widefloat_exp(&r, &a);
+  v = ldexp((double) r.mantissa[2], ((int) r.exponent) - 52);
+  if (fabs(v - 2.718281828459045) > ldexp(1.0, -50)) return -1;
+  widefloat_log(&r, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || r.sign || (!is_zero(r.mantissa, 3))) return -1;
+  widefloat_set_from_integer(&a, NULL, (size_t) 0);
+  widefloat_exp(&r, &a);
+  if ((r.exponent != 0) || (r.mantissa[2] != (one << 52)) || (!is_zero(r.mantissa, 2))) return -1;
+  widefloat_log(&r, &a);
+  if (r.fpclass != FPCLASS_NEG_INF) return -1;
+
+  /* ln(2) = -ln(1/2) */
+  widefloat_set_from_integer(&a, &two, (size_t) 1);
+  widefloat_log(&r, &a);
+  v = ldexp((double) r.mantissa[2], ((int) r.exponent) - 52);
+  if (fabs(v - 0.6931471805599453) > ldexp(1.0, -52)) return -1;
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) -1, &one, (size_t) 1);
+  widefloat_log(&a, &a);
+  a.sign = 0;
+  if (check_close(&a, &r, 1) < 0) return -1;
+
+  /* Overflow, underflow, infinities and NaN */
+  widefloat_set_from_scaled_integer(&a, 0, (int64_t) 40, &one, (size_t) 1);
+  widefloat_exp(&r, &a);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 31, &one, (size_t) 1);
+  widefloat_exp(&r, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || r.sign || (!is_zero(r.mantissa, 3))) return -1;
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0x7fffffff, &two, (size_t) 1);
+  widefloat_exp(&r, &a);
+  if ((r.fpclass != FP_CLASS_NUMBER) || r.sign || (!is_zero(r.mantissa, 3))) return -1;
+  widefloat_log(&r, &a);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+  a.sign = 0;
+  a.fpclass = FPCLASS_POS_INF;
+  widefloat_exp(&r, &a);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  widefloat_log(&r, &a);
+  if (r.fpclass != FPCLASS_POS_INF) return -1;
+  a.fpclass = FPCLASS_NAN;
+  widefloat_exp(&r, &a);
+  if (r.fpclass != FPCLASS_NAN) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&r);
+  return 0;
+}
+
+/* Checks sin(a)^2 + cos(a)^2 = 1, the n-digit results against the
+   ones on n + 4 digits and evaluation in place, on count arguments
+   with exponents from -4 up
+*/
+static int test_sin_cos_sizes(size_t n, size_t count) {
+  widefloat_t a, s, c, t, u, ws, wc, one, zero;
+  uint64_t v = (uint64_t) 1;
+  size_t seed;
+
+  widefloat_init(&a, n);
+  widefloat_init(&s, n);
+  widefloat_init(&c, n);
+  widefloat_init(&t, n);
+  widefloat_init(&u, n);
+  widefloat_init(&ws, n + ((size_t) 4));
+  widefloat_init(&wc, n + ((size_t) 4));
+  widefloat_init(&one, n);
+  widefloat_init(&zero, (size_t) 1);
+  widefloat_set_from_integer(&one, &v, (size_t) 1);
+  widefloat_set_from_integer(&zero, NULL, (size_t) 0);
+  for (seed=0;seed<count;seed++) {
+    set_random(&a, (int) (seed & 1), ((int64_t) (7 * seed)) - ((int64_t) (n << 6)) - 3,
+	       n, (uint64_t) (seed + 5));
+    widefloat_sin_cos(&s, &c, &a);
+    widefloat_mul(&t, &s, &s);
+    widefloat_mul(&u, &c, &c);
+    widefloat_add(&t, &t, &u);
+    if (check_close(&t, &one, 3) < 0) return -1;
+
+    widefloat_sin_cos(&ws, &wc, &a);
+    widefloat_add(&t, &ws, &zero);
+    if (check_close(&s, &t, 3) < 0) return -1;
+    widefloat_add(&t, &wc, &zero);
+    if (check_close(&c, &t, 3) < 0) return -1;
+
+    widefloat_add(&t, &a, &zero);
+    widefloat_sin_cos(NULL, &t, &t);
+    if (check_equal(&t, &c) < 0) return -1;
+    widefloat_sin_cos(&a, NULL, &a);
+    if (check_equal(&a, &s) < 0) return -1;
+  }
+
+  widefloat_clear(&a);
+  widefloat_clear(&s);
+  widefloat_clear(&c);
+  widefloat_clear(&t);
+  widefloat_clear(&u);
+  widefloat_clear(&ws);
+  widefloat_clear(&wc);
+  widefloat_clear(&one);
+  widefloat_clear(&zero);
+  return 0;
+}
+
+/* Checks sin(1) and cos(1) against the double precision constants,
+   and sin and cos on special values
+*/
+static int test_sin_cos_special(void) {
+  widefloat_t a, s, c;
+  uint64_t one = (uint64_t) 1;
+  double v;
+
+  widefloat_init(&a, (size_t) 3);
+  widefloat_init(&s, (size_t) 3);
+  widefloat_init(&c, (size_t) 2);
+
+  widefloat_set_from_integer(&a, &one, (size_t) 1);
+  widefloat_sin_cos(&s, &c, &a);
+  v = ldexp((double) s.mantissa[2], ((int) s.exponent) - 52);
+  if (fabs(v - 0.8414709848078965) > ldexp(1.0, -52)) return -1;
+  v = ldexp((double) c.mantissa[1], ((int) c.exponent) - 52);
+  if (fabs(v - 0.5403023058681398) > ldexp(1.0, -52)) return -1;
+
+  /* sin(-0) = -0, cos(-0) = 1 */
+  widefloat_set_from_scaled_integer(&a, 1, (int64_t) 0, NULL, (size_t) 0);
+  widefloat_sin_cos(&s, &c, &a);
+  if ((s.fpclass != FP_CLASS_NUMBER) || (!s.sign) || (!is_zero(s.mantissa, 3))) return -1;
+  if ((c.exponent != 0) || c.sign || (c.mantissa[1] != (one << 52)) || (c.mantissa[0] != 0)) return -1;
+
+  /* Infinities and NaN */
+  a.fpclass = FPCLASS_NEG_INF;
+  widefloat_sin_cos(&s, &c, &a);
+  if ((s.fpclass != FPCLASS_NAN) || (c.fpclass != FPCLASS_NAN)) return -1;
+  a.fpclass = FPCLASS_NAN;
+  widefloat_sin_cos(NULL, &c, &a);
+  if (c.fpclass != FPCLASS_NAN) return -1;
+
+  widefloat_clear(&a);
+  widefloat_clear(&s);
+  widefloat_clear(&c);
+  return 0;
+}
+
+/* Checks the N twiddle factors on n digits against double precision,
+   against the ones on n + 2 digits, and the exact ones
+*/
+static int test_twiddles(size_t n, size_t N) {
+  widefloat_t *out;
+  widefloat_t *wide;
+  widefloat_t t, zero;
+  double a, v;
+  size_t i, k;
+
+  out = calloc(((size_t) 2) * N, sizeof(*out));
+  wide = calloc(((size_t) 2) * N, sizeof(*wide));
+  if ((out == NULL) || (wide == NULL)) return -1;
+  for (i=0;i<(((size_t) 2) * N);i++) {
+    widefloat_init(&out[i], n);
+    widefloat_init(&wide[i], n + ((size_t) 2));
+  }
+  widefloat_init(&t, n);
+  widefloat_init(&zero, (size_t) 1);
+  widefloat_set_from_integer(&zero, NULL, (size_t) 0);
+  widefloat_twiddles(out, N);
+  widefloat_twiddles(wide, N);
+
+  for (i=0;i<(((size_t) 2) * N);i++) {
+    k = i >> 1;
+    a = 2.0 * 3.141592653589793 * ((double) k) / ((double) N);
+    v = (out[i].fpclass == FP_CLASS_NUMBER) ?
+      ldexp((double) out[i].mantissa[n - ((size_t) 1)], ((int) out[i].exponent) - 52) : 1.0e9;
+    if (out[i].sign) v = -v;
+    if (fabs(v - ((i & 1) ? sin(a) : cos(a))) > ldexp(1.0, -48)) return -1;
+    widefloat_add(&t, &wide[i], &zero);
+    if (check_close(&out[i], &t, 3) < 0) return -1;
+  }
+
+  /* 1 and, when 4 divides N, i are exact */
+  if ((out[0].exponent != 0) || out[0].sign || (!is_zero(out[1].mantissa, n))) return -1;
+  if ((N & ((size_t) 3)) == ((size_t) 0)) {
+    if ((!is_zero(out[N >> 1].mantissa, n)) || out[N >> 1].sign) return -1;
+    if ((out[(N >> 1) + ((size_t) 1)].exponent != 0) ||
+	(out[(N >> 1) + ((size_t) 1)].mantissa[n - ((size_t) 1)] != (((uint64_t) 1) << 52)))
+      return -1;
+  }
+
+  for (i=0;i<(((size_t) 2) * N);i++) {
+    widefloat_clear(&out[i]);
+    widefloat_clear(&wide[i]);
+  }
+  free(out);
+  free(wide);
+  widefloat_clear(&t);
+  widefloat_clear(&zero);
+  return 0;
+}
+
+#define CONSTANT_CALLERS 4
+#define CONSTANT_SIZE    ((size_t) 300)
+
+/* Sets the number pointed to by arg to exp(1) */
+static void *concurrent_exp(void *arg) {
+  widefloat_t *r = (widefloat_t *) arg;
+  widefloat_t a;
+  uint64_t one = (uint64_t) 1;
+
+  widefloat_init(&a, (size_t) 1);
+  widefloat_set_from_integer(&a, &one, (size_t) 1);
+  widefloat_exp(r, &a);
+  widefloat_clear(&a);
+  return NULL;
+}
+
+/* Checks exp(1) computed by several threads of the caller at once,
+   while the cached ln(2) is computed for the first time at this
+   precision, against exp(1) computed by one thread afterwards
+*/
+static int test_concurrent_constants(void) {
+  widefloat_t r[CONSTANT_CALLERS];
+  widefloat_t t;
+  pthread_t ids[CONSTANT_CALLERS];
+  size_t i;
+  int res = 0;
+
+  utepnum_set_threads(3u);
+  for (i=0;i<CONSTANT_CALLERS;i++) {
+    widefloat_init(&r[i], CONSTANT_SIZE);
+    if (pthread_create(&ids[i], NULL, concurrent_exp, &r[i]) != 0) return -1;
+  }
+  for (i=0;i<CONSTANT_CALLERS;i++) {
+    pthread_join(ids[i], NULL);
+  }
+  utepnum_set_threads(1u);
+
+  widefloat_init(&t, CONSTANT_SIZE);
+  concurrent_exp(&t);
+  for (i=0;i<CONSTANT_CALLERS;i++) {
+    if (check_equal(&r[i], &t) < 0) res = -1;
+    widefloat_clear(&r[i]);
+  }
+  widefloat_clear(&t);
+
+  return res;
+}
+
+int main(int argc, char **argv) {
+  if (test_set() < 0) return 1;
+  if (test_concurrent_constants() < 0) return 1;
+  if (test_add_sizes((size_t) 3, (size_t) 3, (size_t) 3) < 0) return 1;
+  if (test_add_sizes((size_t) 1, (size_t) 1, (size_t) 1) < 0) return 1;
+  if (test_add_sizes((size_t) 2, (size_t) 4, (size_t) 4) < 0) return 1;
+  if (test_add_sizes((size_t) 4, (size_t) 2, (size_t) 5) < 0) return 1;
+  if (test_add_special() < 0) return 1;
+  if (test_mul_sizes((size_t) 1, (size_t) 1, (size_t) 1) < 0) return 1;
+  if (test_mul_sizes((size_t) 2, (size_t) 2, (size_t) 2) < 0) return 1;
+  if (test_mul_sizes((size_t) 16, (size_t) 16, (size_t) 16) < 0) return 1;
+  if (test_mul_sizes((size_t) 17, (size_t) 17, (size_t) 17) < 0) return 1;
+  if (test_mul_sizes((size_t) 300, (size_t) 300, (size_t) 300) < 0) return 1;
+  if (test_mul_sizes((size_t) 3, (size_t) 40, (size_t) 25) < 0) return 1;
+  if (test_mul_sizes((size_t) 60, (size_t) 7, (size_t) 60) < 0) return 1;
+  if (test_mul_special() < 0) return 1;
+  if (test_div_sizes((size_t) 1, (size_t) 1, (size_t) 1) < 0) return 1;
+  if (test_div_sizes((size_t) 3, (size_t) 3, (size_t) 3) < 0) return 1;
+  if (test_div_sizes((size_t) 32, (size_t) 32, (size_t) 32) < 0) return 1;
+  if (test_div_sizes((size_t) 33, (size_t) 33, (size_t) 33) < 0) return 1;
+  if (test_div_sizes((size_t) 7, (size_t) 70, (size_t) 70) < 0) return 1;
+  if (test_div_sizes((size_t) 300, (size_t) 300, (size_t) 300) < 0) return 1;
+  if (test_div_special() < 0) return 1;
+  if (test_sqrt_sizes((size_t) 1) < 0) return 1;
+  if (test_sqrt_sizes((size_t) 2) < 0) return 1;
+  if (test_sqrt_sizes((size_t) 9) < 0) return 1;
+  if (test_sqrt_sizes((size_t) 70) < 0) return 1;
+  if (test_sqrt_sizes((size_t) 300) < 0) return 1;
+  if (test_sqrt_special() < 0) return 1;
+  if (test_exp_log_sizes((size_t) 1, (size_t) 8) < 0) return 1;
+  if (test_exp_log_sizes((size_t) 2, (size_t) 8) < 0) return 1;
+  if (test_exp_log_sizes((size_t) 9, (size_t) 8) < 0) return 1;
+  if (test_exp_log_sizes((size_t) 40, (size_t) 4) < 0) return 1;
+  utepnum_set_threads(3u);
+  if (test_exp_log_sizes((size_t) 254, (size_t) 1) < 0) return 1;
+  if (test_exp_log_sizes((size_t) 257, (size_t) 1) < 0) return 1;
+  if (test_exp_log_sizes((size_t) 300, (size_t) 1) < 0) return 1;
+  if (test_exp_methods((size_t) 257, (size_t) 2) < 0) return 1;
+  if (test_exp_methods((size_t) 300, (size_t) 2) < 0) return 1;
+  utepnum_set_threads(1u);
+  if (test_exp_log_special() < 0) return 1;
+  if (test_sin_cos_sizes((size_t) 1, (size_t) 8) < 0) return 1;
+  if (test_sin_cos_sizes((size_t) 3, (size_t) 8) < 0) return 1;
+  if (test_sin_cos_sizes((size_t) 20, (size_t) 4) < 0) return 1;
+  if (test_sin_cos_special() < 0) return 1;
+  if (test_twiddles((size_t) 1, (size_t) 8) < 0) return 1;
+  if (test_twiddles((size_t) 2, (size_t) 12) < 0) return 1;
+  if (test_twiddles((size_t) 2, (size_t) 7) < 0) return 1;
+  if (test_twiddles((size_t) 3, (size_t) 30) < 0) return 1;
+  utepnum_set_threads(3u);
+  if (test_twiddles((size_t) 2, (size_t) 1024) < 0) return 1;
+  utepnum_set_threads(1u);
+
+  /* Signal success */
+  printf("widefloat ok\n");
+  return 0;
+}
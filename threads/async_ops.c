@@ -0,0 +1,542 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "integer_ops.h"
+#include "async_ops.h"
+
+/* Helper functions */
+
+static inline void *__alloc_mem(size_t nmemb, size_t size) {
+  void *ptr;
+
+  ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  return ptr;
+}
+
+static inline void __free_mem(void *ptr) {
+  free(ptr);
+}
+
+/* Asynchronous jobs
+
+   Jobs are queued by priority, first in first out within the same
+   priority, and run by a small set of executor threads, which start
+   with the first job. The executors compute with the thread pool set
+   up with utepnum_set_threads, like any other caller of the library.
+
+   So that urgent jobs never wait behind giant ones, one executor is
+   kept free for jobs of priority ASYNC_PRIORITY_HIGH whenever there is
+   more than one executor. Jobs submitted with ASYNC_PRIORITY_AUTO get
+   their priority from the size of their operands.
+
+   A job handle is referenced by its submitter and by the executors
+   until the job is done. It gets freed when both are done with it,
+   i.e. when the job is done or cancelled and the submitter has called
+   async_release.
+
+   A single mutex protects the queues and the state of all jobs. Every
+   job has a condition variable for the threads that wait for it.
+
+*/
+#define ASYNC_PRIORITIES 3
+#define ASYNC_EXECUTORS_DEFAULT 2u
+#define ASYNC_SMALL_LIMBS ((size_t) 1024)
+#define ASYNC_LARGE_LIMBS ((size_t) 65536)
+
+typedef enum {
+  ASYNC_OP_MULTIPLICATION = 0,
+  ASYNC_OP_DIVISION,
+  ASYNC_OP_TO_STRING,
+  ASYNC_OP_FROM_STRING
+} __async_op_t;
+
+struct __async_job_struct_t {
+  struct __async_job_struct_t *prev;
+  struct __async_job_struct_t *next;
+  __async_op_t                op;
+  uint64_t                    *p;
+  uint64_t                    *q;
+  const uint64_t              *a;
+  const uint64_t              *b;
+  size_t                      m;
+  size_t                      n;
+  char                        *str;
+  const char                  *cstr;
+  unsigned int                base;
+  int                         priority;
+  async_callback_t            callback;
+  void                        *arg;
+  async_status_t              status;
+  int                         result;
+  int                         refs;
+  int                         fd;
+  pthread_t                   executor;
+  pthread_cond_t              cond;
+};
+
+typedef struct {
+  async_job_t *head;
+  async_job_t *tail;
+} __async_queue_t;
+
+static pthread_mutex_t __async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t __async_cond = PTHREAD_COND_INITIALIZER;
+static __async_queue_t __async_queues[ASYNC_PRIORITIES];
+static unsigned int __async_target = ASYNC_EXECUTORS_DEFAULT;
+static unsigned int __async_executors = 0u;
+static unsigned int __async_busy_low = 0u;
+
+/* Appends job to the queue of its priority */
+static inline void __async_enqueue(async_job_t *job) {
+  __async_queue_t *queue = &__async_queues[job->priority];
+
+  job->next = NULL;
+  job->prev = queue->tail;
+  if (queue->tail != NULL) {
+    queue->tail->next = job;
+  } else {
+    queue->head = job;
+  }
+  queue->tail = job;
+}
+
+/* Removes job from the queue of its priority */
+static inline void __async_dequeue(async_job_t *job) {
+  __async_queue_t *queue = &__async_queues[job->priority];
+
+  if (job->prev != NULL) {
+    job->prev->next = job->next;
+  } else {
+    queue->head = job->next;
+  }
+  if (job->next != NULL) {
+    job->next->prev = job->prev;
+  } else {
+    queue->tail = job->prev;
+  }
+  job->prev = NULL;
+  job->next = NULL;
+}
+
+/* Returns the next job an executor may start, or NULL.
+
+   Jobs that are not urgent are only started if another executor stays
+   available for urgent ones.
+
+*/
+static inline async_job_t *__async_next(void) {
+  int i;
+
+  if (__async_queues[ASYNC_PRIORITY_HIGH].head != NULL) {
+    return __async_queues[ASYNC_PRIORITY_HIGH].head;
+  }
+  if ((__async_executors > 1u) &&
+      ((__async_busy_low + 1u) >= __async_executors)) {
+    return NULL;
+  }
+  for (i=ASYNC_PRIORITY_HIGH + 1;i<ASYNC_PRIORITIES;i++) {
+    if (__async_queues[i].head != NULL) return __async_queues[i].head;
+  }
+
+  return NULL;
+}
+
+/* Frees job if nobody references it anymore. Must be called with the
+   mutex held.
+*/
+static inline void __async_unref(async_job_t *job) {
+  job->refs--;
+  if (job->refs > 0) return;
+  if (job->fd >= 0) close(job->fd);
+  pthread_cond_destroy(&job->cond);
+  __free_mem(job);
+}
+
+/* Makes the eventfd fd readable. A single write cannot overflow the
+   counter, so there is nothing to do if it fails.
+*/
+static inline void __async_signal(int fd) {
+  uint64_t one;
+  ssize_t res;
+
+  one = (uint64_t) 1;
+  res = write(fd, &one, sizeof(one));
+  (void) res;
+}
+
+/* Marks job as finished with status and wakes up everyone waiting for
+   it. Must be called with the mutex held.
+*/
+static inline void __async_finish(async_job_t *job, async_status_t status) {
+  job->status = status;
+  if (job->fd >= 0) __async_signal(job->fd);
+  pthread_cond_broadcast(&job->cond);
+}
+
+/* Runs the operation of job and returns its result */
+static int __async_run(async_job_t *job) {
+  switch (job->op) {
+  case ASYNC_OP_MULTIPLICATION:
+    multiplication(job->p, job->a, job->m, job->b, job->n);
+    return 0;
+  case ASYNC_OP_DIVISION:
+    return division(job->q, job->p, job->a, job->m, job->b, job->n);
+  case ASYNC_OP_TO_STRING:
+    convert_to_string_base(job->str, job->a, job->n, job->base);
+    return 0;
+  case ASYNC_OP_FROM_STRING:
+    return convert_from_string_base(job->p, job->n, job->cstr, job->base);
+  }
+
+  return -1;
+}
+
+/* The main function of the executor threads */
+static void *__async_executor(void *arg) {
+  async_job_t *job;
+  int low;
+
+  (void) arg;
+  pthread_mutex_lock(&__async_mutex);
+  for (;;) {
+    while (((job = __async_next()) == NULL) &&
+	   (__async_executors <= __async_target)) {
+      pthread_cond_wait(&__async_cond, &__async_mutex);
+    }
+    if (__async_executors > __async_target) break;
+
+    /* Take the job and run it without holding the mutex */
+    __async_dequeue(job);
+    job->status = ASYNC_RUNNING;
+    job->executor = pthread_self();
+    low = (job->priority != ASYNC_PRIORITY_HIGH);
+    if (low) __async_busy_low++;
+    pthread_mutex_unlock(&__async_mutex);
+
+    job->result = __async_run(job);
+    if (job->callback != NULL) job->callback(job, job->result, job->arg);
+
+    pthread_mutex_lock(&__async_mutex);
+    if (low) {
+      __async_busy_low--;
+      pthread_cond_broadcast(&__async_cond);
+    }
+    __async_finish(job, ASYNC_DONE);
+    __async_unref(job);
+  }
+  __async_executors--;
+  pthread_cond_broadcast(&__async_cond);
+  pthread_mutex_unlock(&__async_mutex);
+
+  return NULL;
+}
+
+/* Starts executors until there are as many as requested. Must be
+   called with the mutex held.
+
+   Returns 0 if there is at least one executor, -1 otherwise.
+
+*/
+static int __async_start_executors(void) {
+  pthread_attr_t attr;
+  pthread_t id;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  while (__async_executors < __async_target) {
+    if (pthread_create(&id, &attr, __async_executor, NULL) != 0) break;
+    __async_executors++;
+  }
+  pthread_attr_destroy(&attr);
+
+  return (__async_executors > 0u) ? 0 : -1;
+}
+
+/* Sets the number of executor threads to n, which is at least 1.
+
+   Executors beyond n exit once they are done with their current job.
+
+*/
+void async_set_executors(unsigned int n) {
+  if (n < 1u) n = 1u;
+  pthread_mutex_lock(&__async_mutex);
+  __async_target = n;
+  if (__async_executors > 0u) __async_start_executors();
+  pthread_cond_broadcast(&__async_cond);
+  pthread_mutex_unlock(&__async_mutex);
+}
+
+/* Returns a new job for op, with its priority set from priority or,
+   for ASYNC_PRIORITY_AUTO, from its size in digits.
+*/
+static async_job_t *__async_job(__async_op_t op, size_t size, int priority,
+				async_callback_t callback, void *arg) {
+  async_job_t *job;
+
+  job = (async_job_t *) __alloc_mem(((size_t) 1), sizeof(*job));
+  job->op = op;
+  if ((priority < ASYNC_PRIORITY_HIGH) || (priority >= ASYNC_PRIORITIES)) {
+    if (size < ASYNC_SMALL_LIMBS) {
+      priority = ASYNC_PRIORITY_HIGH;
+    } else if (size < ASYNC_LARGE_LIMBS) {
+      priority = ASYNC_PRIORITY_NORMAL;
+    } else {
+      priority = ASYNC_PRIORITY_LOW;
+    }
+  }
+  job->priority = priority;
+  job->callback = callback;
+  job->arg = arg;
+  job->status = ASYNC_PENDING;
+  job->fd = -1;
+  pthread_cond_init(&job->cond, NULL);
+
+  return job;
+}
+
+/* Queues job for the executors.
+
+   Returns job, or NULL if no executor can be started, in which case
+   job is freed.
+
+*/
+static async_job_t *__async_submit(async_job_t *job) {
+  pthread_mutex_lock(&__async_mutex);
+  if (__async_start_executors() < 0) {
+    pthread_mutex_unlock(&__async_mutex);
+    pthread_cond_destroy(&job->cond);
+    __free_mem(job);
+    return NULL;
+  }
+  job->refs = 2;
+  __async_enqueue(job);
+  pthread_cond_broadcast(&__async_cond);
+  pthread_mutex_unlock(&__async_mutex);
+
+  return job;
+}
+
+/* Submits the computation of p = a * b, with a on m digits and b on
+   n digits, as for multiplication.
+
+   The arrays must stay in place until the job is done or cancelled.
+
+   The job gets priority priority, one of ASYNC_PRIORITY_HIGH,
+   ASYNC_PRIORITY_NORMAL and ASYNC_PRIORITY_LOW, or a priority from the
+   size of the operands with ASYNC_PRIORITY_AUTO. If callback is not
+   NULL, it is called by the executor with the result of the job and
+   arg once the job has been computed, right before the job counts as
+   done. The callback must thus not wait for its own job: async_wait
+   returns -1 right away when called from it.
+
+   Returns a handle for the job, which needs to be released with
+   async_release, or NULL if the job cannot be run.
+
+*/
+async_job_t *async_multiplication(uint64_t *p,
+				  const uint64_t *a, size_t m,
+				  const uint64_t *b, size_t n,
+				  int priority,
+				  async_callback_t callback, void *arg) {
+  async_job_t *job;
+
+  job = __async_job(ASYNC_OP_MULTIPLICATION, m + n, priority, callback, arg);
+  job->p = p;
+  job->a = a;
+  job->m = m;
+  job->b = b;
+  job->n = n;
+
+  return __async_submit(job);
+}
+
+/* Submits the division of a, on m digits, by b, on n digits, as for
+   division. The result of the job is the one of division.
+
+   See async_multiplication for the other arguments.
+
+*/
+async_job_t *async_division(uint64_t *q, uint64_t *r,
+			    const uint64_t *a, size_t m,
+			    const uint64_t *b, size_t n,
+			    int priority,
+			    async_callback_t callback, void *arg) {
+  async_job_t *job;
+
+  job = __async_job(ASYNC_OP_DIVISION, m, priority, callback, arg);
+  job->q = q;
+  job->p = r;
+  job->a = a;
+  job->m = m;
+  job->b = b;
+  job->n = n;
+
+  return __async_submit(job);
+}
+
+/* Submits the conversion of a, on n digits, to a string in radix
+   base, as for convert_to_string_base.
+
+   See async_multiplication for the other arguments.
+
+*/
+async_job_t *async_convert_to_string_base(char *str,
+					  const uint64_t *a, size_t n,
+					  unsigned int base,
+					  int priority,
+					  async_callback_t callback, void *arg) {
+  async_job_t *job;
+
+  job = __async_job(ASYNC_OP_TO_STRING, n, priority, callback, arg);
+  job->str = str;
+  job->a = a;
+  job->n = n;
+  job->base = base;
+
+  return __async_submit(job);
+}
+
+/* Submits the conversion of str in radix base to a, on n digits, as
+   for convert_from_string_base. The result of the job is the one of
+   convert_from_string_base.
+
+   See async_multiplication for the other arguments.
+
+*/
+async_job_t *async_convert_from_string_base(uint64_t *a, size_t n,
+					    const char *str,
+					    unsigned int base,
+					    int priority,
+					    async_callback_t callback, void *arg) {
+  async_job_t *job;
+
+  job = __async_job(ASYNC_OP_FROM_STRING, n, priority, callback, arg);
+  job->p = a;
+  job->n = n;
+  job->cstr = str;
+  job->base = base;
+
+  return __async_submit(job);
+}
+
+/* Returns the status of job without waiting */
+async_status_t async_poll(async_job_t *job) {
+  async_status_t status;
+
+  pthread_mutex_lock(&__async_mutex);
+  status = job->status;
+  pthread_mutex_unlock(&__async_mutex);
+
+  return status;
+}
+
+/* Waits until job is done or cancelled.
+
+   Returns the result of the job, or -1 if it has been cancelled or if
+   called from the callback of job, which runs before the job is done.
+
+*/
+int async_wait(async_job_t *job) {
+  int res;
+
+  pthread_mutex_lock(&__async_mutex);
+  if ((job->status == ASYNC_RUNNING) && pthread_equal(job->executor, pthread_self())) {
+    pthread_mutex_unlock(&__async_mutex);
+    return -1;
+  }
+  while ((job->status != ASYNC_DONE) && (job->status != ASYNC_CANCELLED)) {
+    pthread_cond_wait(&job->cond, &__async_mutex);
+  }
+  res = (job->status == ASYNC_DONE) ? job->result : -1;
+  pthread_mutex_unlock(&__async_mutex);
+
+  return res;
+}
+
+/* Cancels job if it has not been started yet. Its callback does not
+   get called.
+
+   Returns 0 if the job has been cancelled, -1 if it is already
+   running or finished.
+
+*/
+int async_cancel(async_job_t *job) {
+  int res;
+
+  pthread_mutex_lock(&__async_mutex);
+  if (job->status == ASYNC_PENDING) {
+    __async_dequeue(job);
+    __async_finish(job, ASYNC_CANCELLED);
+    __async_unref(job);
+    res = 0;
+  } else {
+    res = -1;
+  }
+  pthread_mutex_unlock(&__async_mutex);
+
+  return res;
+}
+
+/* Returns an eventfd file descriptor that becomes readable once job
+   is done or cancelled, e.g. for use with epoll.
+
+   The descriptor belongs to the job and gets closed by async_release.
+
+   Returns -1 if no descriptor can be created.
+
+*/
+int async_eventfd(async_job_t *job) {
+  int fd;
+
+  pthread_mutex_lock(&__async_mutex);
+  if (job->fd < 0) {
+    job->fd = eventfd(0u, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ((job->fd >= 0) &&
+	((job->status == ASYNC_DONE) || (job->status == ASYNC_CANCELLED))) {
+      __async_signal(job->fd);
+    }
+  }
+  fd = job->fd;
+  pthread_mutex_unlock(&__async_mutex);
+
+  return fd;
+}
+
+/* Releases the handle of job.
+
+   A job that has not finished yet still gets computed, so its arrays
+   must stay in place until then. Use async_cancel first to drop a
+   pending job.
+
+*/
+void async_release(async_job_t *job) {
+  if (job == NULL) return;
+  pthread_mutex_lock(&__async_mutex);
+  __async_unref(job);
+  pthread_mutex_unlock(&__async_mutex);
+}
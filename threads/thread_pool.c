@@ -0,0 +1,697 @@
+/* Copyright (C) 2023 University of Texas at El Paso
+
+   Contributed by: Christoph Lauter
+
+                   and the 2023 class of CS4390/5390
+
+		   Applied Numerical Computing for Multimedia
+		   Applications.
+
+   All rights reserved.
+
+   NO LICENSE SPECIFIED.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "thread_pool.h"
+
+/* Helper functions */
+
+static inline void *__alloc_mem(size_t nmemb, size_t size) {
+  void *ptr;
+
+  ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  return ptr;
+}
+
+static inline void __free_mem(void *ptr) {
+  free(ptr);
+}
+
+/* The thread pool
+
+   The pool consists of n - 1 worker threads, where n is the number of
+   threads set with utepnum_set_threads. The thread that calls into
+   the library is the n-th thread: it works on its own share of the
+   computation and helps the workers while it waits for them.
+
+   Every worker owns a deque of tasks. A worker pushes the tasks it
+   forks to the bottom of its own deque and takes them back from the
+   bottom, so that it works depth-first on the most recent, smallest
+   tasks. Idle threads steal from the top of the other deques, where
+   the oldest and largest tasks are. Threads that are not workers of
+   the pool share one more deque.
+
+   The deques are small ring buffers protected by a mutex each. The
+   tasks are coarse (the callers fork only above a granularity
+   cutoff), so the locks are taken rarely and held very briefly.
+
+   A task belongs to whoever removes it from its deque. When a thread
+   joins a task that is still in its deque, it removes it and runs it
+   itself. Otherwise, some other thread has stolen the task, and the
+   joining thread runs queued subtasks of that task, at any depth,
+   until the thief marks the task as done. Every task records the task
+   that was running on the thread that forked it, so that these
+   subtasks can be told apart from the tasks of other callers.
+
+   The joining thread never runs unrelated tasks: it may be inside a
+   critical section of its caller, and an unrelated task could need
+   the same lock. Still, callers must not hold a lock across
+   thread_pool_fork and thread_pool_join that their own subtasks
+   take.
+
+   Workers that find no task sleep on a condition variable. The count
+   of queued tasks is incremented before a task is pushed and the count
+   of sleeping workers is incremented before a worker checks for
+   queued tasks, so that no wake-up can get lost.
+
+*/
+#define THREAD_POOL_MAX_THREADS ((unsigned int) 1024)
+#define THREAD_POOL_DEQUE_SIZE ((size_t) 256)
+
+#define THREAD_TASK_PENDING 0
+#define THREAD_TASK_RUNNING 1
+#define THREAD_TASK_DONE    2
+
+typedef struct {
+  pthread_mutex_t mutex;
+  size_t          top;
+  size_t          count;
+  thread_task_t   *tasks[THREAD_POOL_DEQUE_SIZE];
+} __thread_deque_t;
+
+struct __thread_pool_struct_t;
+
+typedef struct {
+  struct __thread_pool_struct_t *pool;
+  unsigned int                  index;
+} __thread_worker_t;
+
+typedef struct __thread_pool_struct_t {
+  unsigned int      threads;
+  unsigned int      workers;
+  pthread_t         *ids;
+  __thread_worker_t *args;
+  __thread_deque_t  *deques;
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;
+  int               stop;
+  unsigned int      sleepers;
+  long              pending;
+} __thread_pool_t;
+
+static __thread_pool_t *__thread_pool = NULL;
+static pthread_mutex_t __thread_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t __thread_pool_once = PTHREAD_ONCE_INIT;
+
+/* The pool the current thread works for, if it is a worker, and its
+   index in that pool.
+*/
+static __thread __thread_pool_t *__thread_pool_self_pool = NULL;
+static __thread unsigned int __thread_pool_self_index = 0u;
+
+/* The task the current thread is running, NULL outside of tasks */
+static __thread thread_task_t *__thread_pool_current = NULL;
+
+/* Returns the index of the deque the current thread pushes to in
+   pool.
+*/
+static inline unsigned int __thread_pool_self(const __thread_pool_t *pool) {
+  if (__thread_pool_self_pool == pool) return __thread_pool_self_index;
+  return pool->workers;
+}
+
+/* Pushes task to the bottom of deque d.
+
+   Returns 1 on success and 0 if the deque is full.
+
+*/
+static inline int __thread_deque_push(__thread_deque_t *d, thread_task_t *task) {
+  int res;
+
+  pthread_mutex_lock(&d->mutex);
+  if (d->count < THREAD_POOL_DEQUE_SIZE) {
+    d->tasks[(d->top + d->count) % THREAD_POOL_DEQUE_SIZE] = task;
+    d->count++;
+    res = 1;
+  } else {
+    res = 0;
+  }
+  pthread_mutex_unlock(&d->mutex);
+
+  return res;
+}
+
+/* Takes a task from deque d, from the bottom if bottom is non-zero,
+   from the top otherwise.
+
+   Returns NULL if the deque is empty.
+
+*/
+static inline thread_task_t *__thread_deque_take(__thread_deque_t *d, int bottom) {
+  thread_task_t *task;
+
+  pthread_mutex_lock(&d->mutex);
+  if (d->count == ((size_t) 0)) {
+    task = NULL;
+  } else if (bottom) {
+    d->count--;
+    task = d->tasks[(d->top + d->count) % THREAD_POOL_DEQUE_SIZE];
+  } else {
+    task = d->tasks[d->top];
+    d->top = (d->top + ((size_t) 1)) % THREAD_POOL_DEQUE_SIZE;
+    d->count--;
+  }
+  pthread_mutex_unlock(&d->mutex);
+
+  return task;
+}
+
+/* Returns 1 if task is a subtask of ancestor, at any depth, 0
+   otherwise.
+
+   The ancestors of a queued task are all running, as a task joins
+   all its subtasks before it is done, so the chain stays valid while
+   the task is in its deque.
+
+*/
+static inline int __thread_task_descends(const thread_task_t *task, const thread_task_t *ancestor) {
+  for (task=task->parent;task!=NULL;task=task->parent) {
+    if (task == ancestor) return 1;
+  }
+  return 0;
+}
+
+/* Takes the task closest to the top of deque d that is a subtask of
+   ancestor.
+
+   Returns NULL if there is no such task.
+
+*/
+static inline thread_task_t *__thread_deque_take_subtask(__thread_deque_t *d,
+							 const thread_task_t *ancestor) {
+  thread_task_t *task;
+  size_t i, j;
+
+  pthread_mutex_lock(&d->mutex);
+  task = NULL;
+  for (i=0;i<d->count;i++) {
+    if (__thread_task_descends(d->tasks[(d->top + i) % THREAD_POOL_DEQUE_SIZE], ancestor)) {
+      task = d->tasks[(d->top + i) % THREAD_POOL_DEQUE_SIZE];
+      for (j=i+((size_t) 1);j<d->count;j++) {
+	d->tasks[(d->top + j - ((size_t) 1)) % THREAD_POOL_DEQUE_SIZE] =
+	  d->tasks[(d->top + j) % THREAD_POOL_DEQUE_SIZE];
+      }
+      d->count--;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&d->mutex);
+
+  return task;
+}
+
+/* Removes task from deque d, searching from the bottom.
+
+   Returns 1 if the task was found, 0 if some other thread has taken
+   it already.
+
+*/
+static inline int __thread_deque_remove(__thread_deque_t *d, thread_task_t *task) {
+  size_t i, j;
+  int res;
+
+  pthread_mutex_lock(&d->mutex);
+  res = 0;
+  for (i=d->count;i>((size_t) 0);i--) {
+    if (d->tasks[(d->top + i - ((size_t) 1)) % THREAD_POOL_DEQUE_SIZE] == task) {
+      for (j=i;j<d->count;j++) {
+	d->tasks[(d->top + j - ((size_t) 1)) % THREAD_POOL_DEQUE_SIZE] =
+	  d->tasks[(d->top + j) % THREAD_POOL_DEQUE_SIZE];
+      }
+      d->count--;
+      res = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&d->mutex);
+
+  return res;
+}
+
+/* Runs a task that the current thread has taken from a deque */
+static inline void __thread_task_run(thread_task_t *task) {
+  thread_task_t *prev;
+
+  prev = __thread_pool_current;
+  __thread_pool_current = task;
+  __atomic_store_n(&task->state, THREAD_TASK_RUNNING, __ATOMIC_RELAXED);
+  task->func(task->arg);
+  __thread_pool_current = prev;
+  __atomic_store_n(&task->state, THREAD_TASK_DONE, __ATOMIC_RELEASE);
+}
+
+/* Finds a task for the thread working on deque self of pool.
+
+   Looks at the bottom of the thread's own deque first, then steals
+   from the top of the other deques, starting with the next one.
+
+   Returns NULL if there is no queued task.
+
+*/
+static thread_task_t *__thread_pool_find(__thread_pool_t *pool, unsigned int self) {
+  thread_task_t *task;
+  unsigned int i, d;
+
+  if (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) <= 0l) return NULL;
+
+  for (i=0u;i<=pool->workers;i++) {
+    d = (self + i) % (pool->workers + 1u);
+    task = __thread_deque_take(&pool->deques[d], (i == 0u));
+    if (task != NULL) {
+      __atomic_sub_fetch(&pool->pending, 1l, __ATOMIC_SEQ_CST);
+      return task;
+    }
+  }
+
+  return NULL;
+}
+
+/* Finds a queued subtask of ancestor in any deque of pool.
+
+   Returns NULL if there is none.
+
+*/
+static thread_task_t *__thread_pool_find_subtask(__thread_pool_t *pool,
+						 const thread_task_t *ancestor) {
+  thread_task_t *task;
+  unsigned int d;
+
+  if (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) <= 0l) return NULL;
+
+  for (d=0u;d<=pool->workers;d++) {
+    task = __thread_deque_take_subtask(&pool->deques[d], ancestor);
+    if (task != NULL) {
+      __atomic_sub_fetch(&pool->pending, 1l, __ATOMIC_SEQ_CST);
+      return task;
+    }
+  }
+
+  return NULL;
+}
+
+/* The main function of the worker threads */
+static void *__thread_pool_worker(void *arg) {
+  __thread_worker_t *worker = (__thread_worker_t *) arg;
+  __thread_pool_t *pool = worker->pool;
+  thread_task_t *task;
+
+  __thread_pool_self_pool = pool;
+  __thread_pool_self_index = worker->index;
+
+  for (;;) {
+    task = __thread_pool_find(pool, worker->index);
+    if (task != NULL) {
+      __thread_task_run(task);
+      continue;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->stop) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+    __atomic_add_fetch(&pool->sleepers, 1u, __ATOMIC_SEQ_CST);
+    while ((__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) <= 0l) &&
+	   (!pool->stop)) {
+      pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    __atomic_sub_fetch(&pool->sleepers, 1u, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  return NULL;
+}
+
+/* Stops the workers of pool, waits for them and frees the pool.
+
+   There must not be any queued task left.
+
+*/
+static void __thread_pool_destroy(__thread_pool_t *pool, unsigned int started) {
+  unsigned int i;
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+  for (i=0u;i<started;i++) {
+    pthread_join(pool->ids[i], NULL);
+  }
+  for (i=0u;i<=pool->workers;i++) {
+    pthread_mutex_destroy(&pool->deques[i].mutex);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->cond);
+  __free_mem(pool->ids);
+  __free_mem(pool->args);
+  __free_mem(pool->deques);
+  __free_mem(pool);
+}
+
+/* Creates a pool of threads - 1 workers.
+
+   Returns NULL if the workers cannot be started.
+
+*/
+static __thread_pool_t *__thread_pool_create(unsigned int threads) {
+  __thread_pool_t *pool;
+  unsigned int i;
+
+  pool = (__thread_pool_t *) __alloc_mem(((size_t) 1), sizeof(*pool));
+  pool->threads = threads;
+  pool->workers = threads - 1u;
+  pool->ids = (pthread_t *) __alloc_mem((size_t) pool->workers, sizeof(*pool->ids));
+  pool->args = (__thread_worker_t *) __alloc_mem((size_t) pool->workers, sizeof(*pool->args));
+  pool->deques = (__thread_deque_t *) __alloc_mem(((size_t) pool->workers) + ((size_t) 1),
+						  sizeof(*pool->deques));
+  for (i=0u;i<=pool->workers;i++) {
+    pthread_mutex_init(&pool->deques[i].mutex, NULL);
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+  for (i=0u;i<pool->workers;i++) {
+    pool->args[i].pool = pool;
+    pool->args[i].index = i;
+    if (pthread_create(&pool->ids[i], NULL, __thread_pool_worker, &pool->args[i]) != 0) {
+      __thread_pool_destroy(pool, i);
+      return NULL;
+    }
+  }
+
+  return pool;
+}
+
+/* Handlers for fork(): the child process has none of the workers, so
+   it starts over without a pool. The pool's memory is left behind.
+*/
+static void __thread_pool_atfork_prepare(void) {
+  pthread_mutex_lock(&__thread_pool_mutex);
+}
+
+static void __thread_pool_atfork_parent(void) {
+  pthread_mutex_unlock(&__thread_pool_mutex);
+}
+
+static void __thread_pool_atfork_child(void) {
+  __atomic_store_n(&__thread_pool, NULL, __ATOMIC_SEQ_CST);
+  __thread_pool_self_pool = NULL;
+  pthread_mutex_init(&__thread_pool_mutex, NULL);
+}
+
+static void __thread_pool_init(void) {
+  pthread_atfork(__thread_pool_atfork_prepare,
+		 __thread_pool_atfork_parent,
+		 __thread_pool_atfork_child);
+}
+
+/* Sets the number of threads the library uses to n.
+
+   n = 1 means that everything is computed by the calling thread,
+   which is the default. n = 0 means one thread per online processor.
+
+   If the worker threads cannot be started, the library stays
+   sequential.
+
+   Must not be called while some other thread is inside the library.
+
+*/
+void utepnum_set_threads(unsigned int n) {
+  __thread_pool_t *pool;
+  long cpus;
+
+  pthread_once(&__thread_pool_once, __thread_pool_init);
+
+  if (n == 0u) {
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    n = (cpus > 0l) ? ((unsigned int) cpus) : 1u;
+  }
+  if (n > THREAD_POOL_MAX_THREADS) n = THREAD_POOL_MAX_THREADS;
+
+  pthread_mutex_lock(&__thread_pool_mutex);
+  pool = __atomic_load_n(&__thread_pool, __ATOMIC_ACQUIRE);
+  if (((pool == NULL) && (n == 1u)) ||
+      ((pool != NULL) && (pool->threads == n))) {
+    pthread_mutex_unlock(&__thread_pool_mutex);
+    return;
+  }
+  __atomic_store_n(&__thread_pool, NULL, __ATOMIC_RELEASE);
+  if (pool != NULL) {
+    __thread_pool_destroy(pool, pool->workers);
+  }
+  if (n > 1u) {
+    pool = __thread_pool_create(n);
+    __atomic_store_n(&__thread_pool, pool, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&__thread_pool_mutex);
+}
+
+/* Returns the number of threads the library uses */
+unsigned int utepnum_get_threads(void) {
+  __thread_pool_t *pool;
+
+  pool = __atomic_load_n(&__thread_pool, __ATOMIC_ACQUIRE);
+  if (pool == NULL) return 1u;
+  return pool->threads;
+}
+
+/* Forks a task that calls func(arg).
+
+   The task may get run by any thread of the pool, until it gets
+   joined with thread_pool_join. The variable pointed to by task must
+   stay in place until then.
+
+   If there is no pool or the current thread's deque is full, the task
+   is run right away.
+
+*/
+void thread_pool_fork(thread_task_t *task, thread_task_func_t func, void *arg) {
+  __thread_pool_t *pool;
+  unsigned int self;
+
+  task->func = func;
+  task->arg = arg;
+  task->state = THREAD_TASK_PENDING;
+  task->queue = -1;
+  task->parent = __thread_pool_current;
+
+  pool = __atomic_load_n(&__thread_pool, __ATOMIC_ACQUIRE);
+  if (pool != NULL) {
+    self = __thread_pool_self(pool);
+    task->queue = (int) self;
+    __atomic_add_fetch(&pool->pending, 1l, __ATOMIC_SEQ_CST);
+    if (__thread_deque_push(&pool->deques[self], task)) {
+      if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0u) {
+	pthread_mutex_lock(&pool->mutex);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+      }
+      return;
+    }
+    __atomic_sub_fetch(&pool->pending, 1l, __ATOMIC_SEQ_CST);
+    task->queue = -1;
+  }
+
+  __thread_task_run(task);
+}
+
+/* Waits for a task forked with thread_pool_fork to be done.
+
+   If no other thread has taken the task yet, the current thread runs
+   it. Otherwise, it runs queued subtasks of the task until the task
+   is done.
+
+*/
+void thread_pool_join(thread_task_t *task) {
+  __thread_pool_t *pool;
+  thread_task_t *other;
+
+  if (task->queue < 0) return;
+
+  pool = __atomic_load_n(&__thread_pool, __ATOMIC_ACQUIRE);
+  if (__thread_deque_remove(&pool->deques[task->queue], task)) {
+    __atomic_sub_fetch(&pool->pending, 1l, __ATOMIC_SEQ_CST);
+    __thread_task_run(task);
+    return;
+  }
+
+  while (__atomic_load_n(&task->state, __ATOMIC_ACQUIRE) != THREAD_TASK_DONE) {
+    other = __thread_pool_find_subtask(pool, task);
+    if (other != NULL) {
+      __thread_task_run(other);
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+/* Per-thread scratch memory
+
+   Every thread has its own stack of scratch memory chunks, so that
+   the temporaries of recursive algorithms never go through a shared
+   allocator. Memory is allocated by bumping the offset in the top
+   chunk. Callers take a mark before their allocations and release
+   everything allocated since the mark when they are done, so the
+   allocations follow the nesting of the calls, also when a thread
+   runs other tasks while it waits in thread_pool_join.
+
+   When the top chunk is too small, a new chunk is pushed that is
+   at least twice as large. One released chunk of at most
+   THREAD_SCRATCH_SPARE_MAX bytes is kept for reuse. Everything is
+   freed when the thread exits.
+
+   All allocations are rounded up to a multiple of 64 bytes and
+   aligned on 64 bytes.
+
+*/
+#define THREAD_SCRATCH_ALIGN ((size_t) 64)
+#define THREAD_SCRATCH_CHUNK_MIN ((size_t) 65536)
+#define THREAD_SCRATCH_SPARE_MAX ((size_t) 16777216)
+
+typedef struct __thread_scratch_chunk_struct_t {
+  struct __thread_scratch_chunk_struct_t *prev;
+  void                                   *mem;
+  unsigned char                          *data;
+  size_t                                 size;
+  size_t                                 used;
+} __thread_scratch_chunk_t;
+
+typedef struct {
+  __thread_scratch_chunk_t *top;
+  __thread_scratch_chunk_t *spare;
+  int                      registered;
+} __thread_scratch_t;
+
+static __thread __thread_scratch_t __thread_scratch = { NULL, NULL, 0 };
+static pthread_key_t __thread_scratch_key;
+static pthread_once_t __thread_scratch_once = PTHREAD_ONCE_INIT;
+
+static inline void __thread_scratch_free_chunk(__thread_scratch_chunk_t *chunk) {
+  __free_mem(chunk->mem);
+  __free_mem(chunk);
+}
+
+/* Frees the scratch memory of an exiting thread */
+static void __thread_scratch_destructor(void *arg) {
+  __thread_scratch_t *scratch = (__thread_scratch_t *) arg;
+  __thread_scratch_chunk_t *prev;
+
+  while (scratch->top != NULL) {
+    prev = scratch->top->prev;
+    __thread_scratch_free_chunk(scratch->top);
+    scratch->top = prev;
+  }
+  if (scratch->spare != NULL) {
+    __thread_scratch_free_chunk(scratch->spare);
+    scratch->spare = NULL;
+  }
+}
+
+static void __thread_scratch_init(void) {
+  pthread_key_create(&__thread_scratch_key, __thread_scratch_destructor);
+}
+
+/* Returns a mark for the current state of the thread's scratch memory */
+thread_scratch_mark_t thread_scratch_mark(void) {
+  thread_scratch_mark_t mark;
+
+  mark.chunk = __thread_scratch.top;
+  mark.used = (__thread_scratch.top != NULL) ? __thread_scratch.top->used : ((size_t) 0);
+
+  return mark;
+}
+
+/* Allocates scratch memory for nmemb elements of size bytes each.
+
+   The memory is not initialized. It stays valid until the thread
+   releases a mark taken before this allocation.
+
+*/
+void *thread_scratch_alloc(size_t nmemb, size_t size) {
+  __thread_scratch_t *scratch = &__thread_scratch;
+  __thread_scratch_chunk_t *chunk;
+  size_t bytes, chunk_size;
+  void *ptr;
+
+  if ((size != ((size_t) 0)) && (nmemb > ((~((size_t) 0)) - THREAD_SCRATCH_ALIGN) / size)) {
+    fprintf(stderr, "Cannot allocate memory: %s\n", strerror(ENOMEM));
+    exit(1);
+  }
+  bytes = nmemb * size;
+  bytes = (bytes + (THREAD_SCRATCH_ALIGN - ((size_t) 1))) & ~(THREAD_SCRATCH_ALIGN - ((size_t) 1));
+
+  chunk = scratch->top;
+  if ((chunk == NULL) || ((chunk->size - chunk->used) < bytes)) {
+    if (!scratch->registered) {
+      pthread_once(&__thread_scratch_once, __thread_scratch_init);
+      pthread_setspecific(__thread_scratch_key, scratch);
+      scratch->registered = 1;
+    }
+    chunk_size = THREAD_SCRATCH_CHUNK_MIN;
+    if ((scratch->top != NULL) && (chunk_size < (scratch->top->size << 1))) {
+      chunk_size = scratch->top->size << 1;
+    }
+    if (chunk_size < bytes) chunk_size = bytes;
+    if ((scratch->spare != NULL) && (scratch->spare->size >= bytes)) {
+      chunk = scratch->spare;
+      scratch->spare = NULL;
+    } else {
+      chunk = (__thread_scratch_chunk_t *) __alloc_mem(((size_t) 1), sizeof(*chunk));
+      chunk->mem = __alloc_mem(chunk_size + THREAD_SCRATCH_ALIGN, ((size_t) 1));
+      chunk->data = (unsigned char *) chunk->mem;
+      chunk->data += (THREAD_SCRATCH_ALIGN - (((uintptr_t) chunk->mem) % THREAD_SCRATCH_ALIGN)) % THREAD_SCRATCH_ALIGN;
+      chunk->size = chunk_size;
+    }
+    chunk->used = (size_t) 0;
+    chunk->prev = scratch->top;
+    scratch->top = chunk;
+  }
+
+  ptr = &chunk->data[chunk->used];
+  chunk->used += bytes;
+
+  return ptr;
+}
+
+/* Releases all scratch memory the thread has allocated since mark was
+   taken.
+*/
+void thread_scratch_release(thread_scratch_mark_t mark) {
+  __thread_scratch_t *scratch = &__thread_scratch;
+  __thread_scratch_chunk_t *chunk;
+
+  while ((scratch->top != NULL) && (scratch->top != mark.chunk)) {
+    chunk = scratch->top;
+    scratch->top = chunk->prev;
+    if ((chunk->size <= THREAD_SCRATCH_SPARE_MAX) &&
+	((scratch->spare == NULL) || (scratch->spare->size < chunk->size))) {
+      if (scratch->spare != NULL) __thread_scratch_free_chunk(scratch->spare);
+      scratch->spare = chunk;
+    } else {
+      __thread_scratch_free_chunk(chunk);
+    }
+  }
+  if (scratch->top != NULL) scratch->top->used = mark.used;
+}
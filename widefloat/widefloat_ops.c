@@ -19,7 +19,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <math.h>
+#include <pthread.h>
 #include "integer_ops.h"
+#include "thread_pool.h"
 #include "widefloat_ops.h"
 
 /* Helper functions */
@@ -266,8 +269,11 @@ void widefloat_set_from_scaled_integer(widefloat_t *op,
   /* We adapt EE so that 2^EE * t = 2^E * m */
   EE = E - ((int64_t) sigma);
 
-  /* We adapt EE to reflect a mantissa between 1 and 2 */
-  EE += ((int64_t) (op->mantissa_size << 6)) -
+  /* We adapt EE to reflect a mantissa between 1 and 2. The leading
+     one of t is at bit 64 * q - WIDEFLOAT_OVERHEAD - 1, whatever the
+     size of the mantissa of op.
+  */
+  EE += ((int64_t) (q << 6)) -
     ((int64_t) WIDEFLOAT_OVERHEAD) -
     ((int64_t) 1);
 
@@ -353,3 +359,2280 @@ void widefloat_set_from_integer(widefloat_t *op,
   widefloat_set_from_scaled_integer(op, 0, (int64_t) 0, m, n);
 }
 
+
+
+/* Arithmetic on wide floating-point numbers
+
+   A finite number op with mantissa_size n has the value
+
+   (-1)^sign * 2^exponent * M / 2^(64 * n - WIDEFLOAT_OVERHEAD - 1)
+
+   where M is the integer held in the mantissa. For non-zero numbers,
+   the leading one of M is bit 64 * n - WIDEFLOAT_OVERHEAD - 1, so
+   the top WIDEFLOAT_OVERHEAD bits of the mantissa are free. Zero has
+   an all-zero mantissa and a zero exponent.
+
+   All operations round toward zero, as widefloat_set_from_scaled_integer
+   does, and write their result into a destination that is
+   initialized with its own precision. The destination may be one of
+   the operands.
+
+*/
+
+/* Guard bits used below the mantissa when operands get aligned: the
+   greater operand is placed such that its leading one is bit
+   64 * n - 2, which leaves one bit for the carry of an addition.
+*/
+#define WIDEFLOAT_GUARD (WIDEFLOAT_OVERHEAD - ((uint64_t) 1))
+
+#define WIDEFLOAT_ACC_ADD  0
+#define WIDEFLOAT_ACC_SUB  1
+#define WIDEFLOAT_ACC_RSUB 2
+
+/* Returns 1 if op is a finite zero, 0 otherwise */
+static inline int __widefloat_is_zero(const widefloat_t *op) {
+  return ((op->fpclass == FP_CLASS_NUMBER) &&
+	  is_zero(op->mantissa, op->mantissa_size));
+}
+
+/* Sets op to NaN, to an infinity or to zero, depending on fpclass,
+   with sign s
+*/
+static inline void __widefloat_set_special(widefloat_t *op,
+					   widefloatclass_t fpclass,
+					   int s) {
+  if ((fpclass == FPCLASS_POS_INF) || (fpclass == FPCLASS_NEG_INF)) {
+    fpclass = (s ? FPCLASS_NEG_INF : FPCLASS_POS_INF);
+  }
+  op->fpclass = fpclass;
+  op->sign = !!s;
+  op->exponent = (int32_t) 0;
+  __m_memset(op->mantissa, 0, op->mantissa_size, sizeof(*(op->mantissa)));
+}
+
+/* Sets r to (-1)^s * |a|, rounded toward zero to the precision of r */
+static void __widefloat_copy(widefloat_t *r, const widefloat_t *a, int s) {
+  if (r->mantissa != a->mantissa) {
+    if (r->mantissa_size <= a->mantissa_size) {
+      __m_memcpy(r->mantissa, &(a->mantissa[a->mantissa_size - r->mantissa_size]),
+		 r->mantissa_size, sizeof(*(r->mantissa)));
+    } else {
+      __m_memset(r->mantissa, 0, r->mantissa_size - a->mantissa_size,
+		 sizeof(*(r->mantissa)));
+      __m_memcpy(&(r->mantissa[r->mantissa_size - a->mantissa_size]), a->mantissa,
+		 a->mantissa_size, sizeof(*(r->mantissa)));
+    }
+  }
+  r->fpclass = a->fpclass;
+  r->sign = !!s;
+  r->exponent = a->exponent;
+  if ((r->fpclass == FPCLASS_POS_INF) || (r->fpclass == FPCLASS_NEG_INF)) {
+    r->fpclass = (s ? FPCLASS_NEG_INF : FPCLASS_POS_INF);
+  }
+}
+
+/* Sets the class, sign and exponent of op, whose mantissa is
+   normalized and not zero, for the exponent E and the sign s. If E is
+   too great, sets op to infinity. If it is too small, sets op to
+   zero.
+*/
+static void __widefloat_set_exponent(widefloat_t *op, int s, int64_t E) {
+  if (E > ((int64_t) ((((uint64_t) 1) << 31) - ((uint64_t) 1)))) {
+    __widefloat_set_special(op, FPCLASS_POS_INF, s);
+    return;
+  }
+  if (E < ((-((int64_t) ((((uint64_t) 1) << 31) - ((uint64_t) 1)))) - ((int64_t) 1))) {
+    __widefloat_set_special(op, FP_CLASS_NUMBER, s);
+    return;
+  }
+  op->fpclass = FP_CLASS_NUMBER;
+  op->sign = !!s;
+  op->exponent = (int32_t) E;
+}
+
+/* Normalizes the mantissa of op, which holds an arbitrary integer M,
+   and sets op to
+
+   (-1)^s * 2^E * M / 2^(64 * n - WIDEFLOAT_OVERHEAD - 1)
+
+   rounded toward zero, where n is the size of the mantissa. If the
+   final exponent is too great, sets op to infinity. If it is too
+   small, sets op to zero.
+
+*/
+static void __widefloat_normalize(widefloat_t *op, int s, int64_t E) {
+  uint64_t lzc;
+  size_t n = op->mantissa_size;
+
+  lzc = leading_zeros(op->mantissa, n);
+  if (lzc >= (((uint64_t) n) << 6)) {
+    __widefloat_set_special(op, FP_CLASS_NUMBER, s);
+    return;
+  }
+  if (lzc < WIDEFLOAT_OVERHEAD) {
+    rshift(op->mantissa, op->mantissa, n, (unsigned int) (WIDEFLOAT_OVERHEAD - lzc));
+  } else {
+    shift_left(op->mantissa, n, (size_t) (lzc - WIDEFLOAT_OVERHEAD));
+  }
+  E += ((int64_t) WIDEFLOAT_OVERHEAD) - ((int64_t) lzc);
+  __widefloat_set_exponent(op, s, E);
+}
+
+/* Returns digit j of y * 2^k, where y has n digits and 0 <= k <= 63 */
+static inline uint64_t __widefloat_shifted_digit(const uint64_t *y, size_t n,
+						 int64_t j, unsigned int k) {
+  uint64_t hi, lo;
+
+  hi = ((j >= ((int64_t) 0)) && (j < ((int64_t) n))) ? y[j] : ((uint64_t) 0);
+  if (k == 0u) return hi;
+  lo = ((j >= ((int64_t) 1)) && (j <= ((int64_t) n))) ? y[j - ((int64_t) 1)] : ((uint64_t) 0);
+  return (hi << k) | (lo >> (64u - k));
+}
+
+/* Accumulates y' = floor(y * 2^s) into r, which has n digits:
+
+   op = WIDEFLOAT_ACC_ADD:   r = r + y'
+   op = WIDEFLOAT_ACC_SUB:   r = r - y'
+   op = WIDEFLOAT_ACC_RSUB:  r = y' - r
+
+   all modulo 2^(64 * n). y has m digits and is not zero. The shift s
+   may be negative.
+
+   The digits of r that overlap y' go through addlsh or sublsh, which
+   shift y on the fly, so y' is never built. When y' starts inside a
+   digit of y, the bits of the lower neighbour that move into the
+   bottom digit of r are brought in first, as a single digit. The
+   carry or borrow out of the overlap then runs through the digits of
+   r above it. The reverse subtraction is a subtraction followed by a
+   negation. If y' lies entirely below r, nothing is added at all.
+
+   Returns a non-zero value if y' is not exact, i.e. if bits of y got
+   shifted out at the bottom.
+
+*/
+static uint64_t __widefloat_accumulate(uint64_t *r, size_t n,
+				       const uint64_t *y, size_t m,
+				       int64_t s, int op) {
+  int64_t L, j;
+  unsigned int k;
+  uint64_t sticky, u, c, zero;
+  size_t i, i0, j0, l;
+
+  /* s = 64 * L + k with 0 <= k <= 63 */
+  if (s >= ((int64_t) 0)) {
+    L = s / ((int64_t) 64);
+  } else {
+    L = -((-s + ((int64_t) 63)) / ((int64_t) 64));
+  }
+  k = (unsigned int) (s - ((int64_t) 64) * L);
+
+  /* The digits of y below -L - 1 are shifted out completely, digit
+     -L - 1 keeps only its k highest bits, which become the lowest
+     bits u of y'.
+  */
+  sticky = (uint64_t) 0;
+  u = (uint64_t) 0;
+  if (L < ((int64_t) 0)) {
+    j = -L - ((int64_t) 1);
+    if (j >= ((int64_t) m)) return (uint64_t) 1;
+    sticky = ((k == 0u) ? y[j] : (y[j] << k));
+    if (k != 0u) u = y[j] >> (64u - k);
+    for (i=(size_t) j;(i>((size_t) 0)) && (sticky == ((uint64_t) 0));i--) {
+      sticky = y[i - ((size_t) 1)];
+    }
+  }
+
+  /* Digit i0 + i of y' is digit j0 + i of y shifted by k bits, plus
+     u for i = 0. The overlap with r has l digits.
+  */
+  i0 = (L > ((int64_t) 0)) ? ((size_t) L) : ((size_t) 0);
+  j0 = (L < ((int64_t) 0)) ? ((size_t) -L) : ((size_t) 0);
+  if (i0 > n) i0 = n;
+  l = n - i0;
+  if (l > m - j0) l = m - j0;
+
+  if (op == WIDEFLOAT_ACC_ADD) {
+    if (u != ((uint64_t) 0)) addition(r, r, n, &u, (size_t) 1);
+    c = addlsh(&r[i0], &r[i0], &y[j0], l, k);
+    if ((l == m - j0) && (i0 + l < n) && (c != ((uint64_t) 0))) {
+      addition(&r[i0 + l], &r[i0 + l], n - i0 - l, &c, (size_t) 1);
+    }
+  } else {
+    if (u != ((uint64_t) 0)) subtraction(r, r, n, &u, (size_t) 1);
+    c = sublsh(&r[i0], &r[i0], &y[j0], l, k);
+    if ((l == m - j0) && (i0 + l < n) && (c != ((uint64_t) 0))) {
+      subtraction(&r[i0 + l], &r[i0 + l], n - i0 - l, &c, (size_t) 1);
+    }
+    if (op == WIDEFLOAT_ACC_RSUB) {
+      zero = (uint64_t) 0;
+      subtraction(r, &zero, (size_t) 1, r, n);
+    }
+  }
+
+  return sticky;
+}
+
+/* r = floor(r * 2^s) in place, where r has n digits and s is at most
+   WIDEFLOAT_GUARD, so that nothing gets shifted out at the top.
+
+   Returns a non-zero value if bits got shifted out at the bottom.
+
+*/
+static uint64_t __widefloat_align(uint64_t *r, size_t n, int64_t s) {
+  uint64_t sticky;
+  size_t L, i;
+  unsigned int k;
+
+  if (s >= ((int64_t) 0)) {
+    lshift(r, r, n, (unsigned int) s);
+    return (uint64_t) 0;
+  }
+  if (((uint64_t) -s) >= (((uint64_t) n) << 6)) {
+    sticky = !is_zero(r, n);
+    __m_memset(r, 0, n, sizeof(*r));
+    return sticky;
+  }
+  L = (size_t) (((uint64_t) -s) >> 6);
+  k = (unsigned int) (((uint64_t) -s) & ((uint64_t) 63));
+  sticky = ((k == 0u) ? ((uint64_t) 0) : (r[L] << (64u - k)));
+  for (i=0;i<L;i++) {
+    sticky |= r[i];
+  }
+  rshift(r, &r[L], n - L, k);
+  __m_memset(&r[n - L], 0, L, sizeof(*r));
+  return sticky;
+}
+
+/* r = a + (-1)^sb * |b|, where sb replaces the sign of b */
+static void __widefloat_add_signed(widefloat_t *r,
+				   const widefloat_t *a,
+				   const widefloat_t *b,
+				   int sb) {
+  const widefloat_t *x;
+  const widefloat_t *y;
+  uint64_t sticky;
+  int64_t d, sx_shift, sy_shift;
+  int sa, sx, sy, sub;
+  size_t n;
+  uint64_t zero, one;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  sa = !!(a->sign);
+  sb = !!sb;
+  if ((a->fpclass == FPCLASS_NAN) || (b->fpclass == FPCLASS_NAN)) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if ((a->fpclass != FP_CLASS_NUMBER) && (b->fpclass != FP_CLASS_NUMBER)) {
+    if (sa != sb) {
+      __widefloat_set_special(r, FPCLASS_NAN, 0);
+    } else {
+      __widefloat_set_special(r, FPCLASS_POS_INF, sa);
+    }
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, sa);
+    return;
+  }
+  if (b->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, sb);
+    return;
+  }
+  if (__widefloat_is_zero(b)) {
+    if (__widefloat_is_zero(a)) {
+      __widefloat_set_special(r, FP_CLASS_NUMBER, sa && sb);
+    } else {
+      __widefloat_copy(r, a, sa);
+    }
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_copy(r, b, sb);
+    return;
+  }
+
+  /* Both operands share their mantissa: the result is 2 * a or zero */
+  if (a->mantissa == b->mantissa) {
+    if (sa != sb) {
+      __widefloat_set_special(r, FP_CLASS_NUMBER, 0);
+      return;
+    }
+    __widefloat_copy(r, a, sa);
+    if (r->exponent == ((int32_t) ((((uint64_t) 1) << 31) - ((uint64_t) 1)))) {
+      __widefloat_set_special(r, FPCLASS_POS_INF, sa);
+    } else {
+      r->exponent++;
+    }
+    return;
+  }
+
+  /* x is the operand with the greater exponent */
+  if (a->exponent >= b->exponent) {
+    x = a;
+    sx = sa;
+    y = b;
+    sy = sb;
+  } else {
+    x = b;
+    sx = sb;
+    y = a;
+    sy = sa;
+  }
+  d = ((int64_t) x->exponent) - ((int64_t) y->exponent);
+  n = r->mantissa_size;
+  sub = (sx != sy);
+
+  /* In units of 2^(x->exponent - 64 * n + 2), x gets its leading one
+     at bit 64 * n - 2 and y lies d bits lower.
+  */
+  sx_shift = ((int64_t) WIDEFLOAT_GUARD) +
+    ((int64_t) 64) * (((int64_t) n) - ((int64_t) x->mantissa_size));
+  sy_shift = ((int64_t) WIDEFLOAT_GUARD) +
+    ((int64_t) 64) * (((int64_t) n) - ((int64_t) y->mantissa_size)) - d;
+
+  if (r->mantissa == y->mantissa) {
+    /* Align y in place, then bring in x */
+    sticky = __widefloat_align(r->mantissa, n, sy_shift);
+    __widefloat_accumulate(r->mantissa, n, x->mantissa, x->mantissa_size, sx_shift,
+			   (sub ? WIDEFLOAT_ACC_RSUB : WIDEFLOAT_ACC_ADD));
+  } else {
+    /* Place x, then bring in y */
+    if (r->mantissa == x->mantissa) {
+      lshift(r->mantissa, r->mantissa, n, (unsigned int) WIDEFLOAT_GUARD);
+    } else {
+      __m_memset(r->mantissa, 0, n, sizeof(*(r->mantissa)));
+      __widefloat_accumulate(r->mantissa, n, x->mantissa, x->mantissa_size, sx_shift,
+			     WIDEFLOAT_ACC_ADD);
+    }
+    sticky = __widefloat_accumulate(r->mantissa, n, y->mantissa, y->mantissa_size, sy_shift,
+				    (sub ? WIDEFLOAT_ACC_SUB : WIDEFLOAT_ACC_ADD));
+  }
+
+  if (sub) {
+    if ((r->mantissa[n - ((size_t) 1)] >> 63) != ((uint64_t) 0)) {
+      /* |y| was greater than |x|: negate */
+      zero = (uint64_t) 0;
+      subtraction(r->mantissa, &zero, (size_t) 1, r->mantissa, n);
+      sx = !sx;
+    } else if (sticky != ((uint64_t) 0)) {
+      /* The exact difference is slightly less than the one computed
+	 with the truncated y': rounding toward zero takes one unit off.
+      */
+      one = (uint64_t) 1;
+      subtraction(r->mantissa, r->mantissa, n, &one, (size_t) 1);
+    } else if (is_zero(r->mantissa, n)) {
+      /* Exact cancellation gives +0 */
+      sx = 0;
+    }
+  }
+
+  __widefloat_normalize(r, sx, ((int64_t) x->exponent) - ((int64_t) WIDEFLOAT_GUARD));
+}
+
+/* Addition
+
+   Sets r to a + b, rounded toward zero to the precision of r.
+
+   The operands are aligned on the mantissa of r: the operand with the
+   greater exponent is copied in, and the other one is added, shifted
+   by the difference of the exponents, over the digits where both
+   overlap. An operand that lies entirely below the precision of r is
+   never shifted nor added. No temporary memory is used, and r may be
+   a or b.
+
+   The result is exact, up to the final rounding, when a and b have
+   at most the precision of r. Otherwise, they are truncated to it
+   first.
+
+   Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_add(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  __widefloat_add_signed(r, a, b, b->sign);
+}
+
+/* Subtraction
+
+   Sets r to a - b, rounded toward zero to the precision of r.
+
+   See widefloat_add.
+
+*/
+void widefloat_sub(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  __widefloat_add_signed(r, a, b, !(b->sign));
+}
+
+/* Short products
+
+   The product of two mantissas of n digits has 2 * n digits, but
+   only its n + 1 most significant ones are needed for a result of n
+   digits. __widefloat_short_product computes them without the low
+   half, following Mulders: with a = a1 * 2^(64 * l) + a0 and
+   b = b1 * 2^(64 * l) + b0, where a0 and b0 have l digits,
+
+   +  a1 * b1 is computed in full, by multiplication,
+   +  the high parts of a1 * b0 and a0 * b1 are short products of l
+      digits,
+   +  a0 * b0 is dropped.
+
+   multiplication pads its operands to a power of two, so a1 and b1
+   get the least power of two of digits that is more than n / 2. This
+   leaves l between 0 and n / 2. The short product then costs about
+   half of the full product of n digits, and never more than it.
+
+   The dropped digit products a[i] * b[j] all have i + j <= n - 2.
+   They make the result a little too small, by O(n) units of its
+   second least significant digit. Callers that need the top n digits
+   to within a few units of the last place pass operands with one
+   more digit.
+
+*/
+#define WIDEFLOAT_SHORT_PRODUCT_THRESHOLD ((size_t) 16)
+
+/* r = r + a * b, where r and a have n digits. Returns the carry. */
+static inline uint64_t __widefloat_addmul_1(uint64_t *r, const uint64_t *a, size_t n,
+					    uint64_t b) {
+  unsigned __int128 t;
+  uint64_t c;
+  size_t i;
+
+  c = (uint64_t) 0;
+  for (i=0;i<n;i++) {
+    t = ((unsigned __int128) a[i]) * ((unsigned __int128) b) +
+      ((unsigned __int128) r[i]) + ((unsigned __int128) c);
+    r[i] = (uint64_t) t;
+    c = (uint64_t) (t >> 64);
+  }
+  return c;
+}
+
+/* Sets h, which has n + 1 digits, to about floor(a * b / 2^(64 * (n - 1))),
+   where a and b have n digits
+*/
+static void __widefloat_short_product(uint64_t *h, const uint64_t *a, const uint64_t *b,
+				      size_t n) {
+  thread_scratch_mark_t mark;
+  uint64_t *g;
+  uint64_t *t;
+  size_t w, i, j0, l, k;
+
+  if (n <= WIDEFLOAT_SHORT_PRODUCT_THRESHOLD) {
+    /* Schoolbook on the digit products a[i] * b[j] with i + j >= w,
+       where w leaves one guard digit below the result.
+    */
+    w = (n >= ((size_t) 2)) ? (n - ((size_t) 2)) : ((size_t) 0);
+    mark = thread_scratch_mark();
+    g = thread_scratch_alloc(((size_t) 2) * n - w, sizeof(*g));
+    memset(g, 0, (((size_t) 2) * n - w) * sizeof(*g));
+    for (i=0;i<n;i++) {
+      j0 = (w > i) ? (w - i) : ((size_t) 0);
+      g[i + n - w] = __widefloat_addmul_1(&g[i + j0 - w], &b[j0], n - j0, a[i]);
+    }
+    memcpy(h, &g[n - ((size_t) 1) - w], (n + ((size_t) 1)) * sizeof(*h));
+    thread_scratch_release(mark);
+    return;
+  }
+
+  for (k=(size_t) 1;(k << 1)<=n;k<<=1);
+  l = n - k;
+  mark = thread_scratch_mark();
+
+  /* High part of a1 * b1 */
+  t = thread_scratch_alloc(((size_t) 2) * k, sizeof(*t));
+  multiplication(t, &a[l], k, &b[l], k);
+  memcpy(h, &t[n - ((size_t) 1) - ((size_t) 2) * l], (n + ((size_t) 1)) * sizeof(*h));
+
+  /* High parts of a1 * b0 and a0 * b1, where only the top l digits
+     of a1 and b1 matter
+  */
+  if (l > ((size_t) 0)) {
+    t = thread_scratch_alloc(l + ((size_t) 1), sizeof(*t));
+    __widefloat_short_product(t, &a[n - l], b, l);
+    addition(h, h, n + ((size_t) 1), t, l + ((size_t) 1));
+    __widefloat_short_product(t, &b[n - l], a, l);
+    addition(h, h, n + ((size_t) 1), t, l + ((size_t) 1));
+  }
+
+  thread_scratch_release(mark);
+}
+
+/* Returns a pointer to the mantissa of a, brought to n digits: its
+   top n digits if it is longer, or a copy padded with zeros below,
+   allocated on the scratch stack, if it is shorter.
+*/
+static const uint64_t *__widefloat_mantissa_at(const widefloat_t *a, size_t n) {
+  uint64_t *t;
+
+  if (a->mantissa_size >= n) return &(a->mantissa[a->mantissa_size - n]);
+  t = thread_scratch_alloc(n, sizeof(*t));
+  memset(t, 0, (n - a->mantissa_size) * sizeof(*t));
+  memcpy(&t[n - a->mantissa_size], a->mantissa, a->mantissa_size * sizeof(*t));
+  return t;
+}
+
+/* Multiplication
+
+   Sets r to a * b, rounded toward zero to the precision of r, up to
+   one unit in the last place: the mantissas are brought to the
+   precision of r, plus one guard digit, and only the top digits of
+   their product are computed, as a short product. The result may thus be one unit in
+   the last place below a * b rounded toward zero, never above.
+
+   The product of two mantissas between 1 and 2 is between 1 and 4,
+   so renormalization is a fixed shift plus at most one bit.
+
+   r may be a or b. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_mul(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  thread_scratch_mark_t mark;
+  const uint64_t *ma;
+  const uint64_t *mb;
+  uint64_t *h;
+  unsigned int sh;
+  int s;
+  size_t n;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  s = (!!(a->sign)) ^ (!!(b->sign));
+  if ((a->fpclass == FPCLASS_NAN) || (b->fpclass == FPCLASS_NAN)) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if ((a->fpclass != FP_CLASS_NUMBER) || (b->fpclass != FP_CLASS_NUMBER)) {
+    if (__widefloat_is_zero(a) || __widefloat_is_zero(b)) {
+      __widefloat_set_special(r, FPCLASS_NAN, 0);
+    } else {
+      __widefloat_set_special(r, FPCLASS_POS_INF, s);
+    }
+    return;
+  }
+  if (__widefloat_is_zero(a) || __widefloat_is_zero(b)) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, s);
+    return;
+  }
+
+  /* High part of the product of the mantissas, extended by one zero
+     digit to absorb the error of the short product. Its n + 1 top
+     digits are at h + 1, with the leading one at bit 64 * n + 40 or
+     64 * n + 41.
+  */
+  n = r->mantissa_size;
+  mark = thread_scratch_mark();
+  ma = __widefloat_mantissa_at(a, n + ((size_t) 1));
+  mb = __widefloat_mantissa_at(b, n + ((size_t) 1));
+  h = thread_scratch_alloc(n + ((size_t) 2), sizeof(*h));
+  __widefloat_short_product(h, ma, mb, n + ((size_t) 1));
+  h++;
+
+  /* Bring the leading one to bit 64 * n - WIDEFLOAT_OVERHEAD - 1,
+     i.e. bit sh = 63 - WIDEFLOAT_OVERHEAD of the top digit. In h, it
+     is bit 2 * sh - 64 or 2 * sh - 63 of the top digit.
+  */
+  sh = (unsigned int) (((uint64_t) 63) - WIDEFLOAT_OVERHEAD);
+  if ((h[n] >> (((unsigned int) 2) * sh - 63u)) != ((uint64_t) 0)) sh++;
+  rshift(h, h, n + ((size_t) 1), sh);
+  memcpy(r->mantissa, h, n * sizeof(*h));
+  thread_scratch_release(mark);
+
+  __widefloat_set_exponent(r, s,
+			   ((int64_t) a->exponent) + ((int64_t) b->exponent) +
+			   ((int64_t) sh) - ((int64_t) (((uint64_t) 63) - WIDEFLOAT_OVERHEAD)));
+}
+
+/* Division
+
+   Up to WIDEFLOAT_NEWTON_THRESHOLD digits, quotients come from the
+   integer division of the mantissas and are exactly rounded toward
+   zero.
+
+   Above, the reciprocal 1 / b is computed by Newton-Raphson,
+
+   x' = x + x * (1 - b * x),
+
+   which doubles the number of correct bits with every step. The steps
+   run at increasing precision: each one only needs a little more than
+   half the bits of the next one, so all steps together cost about as
+   much as the last one. That is one short product at full precision
+   for b * x and one at half precision for x * (1 - b * x), which only
+   needs as many bits as 1 - b * x is small, so the whole reciprocal
+   costs two to three multiplications. The first approximation comes
+   from the top digit of b in double precision.
+
+   The operands are scaled to exponent 0 and positive sign first, so
+   that nothing overflows before the end.
+
+*/
+#define WIDEFLOAT_NEWTON_THRESHOLD ((size_t) 32)
+
+/* Correct bits of the double precision seed, and extra bits carried
+   by each Newton step
+*/
+#define WIDEFLOAT_SEED_BITS         ((uint64_t) 48)
+#define WIDEFLOAT_NEWTON_GUARD_BITS ((uint64_t) 8)
+
+/* Returns the number of digits for a mantissa of p bits of precision */
+static inline size_t __widefloat_size_for_bits(uint64_t p) {
+  return (size_t) ((p + WIDEFLOAT_OVERHEAD + ((uint64_t) 63)) >> 6);
+}
+
+/* Sets op to zero, with a mantissa of n digits on the scratch stack */
+static void __widefloat_scratch_init(widefloat_t *op, size_t n) {
+  op->fpclass = FP_CLASS_NUMBER;
+  op->sign = 0;
+  op->exponent = (int32_t) 0;
+  op->mantissa_size = n;
+  op->mantissa = thread_scratch_alloc(n, sizeof(*(op->mantissa)));
+  memset(op->mantissa, 0, n * sizeof(*(op->mantissa)));
+}
+
+/* Sets op to 2^E, on a mantissa of n digits on the scratch stack */
+static void __widefloat_scratch_power_of_two(widefloat_t *op, size_t n, int32_t E) {
+  __widefloat_scratch_init(op, n);
+  op->mantissa[n - ((size_t) 1)] = ((uint64_t) 1) << (((uint64_t) 63) - WIDEFLOAT_OVERHEAD);
+  op->exponent = E;
+}
+
+/* Sets the mantissa of r to the n digits of floor(A * 2^(64 * n - WIDEFLOAT_OVERHEAD) / B),
+   where A and B have n digits, and normalizes it for the sign s and
+   the exponent E - 1.
+*/
+static void __widefloat_div_basecase(widefloat_t *r, const uint64_t *A, const uint64_t *B,
+				     int s, int64_t E) {
+  thread_scratch_mark_t mark;
+  uint64_t *u;
+  uint64_t *q;
+  size_t n = r->mantissa_size;
+
+  mark = thread_scratch_mark();
+  u = thread_scratch_alloc(((size_t) 2) * n, sizeof(*u));
+  q = thread_scratch_alloc(((size_t) 2) * n, sizeof(*q));
+  memcpy(u, A, n * sizeof(*u));
+  memset(&u[n], 0, n * sizeof(*u));
+  shift_left(u, ((size_t) 2) * n, (size_t) ((((uint64_t) n) << 6) - WIDEFLOAT_OVERHEAD));
+  division(q, NULL, u, ((size_t) 2) * n, B, n);
+  memcpy(r->mantissa, q, n * sizeof(*q));
+  thread_scratch_release(mark);
+  __widefloat_normalize(r, s, E - ((int64_t) 1));
+}
+
+/* Returns the top digit of the mantissa of b, a finite non-zero
+   number with exponent 0 or 1, as a double
+*/
+static inline double __widefloat_top_double(const widefloat_t *b) {
+  return ldexp((double) b->mantissa[b->mantissa_size - ((size_t) 1)],
+	       ((int) b->exponent) - ((int) (((uint64_t) 63) - WIDEFLOAT_OVERHEAD)));
+}
+
+/* Sets x to the positive double v, truncated to one digit */
+static void __widefloat_seed(widefloat_t *x, double v) {
+  double f;
+  int e;
+
+  f = frexp(v, &e);
+  __m_memset(x->mantissa, 0, x->mantissa_size, sizeof(*(x->mantissa)));
+  x->mantissa[x->mantissa_size - ((size_t) 1)] =
+    (uint64_t) ldexp(f, (int) (((uint64_t) 64) - WIDEFLOAT_OVERHEAD));
+  x->fpclass = FP_CLASS_NUMBER;
+  x->sign = 0;
+  x->exponent = (int32_t) (e - 1);
+}
+
+/* Sets x to an approximation of 1 / b, where 1 <= b < 2, with about
+   WIDEFLOAT_SEED_BITS correct bits
+*/
+static void __widefloat_inv_seed(widefloat_t *x, const widefloat_t *b) {
+  __widefloat_seed(x, 1.0 / __widefloat_top_double(b));
+}
+
+/* Sets x to 1 / b with a relative error below 2^-p, where 1 <= b < 2
+   and x has at least __widefloat_size_for_bits(p) digits
+*/
+static void __widefloat_inv_newton(widefloat_t *x, const widefloat_t *b, uint64_t p) {
+  thread_scratch_mark_t mark;
+  widefloat_t y, t, u, one;
+  uint64_t q;
+
+  if (p <= WIDEFLOAT_SEED_BITS) {
+    __widefloat_inv_seed(x, b);
+    return;
+  }
+
+  /* y = 1 / b with a little more than half the precision */
+  q = ((p + ((uint64_t) 1)) >> 1) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(q));
+  __widefloat_inv_newton(&y, b, q);
+
+  /* x = y + y * (1 - b * y), where 1 - b * y is about 2^-q, so
+     that y * (1 - b * y) only needs p - q bits
+  */
+  __widefloat_scratch_init(&t, __widefloat_size_for_bits(p + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_init(&u, __widefloat_size_for_bits(p - q + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_power_of_two(&one, (size_t) 1, (int32_t) 0);
+  widefloat_mul(&t, b, &y);
+  widefloat_sub(&t, &one, &t);
+  widefloat_mul(&u, &y, &t);
+  widefloat_add(x, &y, &u);
+  thread_scratch_release(mark);
+}
+
+/* Reciprocal
+
+   Sets r to 1 / a, to the precision of r.
+
+   Up to WIDEFLOAT_NEWTON_THRESHOLD digits, the result is rounded
+   toward zero. Above, it is within a few units in the last place.
+
+   r may be a. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_inv(widefloat_t *r, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t aa, x;
+  widefloat_t one;
+  int s;
+  int64_t E;
+  size_t n;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  s = !!(a->sign);
+  if (a->fpclass == FPCLASS_NAN) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, s);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, s);
+    return;
+  }
+
+  /* 1 / a = 2^-E / |a'|, where a' has exponent 0 */
+  n = r->mantissa_size;
+  E = -((int64_t) a->exponent);
+  aa = *a;
+  aa.sign = 0;
+  aa.exponent = (int32_t) 0;
+  mark = thread_scratch_mark();
+  if (n <= WIDEFLOAT_NEWTON_THRESHOLD) {
+    __widefloat_scratch_power_of_two(&one, n, (int32_t) 0);
+    __widefloat_div_basecase(r, one.mantissa, __widefloat_mantissa_at(&aa, n), s, E);
+  } else {
+    __widefloat_scratch_init(&x, __widefloat_size_for_bits((((uint64_t) n) << 6) +
+							  WIDEFLOAT_NEWTON_GUARD_BITS));
+    __widefloat_inv_newton(&x, &aa, (((uint64_t) n) << 6) + WIDEFLOAT_NEWTON_GUARD_BITS);
+    __widefloat_copy(r, &x, s);
+    __widefloat_set_exponent(r, s, ((int64_t) r->exponent) + E);
+  }
+  thread_scratch_release(mark);
+}
+
+/* Division
+
+   Sets r to a / b, to the precision of r.
+
+   Up to WIDEFLOAT_NEWTON_THRESHOLD digits, the result is rounded
+   toward zero. Above, it is a times the reciprocal of b, computed
+   with a few guard bits, and is within a few units in the last
+   place.
+
+   r may be a or b. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_div(widefloat_t *r, const widefloat_t *a, const widefloat_t *b) {
+  thread_scratch_mark_t mark;
+  widefloat_t aa, bb, x;
+  int s;
+  int64_t E;
+  size_t n;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  s = (!!(a->sign)) ^ (!!(b->sign));
+  if ((a->fpclass == FPCLASS_NAN) || (b->fpclass == FPCLASS_NAN)) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    if (b->fpclass != FP_CLASS_NUMBER) {
+      __widefloat_set_special(r, FPCLASS_NAN, 0);
+    } else {
+      __widefloat_set_special(r, FPCLASS_POS_INF, s);
+    }
+    return;
+  }
+  if (b->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, s);
+    return;
+  }
+  if (__widefloat_is_zero(b)) {
+    if (__widefloat_is_zero(a)) {
+      __widefloat_set_special(r, FPCLASS_NAN, 0);
+    } else {
+      __widefloat_set_special(r, FPCLASS_POS_INF, s);
+    }
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, s);
+    return;
+  }
+
+  /* a / b = 2^E * |a'| / |b'|, where a' and b' have exponent 0 */
+  n = r->mantissa_size;
+  E = ((int64_t) a->exponent) - ((int64_t) b->exponent);
+  aa = *a;
+  aa.sign = 0;
+  aa.exponent = (int32_t) 0;
+  bb = *b;
+  bb.sign = 0;
+  bb.exponent = (int32_t) 0;
+  mark = thread_scratch_mark();
+  if (n <= WIDEFLOAT_NEWTON_THRESHOLD) {
+    __widefloat_div_basecase(r, __widefloat_mantissa_at(&aa, n),
+			     __widefloat_mantissa_at(&bb, n), s, E);
+  } else {
+    __widefloat_scratch_init(&x, __widefloat_size_for_bits((((uint64_t) n) << 6) +
+							  WIDEFLOAT_NEWTON_GUARD_BITS));
+    __widefloat_inv_newton(&x, &bb, (((uint64_t) n) << 6) + WIDEFLOAT_NEWTON_GUARD_BITS);
+    widefloat_mul(r, &aa, &x);
+    __widefloat_set_exponent(r, s, ((int64_t) r->exponent) + E);
+  }
+  thread_scratch_release(mark);
+}
+
+/* Square root
+
+   Both the square root and its reciprocal start with 1 / sqrt(a),
+   computed by Newton-Raphson without any division,
+
+   x' = x + x * (1 - a * x^2) / 2,
+
+   with precision doubling as for the reciprocal. x has half the bits
+   of x', so x^2 is computed exactly by multiplication on half the
+   digits, and a * x^2 is one short product at full precision.
+
+   The square root then takes the reciprocal root at half the
+   precision only and finishes with one step that has the same
+   structure (Karp and Markstein): with y = a * x,
+
+   sqrt(a) = y + x * (a - y^2) / 2.
+
+   a is scaled to 2^e * m with e = 0 or 1 and 1 <= m < 2 first, so
+   that the exponent of the result is just halved.
+
+*/
+
+/* Multiplies the finite number op by 2^k */
+static inline void __widefloat_scale(widefloat_t *op, int64_t k) {
+  if ((op->fpclass != FP_CLASS_NUMBER) || __widefloat_is_zero(op)) return;
+  __widefloat_set_exponent(op, op->sign, ((int64_t) op->exponent) + k);
+}
+
+/* Sets t, on the scratch stack, to y^2 exactly */
+static void __widefloat_scratch_square(widefloat_t *t, const widefloat_t *y) {
+  __widefloat_scratch_init(t, ((size_t) 2) * y->mantissa_size);
+  multiplication(t->mantissa, y->mantissa, y->mantissa_size, y->mantissa, y->mantissa_size);
+  __widefloat_normalize(t, 0, ((int64_t) 2) * ((int64_t) y->exponent) +
+			((int64_t) WIDEFLOAT_OVERHEAD) + ((int64_t) 1));
+}
+
+/* Sets x to 1 / sqrt(a) with a relative error below 2^-p, where
+   1 <= a < 4 and x has at least __widefloat_size_for_bits(p) digits
+*/
+static void __widefloat_rsqrt_newton(widefloat_t *x, const widefloat_t *a, uint64_t p) {
+  thread_scratch_mark_t mark;
+  widefloat_t y, t, w, u, one;
+  uint64_t q;
+
+  if (p <= WIDEFLOAT_SEED_BITS) {
+    __widefloat_seed(x, 1.0 / sqrt(__widefloat_top_double(a)));
+    return;
+  }
+
+  /* y = 1 / sqrt(a) with a little more than half the precision */
+  q = ((p + ((uint64_t) 1)) >> 1) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(q));
+  __widefloat_rsqrt_newton(&y, a, q);
+
+  /* x = y + y * (1 - a * y^2) / 2 */
+  __widefloat_scratch_square(&t, &y);
+  __widefloat_scratch_init(&w, __widefloat_size_for_bits(p + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_init(&u, __widefloat_size_for_bits(p - q + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_power_of_two(&one, (size_t) 1, (int32_t) 0);
+  widefloat_mul(&w, a, &t);
+  widefloat_sub(&w, &one, &w);
+  widefloat_mul(&u, &y, &w);
+  __widefloat_scale(&u, (int64_t) -1);
+  widefloat_add(x, &y, &u);
+  thread_scratch_release(mark);
+}
+
+/* Sets the variable pointed to by aa to a copy of the finite, positive
+   number a that shares its mantissa, scaled to an exponent e = 0 or 1,
+   and returns (a->exponent - e) / 2
+*/
+static int64_t __widefloat_sqrt_scale(widefloat_t *aa, const widefloat_t *a) {
+  int64_t e;
+
+  e = ((int64_t) a->exponent) & ((int64_t) 1);
+  *aa = *a;
+  aa->exponent = (int32_t) e;
+  return (((int64_t) a->exponent) - e) / ((int64_t) 2);
+}
+
+/* Reciprocal square root
+
+   Sets r to 1 / sqrt(a), to within a few units in the last place of
+   the precision of r.
+
+   Sets r to NaN if a is negative, to infinity if a is zero, with the
+   sign of the zero, and to zero if a is infinity.
+
+   r may be a. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_rsqrt(widefloat_t *r, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t aa, x;
+  int64_t E;
+  uint64_t p;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  if (a->fpclass == FPCLASS_NAN) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, a->sign);
+    return;
+  }
+  if (a->sign) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, 0);
+    return;
+  }
+
+  E = __widefloat_sqrt_scale(&aa, a);
+  p = (((uint64_t) r->mantissa_size) << 6) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&x, __widefloat_size_for_bits(p));
+  __widefloat_rsqrt_newton(&x, &aa, p);
+  __widefloat_copy(r, &x, 0);
+  __widefloat_scale(r, -E);
+  thread_scratch_release(mark);
+}
+
+/* Square root
+
+   Sets r to sqrt(a), to within a few units in the last place of the
+   precision of r.
+
+   Sets r to NaN if a is negative. The square root of a zero is that
+   zero, the one of infinity is infinity.
+
+   r may be a. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_sqrt(widefloat_t *r, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t aa, x, y, t, w, u;
+  int64_t E;
+  uint64_t p, q;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  if (a->fpclass == FPCLASS_NAN) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_special(r, FP_CLASS_NUMBER, a->sign);
+    return;
+  }
+  if (a->sign) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, 0);
+    return;
+  }
+
+  /* x = 1 / sqrt(a) and y = a * x with half the precision */
+  E = __widefloat_sqrt_scale(&aa, a);
+  p = (((uint64_t) r->mantissa_size) << 6) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  q = ((p + ((uint64_t) 1)) >> 1) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&x, __widefloat_size_for_bits(q));
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(q));
+  __widefloat_rsqrt_newton(&x, &aa, q);
+  widefloat_mul(&y, &aa, &x);
+
+  /* r = y + x * (a - y^2) / 2 */
+  __widefloat_scratch_square(&t, &y);
+  __widefloat_scratch_init(&w, __widefloat_size_for_bits(p + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_init(&u, __widefloat_size_for_bits(p - q + WIDEFLOAT_NEWTON_GUARD_BITS));
+  widefloat_sub(&w, &aa, &t);
+  widefloat_mul(&u, &x, &w);
+  __widefloat_scale(&u, (int64_t) -1);
+  widefloat_add(r, &y, &u);
+  __widefloat_scale(r, E);
+  thread_scratch_release(mark);
+}
+
+/* Exponential and logarithm
+
+   The exponential first reduces its argument by ln(2),
+
+   exp(x) = 2^k * exp(r),   r = x - k * ln(2),   0 <= r < ln(2),
+
+   where ln(2) carries as many extra bits as k has. ln(2) is computed
+   once, by binary splitting, and kept in a cache that grows with the
+   precision asked for.
+
+   Up to WIDEFLOAT_EXP_SPLITTING_THRESHOLD digits, r is halved j
+   times, the Taylor series of exp(r / 2^j) is evaluated by
+   rectangular splitting (Paterson and Stockmeyer) and the sum is
+   squared j times. With the m first powers of r / 2^j precomputed, N
+   terms take about N / m + m multiplications, all other operations
+   being divisions by small integers and additions, which are linear.
+
+   Above, r is cut into chunks of bits [2^i, 2^(i+1)) after the
+   leading ones (bit-burst). The series of the exponential of each
+   chunk u / 2^k is summed exactly on integers by binary splitting,
+   where the integers reach the full precision only in the last
+   levels, and the exponentials of the chunks are multiplied together.
+
+   The logarithm inverts the exponential by Newton-Raphson,
+
+   y' = y + a * exp(-y) - 1,
+
+   with precision doubling, which costs about two exponentials.
+
+*/
+#define WIDEFLOAT_EXP_SPLITTING_THRESHOLD ((size_t) 256)
+#define WIDEFLOAT_EXP_GUARD_BITS          ((uint64_t) 24)
+#define WIDEFLOAT_BURST_FIRST_BITS        ((uint64_t) 32)
+#define WIDEFLOAT_SPLIT_PARALLEL_THRESHOLD ((uint64_t) 512)
+
+/* Double precision approximations of ln(2) and sqrt(2) */
+#define WIDEFLOAT_LN2_DOUBLE   0.6931471805599453
+#define WIDEFLOAT_SQRT2_DOUBLE 1.4142135623730951
+
+/* Integer of a binary splitting, with its digits on the heap */
+typedef struct {
+  uint64_t *digits;
+  size_t   size;
+} __widefloat_integer_t;
+
+/* Integers P, Q, B and T of a range of terms of a series
+
+   sum (1 / b(j)) * prod_{i <= j} p(i) / (q(i) * 2^s(i))
+
+   such that the sum over the range, relative to the product of the
+   terms before it, is T / (B * Q * 2^shift). Keeping the powers of
+   two apart keeps Q small for series in u / 2^k.
+*/
+typedef struct {
+  __widefloat_integer_t P;
+  __widefloat_integer_t Q;
+  __widefloat_integer_t B;
+  __widefloat_integer_t T;
+  uint64_t              shift;
+} __widefloat_split_t;
+
+/* Sets node to p(j), q(j), b(j), T = p(j) and s(j) for the term j */
+typedef void (*__widefloat_term_func_t)(__widefloat_split_t *node, uint64_t j, const void *arg);
+
+typedef struct {
+  __widefloat_split_t     *node;
+  uint64_t                a;
+  uint64_t                b;
+  int                     need_p;
+  __widefloat_term_func_t term;
+  const void              *arg;
+} __widefloat_split_args_t;
+
+/* Sets a to v on n digits */
+static void __widefloat_integer_init(__widefloat_integer_t *a, size_t n, uint64_t v) {
+  a->size = n;
+  a->digits = __alloc_mem(n, sizeof(*(a->digits)));
+  a->digits[0] = v;
+}
+
+static void __widefloat_integer_clear(__widefloat_integer_t *a) {
+  __free_mem(a->digits);
+  a->digits = NULL;
+  a->size = (size_t) 0;
+}
+
+/* Drops the leading zero digits of a, keeping at least one */
+static inline void __widefloat_integer_trim(__widefloat_integer_t *a) {
+  while ((a->size > ((size_t) 1)) &&
+	 (a->digits[a->size - ((size_t) 1)] == ((uint64_t) 0))) a->size--;
+}
+
+/* Sets r to a * b */
+static void __widefloat_integer_mul(__widefloat_integer_t *r,
+				    const __widefloat_integer_t *a,
+				    const __widefloat_integer_t *b) {
+  __widefloat_integer_init(r, a->size + b->size, (uint64_t) 0);
+  multiplication(r->digits, a->digits, a->size, b->digits, b->size);
+  __widefloat_integer_trim(r);
+}
+
+/* Sets r to a * b * 2^k + c * d */
+static void __widefloat_integer_addmul(__widefloat_integer_t *r,
+				       const __widefloat_integer_t *a,
+				       const __widefloat_integer_t *b,
+				       uint64_t k,
+				       const __widefloat_integer_t *c,
+				       const __widefloat_integer_t *d) {
+  __widefloat_integer_t u, v;
+  size_t n;
+
+  __widefloat_integer_mul(&u, a, b);
+  __widefloat_integer_mul(&v, c, d);
+  n = u.size + ((size_t) (k >> 6)) + ((size_t) 1);
+  if (n < v.size) n = v.size;
+  __widefloat_integer_init(r, n + ((size_t) 1), (uint64_t) 0);
+  memcpy(r->digits, u.digits, u.size * sizeof(*(u.digits)));
+  shift_left(r->digits, r->size, (size_t) k);
+  addition(r->digits, r->digits, r->size, v.digits, v.size);
+  __widefloat_integer_trim(r);
+  __widefloat_integer_clear(&u);
+  __widefloat_integer_clear(&v);
+}
+
+/* Sets all integers of node to 1, as for the empty product */
+static void __widefloat_split_init_one(__widefloat_split_t *node) {
+  __widefloat_integer_init(&node->P, (size_t) 1, (uint64_t) 1);
+  __widefloat_integer_init(&node->Q, (size_t) 1, (uint64_t) 1);
+  __widefloat_integer_init(&node->B, (size_t) 1, (uint64_t) 1);
+  __widefloat_integer_init(&node->T, (size_t) 1, (uint64_t) 1);
+  node->shift = (uint64_t) 0;
+}
+
+static void __widefloat_split_clear(__widefloat_split_t *node) {
+  __widefloat_integer_clear(&node->P);
+  __widefloat_integer_clear(&node->Q);
+  __widefloat_integer_clear(&node->B);
+  __widefloat_integer_clear(&node->T);
+}
+
+static void __widefloat_split(__widefloat_split_t *node, uint64_t a, uint64_t b, int need_p,
+			      __widefloat_term_func_t term, const void *arg);
+
+static void __widefloat_split_task(void *arg) {
+  __widefloat_split_args_t *args = (__widefloat_split_args_t *) arg;
+
+  __widefloat_split(args->node, args->a, args->b, args->need_p, args->term, args->arg);
+}
+
+/* Sets node to the integers of the terms a to b - 1, where a < b.
+   P is only computed if need_p is non-zero, and set to 1 otherwise.
+   The two halves of large ranges are split in parallel.
+*/
+static void __widefloat_split(__widefloat_split_t *node, uint64_t a, uint64_t b, int need_p,
+			      __widefloat_term_func_t term, const void *arg) {
+  __widefloat_split_t left, right;
+  __widefloat_split_args_t args;
+  __widefloat_integer_t u, v;
+  thread_task_t task;
+  uint64_t c;
+
+  if ((b - a) == ((uint64_t) 1)) {
+    term(node, a, arg);
+    return;
+  }
+
+  c = a + ((b - a) >> 1);
+  if (((b - a) >= WIDEFLOAT_SPLIT_PARALLEL_THRESHOLD) && (utepnum_get_threads() > 1u)) {
+    args.node = &right;
+    args.a = c;
+    args.b = b;
+    args.need_p = need_p;
+    args.term = term;
+    args.arg = arg;
+    thread_pool_fork(&task, __widefloat_split_task, &args);
+    __widefloat_split(&left, a, c, 1, term, arg);
+    thread_pool_join(&task);
+  } else {
+    __widefloat_split(&left, a, c, 1, term, arg);
+    __widefloat_split(&right, c, b, need_p, term, arg);
+  }
+
+  /* T = B2 * Q2 * 2^shift2 * T1 + B1 * P1 * T2 */
+  __widefloat_integer_mul(&u, &right.B, &right.Q);
+  __widefloat_integer_mul(&v, &left.B, &left.P);
+  __widefloat_integer_addmul(&node->T, &u, &left.T, right.shift, &v, &right.T);
+  node->shift = left.shift + right.shift;
+  __widefloat_integer_clear(&u);
+  __widefloat_integer_clear(&v);
+  __widefloat_integer_mul(&node->Q, &left.Q, &right.Q);
+  __widefloat_integer_mul(&node->B, &left.B, &right.B);
+  if (need_p) {
+    __widefloat_integer_mul(&node->P, &left.P, &right.P);
+  } else {
+    __widefloat_integer_init(&node->P, (size_t) 1, (uint64_t) 1);
+  }
+  __widefloat_split_clear(&left);
+  __widefloat_split_clear(&right);
+}
+
+/* Sets r to the sum of the terms 0 to N - 1 of the series given by
+   term, with N >= 1, to within a few units in the last place
+*/
+static void __widefloat_series(widefloat_t *r, uint64_t N,
+			       __widefloat_term_func_t term, const void *arg) {
+  thread_scratch_mark_t mark;
+  __widefloat_split_t node;
+  __widefloat_integer_t D;
+  widefloat_t t, d;
+
+  __widefloat_split(&node, (uint64_t) 0, N, 0, term, arg);
+  __widefloat_integer_mul(&D, &node.B, &node.Q);
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&t, r->mantissa_size);
+  __widefloat_scratch_init(&d, r->mantissa_size);
+  widefloat_set_from_integer(&t, node.T.digits, node.T.size);
+  widefloat_set_from_scaled_integer(&d, 0, (int64_t) node.shift, D.digits, D.size);
+  widefloat_div(r, &t, &d);
+  thread_scratch_release(mark);
+  __widefloat_integer_clear(&D);
+  __widefloat_split_clear(&node);
+}
+
+/* Divides the finite number op by d > 0, rounding toward zero */
+static void __widefloat_div_ui(widefloat_t *op, uint64_t d) {
+  thread_scratch_mark_t mark;
+  uint64_t *t;
+  uint64_t lzc;
+  size_t n = op->mantissa_size;
+
+  if (__widefloat_is_zero(op)) return;
+
+  /* t = floor(M * 2^64 / d) has its leading one at least 64 - 63 bits
+     below the one of M * 2^64
+  */
+  mark = thread_scratch_mark();
+  t = thread_scratch_alloc(n + ((size_t) 1), sizeof(*t));
+  t[0] = (uint64_t) 0;
+  memcpy(&t[1], op->mantissa, n * sizeof(*t));
+  divrem_1(t, t, n + ((size_t) 1), d);
+  lzc = leading_zeros(t, n + ((size_t) 1));
+  shift_left(t, n + ((size_t) 1), (size_t) (lzc - WIDEFLOAT_OVERHEAD));
+  memcpy(op->mantissa, &t[1], n * sizeof(*t));
+  thread_scratch_release(mark);
+  __widefloat_set_exponent(op, op->sign, ((int64_t) op->exponent) -
+			   ((int64_t) (lzc - WIDEFLOAT_OVERHEAD)));
+}
+
+/* Denominator d(l) of the ratio of the terms l and l - 1 of a series
+
+   sum z^i / (d(1) * ... * d(i))
+*/
+typedef uint64_t (*__widefloat_denominator_t)(uint64_t l);
+
+/* Divides the finite number op by d(lo) * d(lo + 1) * ... * d(hi),
+   grouping the factors into single digits
+*/
+static void __widefloat_div_range(widefloat_t *op, uint64_t lo, uint64_t hi,
+				  __widefloat_denominator_t d) {
+  uint64_t g, f, l;
+
+  g = (uint64_t) 1;
+  for (l=lo;l<=hi;l++) {
+    f = d(l);
+    if (g > (UINT64_MAX / f)) {
+      __widefloat_div_ui(op, g);
+      g = (uint64_t) 1;
+    }
+    g *= f;
+  }
+  __widefloat_div_ui(op, g);
+}
+
+/* Sets op to 1 */
+static inline void __widefloat_set_one(widefloat_t *op) {
+  __widefloat_set_special(op, FP_CLASS_NUMBER, 0);
+  op->mantissa[op->mantissa_size - ((size_t) 1)] =
+    ((uint64_t) 1) << (((uint64_t) 63) - WIDEFLOAT_OVERHEAD);
+}
+
+/* Term j of ln(2) = 2/3 * sum 1 / ((2 * j + 1) * 9^j) */
+static void __widefloat_ln2_term(__widefloat_split_t *node, uint64_t j, const void *arg) {
+  if (j == ((uint64_t) 0)) {
+    __widefloat_split_init_one(node);
+    return;
+  }
+  __widefloat_integer_init(&node->P, (size_t) 1, (uint64_t) 1);
+  __widefloat_integer_init(&node->Q, (size_t) 1, (uint64_t) 9);
+  __widefloat_integer_init(&node->B, (size_t) 1, (uint64_t) 2 * j + ((uint64_t) 1));
+  __widefloat_integer_init(&node->T, (size_t) 1, (uint64_t) 1);
+  node->shift = (uint64_t) 0;
+}
+
+/* Sets op to ln(2), to within a few units in the last place */
+static void __widefloat_ln2_compute(widefloat_t *op) {
+  uint64_t p, N;
+
+  /* 9^N > 2^p */
+  p = (((uint64_t) op->mantissa_size) << 6) + WIDEFLOAT_EXP_GUARD_BITS;
+  N = (uint64_t) (((double) p) / 3.169925001442312) + ((uint64_t) 2);
+  __widefloat_series(op, N, __widefloat_ln2_term, NULL);
+  __widefloat_scale(op, (int64_t) 1);
+  __widefloat_div_ui(op, (uint64_t) 3);
+}
+
+/* Constant computed at the greatest precision asked for so far */
+typedef struct {
+  pthread_mutex_t mutex;
+  widefloat_t     value;
+  void            (*compute)(widefloat_t *);
+} __widefloat_constant_t;
+
+static __widefloat_constant_t __widefloat_ln2_cache = {
+  PTHREAD_MUTEX_INITIALIZER,
+  { FPCLASS_NAN, 0, (int32_t) 0, (size_t) 0, NULL },
+  __widefloat_ln2_compute
+};
+
+/* Sets r to the constant c, recomputing it if the cache is shorter
+   than r.
+
+   The computation forks, so it runs without holding the mutex, which
+   only guards the cached value. Threads that race recompute the
+   constant each, and the longest result stays in the cache.
+*/
+static void __widefloat_constant(widefloat_t *r, __widefloat_constant_t *c) {
+  widefloat_t v, t;
+
+  pthread_mutex_lock(&c->mutex);
+  if (c->value.mantissa_size >= r->mantissa_size) {
+    __widefloat_copy(r, &c->value, 0);
+    pthread_mutex_unlock(&c->mutex);
+    return;
+  }
+  pthread_mutex_unlock(&c->mutex);
+
+  widefloat_init(&v, r->mantissa_size);
+  c->compute(&v);
+  pthread_mutex_lock(&c->mutex);
+  if (c->value.mantissa_size < v.mantissa_size) {
+    t = c->value;
+    c->value = v;
+    v = t;
+  }
+  __widefloat_copy(r, &c->value, 0);
+  pthread_mutex_unlock(&c->mutex);
+  if (v.mantissa != NULL) widefloat_clear(&v);
+}
+
+/* Denominators of the series of exp(z) */
+static uint64_t __widefloat_exp_denominator(uint64_t l) {
+  return l;
+}
+
+/* Returns the number N of terms of the series given by d, with
+   |z| < 2^-lo, such that the first term left out is below 2^-p
+*/
+static uint64_t __widefloat_series_terms(uint64_t lo, uint64_t p, __widefloat_denominator_t d) {
+  double bits;
+  uint64_t N;
+
+  bits = 0.0;
+  N = (uint64_t) 0;
+  while (bits < ((double) p)) {
+    N++;
+    bits += ((double) lo) + log2((double) d(N));
+  }
+  return N + ((uint64_t) 1);
+}
+
+/* Sets s to the sum of the N first terms of the series given by d in
+   y, by rectangular splitting
+*/
+static void __widefloat_rectangular(widefloat_t *s, const widefloat_t *y, uint64_t N,
+				    __widefloat_denominator_t d) {
+  thread_scratch_mark_t mark;
+  widefloat_t *pw;
+  widefloat_t v, acc;
+  uint64_t m, blocks, b, i, base;
+  size_t n = s->mantissa_size;
+
+  /* pw[i] = y^i for 0 <= i <= m */
+  m = (uint64_t) ceil(sqrt((double) N));
+  blocks = (N + m - ((uint64_t) 1)) / m;
+  mark = thread_scratch_mark();
+  pw = __alloc_mem((size_t) (m + ((uint64_t) 1)), sizeof(*pw));
+  for (i=0;i<=m;i++) {
+    __widefloat_scratch_init(&pw[i], n);
+  }
+  __widefloat_set_one(&pw[0]);
+  __widefloat_copy(&pw[1], y, y->sign);
+  for (i=2;i<=m;i++) {
+    widefloat_mul(&pw[i], &pw[i - ((uint64_t) 1)], &pw[1]);
+  }
+
+  /* The terms base to base + m - 1 of block b are y^base / (d(1) *
+     ... * d(base)) times
+
+     v = sum_{i < m} y^i / (d(base + 1) * ... * d(base + i)),
+
+     which is evaluated by Horner's rule on the powers. The blocks are
+     accumulated by Horner's rule on y^m.
+  */
+  __widefloat_scratch_init(&v, n);
+  __widefloat_scratch_init(&acc, n);
+  for (b=blocks;b-->((uint64_t) 0);) {
+    base = b * m;
+    __widefloat_copy(&v, &pw[m - ((uint64_t) 1)], pw[m - ((uint64_t) 1)].sign);
+    for (i=m-((uint64_t) 1);i>((uint64_t) 0);i--) {
+      __widefloat_div_ui(&v, d(base + i));
+      widefloat_add(&v, &v, &pw[i - ((uint64_t) 1)]);
+    }
+    if (b == (blocks - ((uint64_t) 1))) {
+      __widefloat_copy(&acc, &v, v.sign);
+    } else {
+      widefloat_mul(&acc, &acc, &pw[m]);
+      __widefloat_div_range(&acc, base + ((uint64_t) 1), base + m, d);
+      widefloat_add(&acc, &acc, &v);
+    }
+  }
+  __widefloat_copy(s, &acc, acc.sign);
+  __free_mem(pw);
+  thread_scratch_release(mark);
+}
+
+typedef struct {
+  const uint64_t *u;
+  size_t         size;
+  uint64_t       k;
+} __widefloat_exp_chunk_t;
+
+/* Term j of exp(u / 2^k) = sum (u / 2^k)^j / j! */
+static void __widefloat_exp_term(__widefloat_split_t *node, uint64_t j, const void *arg) {
+  const __widefloat_exp_chunk_t *c = (const __widefloat_exp_chunk_t *) arg;
+
+  if (j == ((uint64_t) 0)) {
+    __widefloat_split_init_one(node);
+    return;
+  }
+  __widefloat_integer_init(&node->P, c->size, (uint64_t) 0);
+  memcpy(node->P.digits, c->u, c->size * sizeof(*(c->u)));
+  __widefloat_integer_init(&node->T, c->size, (uint64_t) 0);
+  memcpy(node->T.digits, c->u, c->size * sizeof(*(c->u)));
+  __widefloat_integer_init(&node->Q, (size_t) 1, j);
+  __widefloat_integer_init(&node->B, (size_t) 1, (uint64_t) 1);
+  node->shift = c->k;
+}
+
+/* Sets s to exp(y), where 0 <= y < 1, for p bits of precision, by
+   bit-burst and binary splitting
+*/
+static void __widefloat_exp_splitting(widefloat_t *s, const widefloat_t *y, uint64_t p) {
+  thread_scratch_mark_t mark;
+  __widefloat_exp_chunk_t chunk;
+  widefloat_t e;
+  uint64_t *F;
+  uint64_t *u;
+  uint64_t W, lo, hi, len;
+  int64_t sh;
+  size_t n = y->mantissa_size;
+  size_t d;
+
+  __widefloat_set_one(s);
+  if (__widefloat_is_zero(y)) return;
+
+  /* F = floor(y * 2^W), with W = 64 * n */
+  mark = thread_scratch_mark();
+  W = ((uint64_t) n) << 6;
+  F = thread_scratch_alloc(n, sizeof(*F));
+  u = thread_scratch_alloc(n, sizeof(*u));
+  memcpy(F, y->mantissa, n * sizeof(*F));
+  sh = ((int64_t) y->exponent) + ((int64_t) WIDEFLOAT_OVERHEAD) + ((int64_t) 1);
+  if (sh >= ((int64_t) 0)) {
+    shift_left(F, n, (size_t) sh);
+  } else {
+    shift_right(F, n, (size_t) (-sh));
+  }
+
+  /* Chunk u / 2^hi holds the bits lo to hi - 1 of y after the binary point */
+  __widefloat_scratch_init(&e, s->mantissa_size);
+  lo = (uint64_t) 0;
+  hi = WIDEFLOAT_BURST_FIRST_BITS;
+  while (lo < W) {
+    if (hi > W) hi = W;
+    len = hi - lo;
+    memcpy(u, F, n * sizeof(*u));
+    shift_right(u, n, (size_t) (W - hi));
+    d = (size_t) ((len + ((uint64_t) 63)) >> 6);
+    if ((len & ((uint64_t) 63)) != ((uint64_t) 0)) {
+      u[d - ((size_t) 1)] &= (((uint64_t) 1) << (len & ((uint64_t) 63))) - ((uint64_t) 1);
+    }
+    while ((d > ((size_t) 1)) && (u[d - ((size_t) 1)] == ((uint64_t) 0))) d--;
+    if (!is_zero(u, d)) {
+      chunk.u = u;
+      chunk.size = d;
+      chunk.k = hi;
+      __widefloat_series(&e, __widefloat_series_terms(lo, p, __widefloat_exp_denominator),
+			 __widefloat_exp_term, &chunk);
+      widefloat_mul(s, s, &e);
+    }
+    lo = hi;
+    hi <<= 1;
+  }
+  thread_scratch_release(mark);
+}
+
+/* Exponential
+
+   Sets r to exp(a), to within a few units in the last place of the
+   precision of r.
+
+   exp(+inf) is +inf, exp(-inf) is +0, and results out of the range
+   of the exponent become infinity or zero.
+
+   r may be a. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_exp(widefloat_t *r, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t l2, t, kk, y, s;
+  uint64_t w, j, i, ak;
+  int64_t k;
+  double xd;
+  size_t n;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  if (a->fpclass == FPCLASS_NAN) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, (a->sign ? FP_CLASS_NUMBER : FPCLASS_POS_INF), 0);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_one(r);
+    return;
+  }
+  if (a->exponent >= ((int32_t) 32)) {
+    __widefloat_set_special(r, (a->sign ? FP_CLASS_NUMBER : FPCLASS_POS_INF), 0);
+    return;
+  }
+
+  /* k = floor(a / ln(2)), off by one at most */
+  xd = ldexp((double) a->mantissa[a->mantissa_size - ((size_t) 1)],
+	     ((int) a->exponent) - ((int) (((uint64_t) 63) - WIDEFLOAT_OVERHEAD)));
+  if (a->sign) xd = -xd;
+  k = (int64_t) floor(xd / WIDEFLOAT_LN2_DOUBLE);
+
+  /* Working precision, with j more bits for the squarings */
+  n = r->mantissa_size;
+  w = (((uint64_t) n) << 6) + WIDEFLOAT_EXP_GUARD_BITS;
+  j = (uint64_t) 0;
+  if (n <= WIDEFLOAT_EXP_SPLITTING_THRESHOLD) j = (uint64_t) cbrt((double) w);
+  w += j;
+
+  /* y = a - k * ln(2), with 0 <= y < ln(2) */
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&l2, __widefloat_size_for_bits(w + ((uint64_t) 64)));
+  __widefloat_scratch_init(&t, __widefloat_size_for_bits(w + ((uint64_t) 64)));
+  __widefloat_scratch_init(&kk, (size_t) 1);
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(w));
+  __widefloat_scratch_init(&s, __widefloat_size_for_bits(w));
+  __widefloat_constant(&l2, &__widefloat_ln2_cache);
+  ak = (k < ((int64_t) 0)) ? ((uint64_t) (-k)) : ((uint64_t) k);
+  widefloat_set_from_scaled_integer(&kk, (k < ((int64_t) 0)), (int64_t) 0, &ak, (size_t) 1);
+  widefloat_mul(&t, &kk, &l2);
+  widefloat_sub(&y, a, &t);
+  if (y.sign && (!__widefloat_is_zero(&y))) {
+    k--;
+    widefloat_add(&y, &y, &l2);
+  }
+
+  if (n <= WIDEFLOAT_EXP_SPLITTING_THRESHOLD) {
+    __widefloat_scale(&y, -((int64_t) j));
+    __widefloat_rectangular(&s, &y, __widefloat_series_terms(j, w, __widefloat_exp_denominator),
+			    __widefloat_exp_denominator);
+    for (i=0;i<j;i++) {
+      widefloat_mul(&s, &s, &s);
+    }
+  } else {
+    __widefloat_exp_splitting(&s, &y, w);
+  }
+  __widefloat_copy(r, &s, 0);
+  __widefloat_set_exponent(r, 0, ((int64_t) r->exponent) + k);
+  thread_scratch_release(mark);
+}
+
+/* Sets x to ln(m) to within 2^-p, where 1/sqrt(2) <= m < sqrt(2)
+   and x has at least __widefloat_size_for_bits(p) digits
+*/
+static void __widefloat_log_newton(widefloat_t *x, const widefloat_t *m, uint64_t p) {
+  thread_scratch_mark_t mark;
+  widefloat_t y, z, t, one;
+  double v;
+  uint64_t q;
+
+  if (p <= WIDEFLOAT_SEED_BITS) {
+    v = log(__widefloat_top_double(m));
+    if (v == 0.0) {
+      __widefloat_set_special(x, FP_CLASS_NUMBER, 0);
+    } else {
+      __widefloat_seed(x, fabs(v));
+      x->sign = (v < 0.0);
+    }
+    return;
+  }
+
+  /* y = ln(m) to a little more than half the bits */
+  q = ((p + ((uint64_t) 1)) >> 1) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(q));
+  __widefloat_log_newton(&y, m, q);
+
+  /* x = y + m * exp(-y) - 1 */
+  __widefloat_scratch_init(&z, __widefloat_size_for_bits(p + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_init(&t, __widefloat_size_for_bits(p + WIDEFLOAT_NEWTON_GUARD_BITS));
+  __widefloat_scratch_power_of_two(&one, (size_t) 1, (int32_t) 0);
+  y.sign = !y.sign;
+  widefloat_exp(&z, &y);
+  y.sign = !y.sign;
+  widefloat_mul(&t, m, &z);
+  widefloat_sub(&t, &t, &one);
+  widefloat_add(x, &y, &t);
+  thread_scratch_release(mark);
+}
+
+/* Logarithm
+
+   Sets r to ln(a), to within a few units in the last place of the
+   precision of r.
+
+   Sets r to NaN if a is negative, to -inf if a is zero and to +inf
+   if a is +inf. ln(1) is +0.
+
+   r may be a. Does nothing if r is clearly not initialized.
+
+*/
+void widefloat_log(widefloat_t *r, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t m, d, one, y, l2, kk, t;
+  uint64_t p, ae;
+  int64_t e;
+
+  /* Check special cases */
+  if (r->mantissa_size == ((size_t) 0)) return;
+  if (r->mantissa == NULL) return;
+  if (a->fpclass == FPCLASS_NAN) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    __widefloat_set_special(r, FPCLASS_NEG_INF, 1);
+    return;
+  }
+  if (a->sign) {
+    __widefloat_set_special(r, FPCLASS_NAN, 0);
+    return;
+  }
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    __widefloat_set_special(r, FPCLASS_POS_INF, 0);
+    return;
+  }
+
+  /* a = 2^e * m, with 1/sqrt(2) <= m < sqrt(2) */
+  e = (int64_t) a->exponent;
+  m = *a;
+  m.exponent = (int32_t) 0;
+  if (__widefloat_top_double(&m) >= WIDEFLOAT_SQRT2_DOUBLE) {
+    m.exponent = (int32_t) -1;
+    e++;
+  }
+
+  /* When e is zero, ln(m) is about m - 1, which may be small: it
+     then needs as many more bits as m - 1 has leading zeros
+  */
+  p = (((uint64_t) r->mantissa_size) << 6) + WIDEFLOAT_NEWTON_GUARD_BITS;
+  mark = thread_scratch_mark();
+  if (e == ((int64_t) 0)) {
+    __widefloat_scratch_init(&d, m.mantissa_size + ((size_t) 1));
+    __widefloat_scratch_power_of_two(&one, (size_t) 1, (int32_t) 0);
+    widefloat_sub(&d, &m, &one);
+    if (__widefloat_is_zero(&d)) {
+      __widefloat_set_special(r, FP_CLASS_NUMBER, 0);
+      thread_scratch_release(mark);
+      return;
+    }
+    if (d.exponent < ((int32_t) 0)) p += (uint64_t) (-((int64_t) d.exponent));
+  }
+
+  /* r = ln(m) + e * ln(2) */
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(p));
+  __widefloat_log_newton(&y, &m, p);
+  if (e == ((int64_t) 0)) {
+    __widefloat_copy(r, &y, y.sign);
+  } else {
+    __widefloat_scratch_init(&l2, __widefloat_size_for_bits(p + ((uint64_t) 64)));
+    __widefloat_scratch_init(&t, __widefloat_size_for_bits(p + ((uint64_t) 64)));
+    __widefloat_scratch_init(&kk, (size_t) 1);
+    __widefloat_constant(&l2, &__widefloat_ln2_cache);
+    ae = (e < ((int64_t) 0)) ? ((uint64_t) (-e)) : ((uint64_t) e);
+    widefloat_set_from_scaled_integer(&kk, (e < ((int64_t) 0)), (int64_t) 0, &ae, (size_t) 1);
+    widefloat_mul(&t, &kk, &l2);
+    widefloat_add(r, &y, &t);
+  }
+  thread_scratch_release(mark);
+}
+
+/* Sine and cosine
+
+   Both are evaluated from one argument reduction by pi/2,
+
+   x = k * pi/2 + r,   |r| <= pi/4,
+
+   where pi carries as many extra bits as k has, plus as many as the
+   cancellation in r takes, and the quadrant k mod 4 only permutes and
+   negates sin(r) and cos(r). pi is computed once, by binary splitting
+   of Machin's formula, and kept in a cache like ln(2).
+
+   r is halved j times, sin(r / 2^j) is summed by rectangular
+   splitting on the series in r^2, cos(r / 2^j) is its cofactor
+   sqrt(1 - sin^2) and both are doubled back j times by
+
+   sin(2 y) = 2 * sin(y) * cos(y),   cos(2 y) = 1 - 2 * sin(y)^2.
+
+   Twiddle factors exp(2 * pi * i * k / N) only need to be computed
+   directly for k up to N/8, the others following exactly by
+   symmetry. These k = b * L + t are taken as the products of about
+   sqrt(N/8) block seeds for b * L and as many steps for t, all
+   evaluated independently one digit above the target precision: each
+   factor is one complex multiplication away from two exact
+   evaluations, so errors do not accumulate as in a recurrence.
+
+*/
+#define WIDEFLOAT_TWIDDLES_PARALLEL_THRESHOLD ((uint64_t) 16)
+
+/* Term j of (x^2 + 1) / x * atan(1 / x) = sum prod_{i <= j} 2 * i / ((2 * i + 1) * (x^2 + 1)),
+   where arg points to x^2 + 1
+*/
+static void __widefloat_atan_term(__widefloat_split_t *node, uint64_t j, const void *arg) {
+  uint64_t x2 = *((const uint64_t *) arg);
+
+  if (j == ((uint64_t) 0)) {
+    __widefloat_split_init_one(node);
+    return;
+  }
+  __widefloat_integer_init(&node->P, (size_t) 1, ((uint64_t) 2) * j);
+  __widefloat_integer_init(&node->Q, (size_t) 1, (((uint64_t) 2) * j + ((uint64_t) 1)) * x2);
+  __widefloat_integer_init(&node->B, (size_t) 1, (uint64_t) 1);
+  __widefloat_integer_init(&node->T, (size_t) 1, ((uint64_t) 2) * j);
+  node->shift = (uint64_t) 0;
+}
+
+/* Sets op to op * m / d, for m, d > 0 */
+static void __widefloat_mul_ratio(widefloat_t *op, uint64_t m, uint64_t d) {
+  thread_scratch_mark_t mark;
+  widefloat_t f;
+
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&f, (size_t) 1);
+  widefloat_set_from_integer(&f, &m, (size_t) 1);
+  widefloat_mul(op, op, &f);
+  __widefloat_div_ui(op, d);
+  thread_scratch_release(mark);
+}
+
+/* Sets op to pi, to within a few units in the last place, by
+
+   pi = 16 * atan(1/5) - 4 * atan(1/239)
+      = 40/13 * S(26) - 478/28561 * S(57122),
+
+   where S(x^2 + 1) is the series of __widefloat_atan_term, whose
+   terms decrease by a factor x^2 + 1
+*/
+static void __widefloat_pi_compute(widefloat_t *op) {
+  thread_scratch_mark_t mark;
+  widefloat_t t;
+  uint64_t p, x2;
+
+  p = (((uint64_t) op->mantissa_size) << 6) + WIDEFLOAT_EXP_GUARD_BITS;
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&t, op->mantissa_size);
+  x2 = (uint64_t) 26;
+  __widefloat_series(op, (uint64_t) (((double) p) / 4.700439718141092) + ((uint64_t) 2),
+		     __widefloat_atan_term, &x2);
+  __widefloat_mul_ratio(op, (uint64_t) 40, (uint64_t) 13);
+  x2 = (uint64_t) 57122;
+  __widefloat_series(&t, (uint64_t) (((double) p) / 15.801708951369088) + ((uint64_t) 2),
+		     __widefloat_atan_term, &x2);
+  __widefloat_mul_ratio(&t, (uint64_t) 478, (uint64_t) 28561);
+  widefloat_sub(op, op, &t);
+  thread_scratch_release(mark);
+}
+
+static __widefloat_constant_t __widefloat_pi_cache = {
+  PTHREAD_MUTEX_INITIALIZER,
+  { FPCLASS_NAN, 0, (int32_t) 0, (size_t) 0, NULL },
+  __widefloat_pi_compute
+};
+
+/* Denominators of the series of sin(y) / y in z = -y^2 */
+static uint64_t __widefloat_sin_denominator(uint64_t l) {
+  return (((uint64_t) 2) * l) * (((uint64_t) 2) * l + ((uint64_t) 1));
+}
+
+/* Rounds the finite number op to the nearest integer, ties away from
+   zero, and returns this integer modulo 4
+*/
+static uint64_t __widefloat_round(widefloat_t *op) {
+  thread_scratch_mark_t mark;
+  widefloat_t half;
+  int64_t f;
+  uint64_t q;
+  size_t n = op->mantissa_size;
+
+  if (__widefloat_is_zero(op)) return (uint64_t) 0;
+  if (op->exponent < ((int32_t) -1)) {
+    __widefloat_set_special(op, FP_CLASS_NUMBER, 0);
+    return (uint64_t) 0;
+  }
+
+  /* |op| + 1/2, which op holds exactly as long as it has a bit for 1/2 */
+  mark = thread_scratch_mark();
+  __widefloat_scratch_power_of_two(&half, (size_t) 1, (int32_t) -1);
+  half.sign = op->sign;
+  widefloat_add(op, op, &half);
+  thread_scratch_release(mark);
+
+  /* The unit is bit f of the mantissa: drop the bits below it */
+  f = ((int64_t) (((uint64_t) n) << 6)) - ((int64_t) 1) - ((int64_t) WIDEFLOAT_OVERHEAD) -
+    ((int64_t) op->exponent);
+  q = (uint64_t) 0;
+  if (f >= ((int64_t) 0)) {
+    q = (uint64_t) test_bit(op->mantissa, n, (uint64_t) f);
+    shift_right(op->mantissa, n, (size_t) f);
+    shift_left(op->mantissa, n, (size_t) f);
+  }
+  if (f >= ((int64_t) -1)) {
+    q += ((uint64_t) test_bit(op->mantissa, n, (uint64_t) (f + ((int64_t) 1)))) << 1;
+  }
+  if (op->sign) q = (((uint64_t) 4) - q) & ((uint64_t) 3);
+  return q;
+}
+
+/* Sets r to x - k * pi/2, with |r| <= pi/4 and r having w bits of
+   relative precision, and returns k mod 4, where x is finite and
+   |x| >= 1/2
+*/
+static uint64_t __widefloat_reduce_pi2(widefloat_t *r, const widefloat_t *x, uint64_t w) {
+  thread_scratch_mark_t mark;
+  widefloat_t pi2, t, u;
+  uint64_t e, extra, q;
+
+  e = (uint64_t) (((int64_t) x->exponent) + ((int64_t) 2));
+  extra = (uint64_t) 64;
+  for (;;) {
+    mark = thread_scratch_mark();
+    __widefloat_scratch_init(&pi2, __widefloat_size_for_bits(w + e + extra));
+    __widefloat_scratch_init(&u, __widefloat_size_for_bits(w + e + extra));
+    __widefloat_scratch_init(&t, __widefloat_size_for_bits(e + ((uint64_t) 64)));
+    __widefloat_constant(&pi2, &__widefloat_pi_cache);
+    __widefloat_scale(&pi2, (int64_t) -1);
+
+    /* k = round(x / (pi/2)), which only needs the integer part and a
+       few more bits, then u = x - k * pi/2
+    */
+    widefloat_div(&t, x, &pi2);
+    q = __widefloat_round(&t);
+    widefloat_mul(&u, &t, &pi2);
+    widefloat_sub(&u, x, &u);
+
+    /* The error on u is about 2^-(w + extra): it is good if u did not
+       cancel by more than extra bits
+    */
+    if ((!__widefloat_is_zero(&u)) &&
+	((((int64_t) u.exponent) + ((int64_t) extra)) >= ((int64_t) 8))) {
+      __widefloat_copy(r, &u, u.sign);
+      thread_scratch_release(mark);
+      return q;
+    }
+    if (__widefloat_is_zero(&u)) {
+      extra <<= 1;
+    } else {
+      extra = ((uint64_t) (-((int64_t) u.exponent))) + ((uint64_t) 64);
+    }
+    thread_scratch_release(mark);
+  }
+}
+
+/* Joint sine and cosine
+
+   Sets s to sin(a) and c to cos(a), each to within a few units in the
+   last place of its precision. Either of s and c may be NULL.
+
+   Both are NaN if a is NaN or an infinity. sin(+/-0) is +/-0 and
+   cos(+/-0) is 1. The cost of the argument reduction grows with the
+   exponent of a, which decides how many bits of pi are needed.
+
+   s and c may be a. Does nothing for an output that is clearly not
+   initialized.
+
+*/
+void widefloat_sin_cos(widefloat_t *s, widefloat_t *c, const widefloat_t *a) {
+  thread_scratch_mark_t mark;
+  widefloat_t r, y, z, S, C, t, one;
+  const widefloat_t *sv;
+  const widefloat_t *cv;
+  int ss, cs;
+  uint64_t w, j, i, q;
+  size_t n;
+
+  /* Check special cases */
+  if ((s != NULL) && ((s->mantissa_size == ((size_t) 0)) || (s->mantissa == NULL))) s = NULL;
+  if ((c != NULL) && ((c->mantissa_size == ((size_t) 0)) || (c->mantissa == NULL))) c = NULL;
+  if ((s == NULL) && (c == NULL)) return;
+  if (a->fpclass != FP_CLASS_NUMBER) {
+    if (s != NULL) __widefloat_set_special(s, FPCLASS_NAN, 0);
+    if (c != NULL) __widefloat_set_special(c, FPCLASS_NAN, 0);
+    return;
+  }
+  if (__widefloat_is_zero(a)) {
+    if (s != NULL) __widefloat_set_special(s, FP_CLASS_NUMBER, a->sign);
+    if (c != NULL) __widefloat_set_one(c);
+    return;
+  }
+
+  /* Working precision, with j more bits for the doublings */
+  n = (size_t) 0;
+  if (s != NULL) n = s->mantissa_size;
+  if ((c != NULL) && (c->mantissa_size > n)) n = c->mantissa_size;
+  w = (((uint64_t) n) << 6) + WIDEFLOAT_EXP_GUARD_BITS;
+  j = (uint64_t) cbrt((double) w);
+  w += j;
+
+  /* a = k * pi/2 + r */
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&r, __widefloat_size_for_bits(w));
+  q = (uint64_t) 0;
+  if (a->exponent < ((int32_t) -1)) {
+    __widefloat_copy(&r, a, a->sign);
+  } else {
+    q = __widefloat_reduce_pi2(&r, a, w);
+  }
+
+  /* S = sin(y) = y * sum z^i / (2 * i + 1)!, with y = |r| / 2^j and
+     z = -y^2, so that |z| < 2^(-2 * j)
+  */
+  __widefloat_scratch_init(&y, __widefloat_size_for_bits(w));
+  __widefloat_scratch_init(&z, __widefloat_size_for_bits(w));
+  __widefloat_scratch_init(&S, __widefloat_size_for_bits(w));
+  __widefloat_scratch_init(&C, __widefloat_size_for_bits(w));
+  __widefloat_scratch_init(&t, __widefloat_size_for_bits(w));
+  __widefloat_scratch_power_of_two(&one, (size_t) 1, (int32_t) 0);
+  __widefloat_copy(&y, &r, 0);
+  __widefloat_scale(&y, -((int64_t) j));
+  widefloat_mul(&z, &y, &y);
+  z.sign = 1;
+  __widefloat_rectangular(&S, &z, __widefloat_series_terms(((uint64_t) 2) * j, w,
+							 __widefloat_sin_denominator),
+			  __widefloat_sin_denominator);
+  widefloat_mul(&S, &S, &y);
+
+  /* C = sqrt(1 - S^2), then j doublings */
+  widefloat_mul(&t, &S, &S);
+  widefloat_sub(&t, &one, &t);
+  widefloat_sqrt(&C, &t);
+  for (i=0;i<j;i++) {
+    widefloat_mul(&t, &S, &S);
+    __widefloat_scale(&t, (int64_t) 1);
+    widefloat_mul(&S, &S, &C);
+    __widefloat_scale(&S, (int64_t) 1);
+    widefloat_sub(&C, &one, &t);
+  }
+
+  /* sin(a) and cos(a) from sin(r) and cos(r) by quadrant */
+  S.sign = r.sign;
+  switch (q) {
+  case 0:
+    sv = &S; ss = S.sign; cv = &C; cs = 0;
+    break;
+  case 1:
+    sv = &C; ss = 0; cv = &S; cs = !S.sign;
+    break;
+  case 2:
+    sv = &S; ss = !S.sign; cv = &C; cs = 1;
+    break;
+  default:
+    sv = &C; ss = 1; cv = &S; cs = S.sign;
+    break;
+  }
+  if (s != NULL) __widefloat_copy(s, sv, ss);
+  if (c != NULL) __widefloat_copy(c, cv, cs);
+  thread_scratch_release(mark);
+}
+
+typedef struct {
+  widefloat_t       *out;
+  widefloat_t       *steps;
+  widefloat_t       *seeds;
+  const widefloat_t *pi;
+  uint64_t          N;
+  uint64_t          K;
+  uint64_t          L;
+  uint64_t          lo;
+  uint64_t          hi;
+} __widefloat_twiddles_t;
+
+/* Sets c and s to cos(2 * pi * m / N) and sin(2 * pi * m / N) */
+static void __widefloat_twiddle(widefloat_t *c, widefloat_t *s, const widefloat_t *pi,
+				uint64_t m, uint64_t N) {
+  thread_scratch_mark_t mark;
+  widefloat_t theta, f;
+
+  if (m == ((uint64_t) 0)) {
+    __widefloat_set_one(c);
+    __widefloat_set_special(s, FP_CLASS_NUMBER, 0);
+    return;
+  }
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&theta, pi->mantissa_size);
+  __widefloat_scratch_init(&f, (size_t) 1);
+  widefloat_set_from_integer(&f, &m, (size_t) 1);
+  widefloat_mul(&theta, pi, &f);
+  __widefloat_scale(&theta, (int64_t) 1);
+  __widefloat_div_ui(&theta, N);
+  widefloat_sin_cos(s, c, &theta);
+  thread_scratch_release(mark);
+}
+
+/* Computes the steps, for the indices i < L, and the block seeds, for
+   the indices L + b, among the indices lo to hi - 1
+*/
+static void __widefloat_twiddles_seeds(void *arg) {
+  const __widefloat_twiddles_t *tw = (const __widefloat_twiddles_t *) arg;
+  uint64_t i, b;
+
+  for (i=tw->lo;i<tw->hi;i++) {
+    if (i < tw->L) {
+      __widefloat_twiddle(&tw->steps[((uint64_t) 2) * i], &tw->steps[((uint64_t) 2) * i + ((uint64_t) 1)],
+			  tw->pi, i, tw->N);
+    } else {
+      b = i - tw->L;
+      __widefloat_twiddle(&tw->seeds[((uint64_t) 2) * b], &tw->seeds[((uint64_t) 2) * b + ((uint64_t) 1)],
+			  tw->pi, b * tw->L, tw->N);
+    }
+  }
+}
+
+/* Computes the factors k = b * L + t <= K of the blocks lo to hi - 1
+   as the products of the seed of b and the step of t
+*/
+static void __widefloat_twiddles_blocks(void *arg) {
+  const __widefloat_twiddles_t *tw = (const __widefloat_twiddles_t *) arg;
+  thread_scratch_mark_t mark;
+  widefloat_t u, v;
+  const widefloat_t *cb;
+  const widefloat_t *sb;
+  const widefloat_t *ct;
+  const widefloat_t *st;
+  uint64_t b, t, k;
+
+  mark = thread_scratch_mark();
+  __widefloat_scratch_init(&u, tw->steps[0].mantissa_size);
+  __widefloat_scratch_init(&v, tw->steps[0].mantissa_size);
+  for (b=tw->lo;b<tw->hi;b++) {
+    cb = &tw->seeds[((uint64_t) 2) * b];
+    sb = &tw->seeds[((uint64_t) 2) * b + ((uint64_t) 1)];
+    for (t=0;t<tw->L;t++) {
+      k = b * tw->L + t;
+      if (k > tw->K) break;
+      ct = &tw->steps[((uint64_t) 2) * t];
+      st = &tw->steps[((uint64_t) 2) * t + ((uint64_t) 1)];
+      if (t == ((uint64_t) 0)) {
+	__widefloat_copy(&tw->out[((uint64_t) 2) * k], cb, cb->sign);
+	__widefloat_copy(&tw->out[((uint64_t) 2) * k + ((uint64_t) 1)], sb, sb->sign);
+	continue;
+      }
+      if (b == ((uint64_t) 0)) {
+	__widefloat_copy(&tw->out[((uint64_t) 2) * k], ct, ct->sign);
+	__widefloat_copy(&tw->out[((uint64_t) 2) * k + ((uint64_t) 1)], st, st->sign);
+	continue;
+      }
+
+      /* cos = cb * ct - sb * st, sin = sb * ct + cb * st */
+      widefloat_mul(&u, cb, ct);
+      widefloat_mul(&v, sb, st);
+      widefloat_sub(&tw->out[((uint64_t) 2) * k], &u, &v);
+      widefloat_mul(&u, sb, ct);
+      widefloat_mul(&v, cb, st);
+      widefloat_add(&tw->out[((uint64_t) 2) * k + ((uint64_t) 1)], &u, &v);
+    }
+  }
+  thread_scratch_release(mark);
+}
+
+/* Runs func on count indices, split into ranges over the threads */
+static void __widefloat_twiddles_map(const __widefloat_twiddles_t *tw, uint64_t count,
+				     thread_task_func_t func) {
+  __widefloat_twiddles_t *ranges;
+  thread_task_t *tasks;
+  uint64_t t, i;
+
+  t = (uint64_t) utepnum_get_threads();
+  if (count < WIDEFLOAT_TWIDDLES_PARALLEL_THRESHOLD) t = (uint64_t) 1;
+
+  ranges = __alloc_mem((size_t) t, sizeof(*ranges));
+  tasks = __alloc_mem((size_t) t, sizeof(*tasks));
+  for (i=0;i<t;i++) {
+    ranges[i] = *tw;
+    ranges[i].lo = count * i / t;
+    ranges[i].hi = count * (i + ((uint64_t) 1)) / t;
+  }
+  for (i=1;i<t;i++) {
+    thread_pool_fork(&tasks[i], func, &ranges[i]);
+  }
+  func(&ranges[0]);
+  for (i=t-((uint64_t) 1);i>((uint64_t) 0);i--) {
+    thread_pool_join(&tasks[i]);
+  }
+  __free_mem(ranges);
+  __free_mem(tasks);
+}
+
+/* Sets r to -a, keeping zero positive */
+static inline void __widefloat_copy_negated(widefloat_t *r, const widefloat_t *a) {
+  __widefloat_copy(r, a, (!a->sign) && (!__widefloat_is_zero(a)));
+}
+
+/* Twiddle factors
+
+   Sets out[2 * k] to cos(2 * pi * k / N) and out[2 * k + 1] to
+   sin(2 * pi * k / N), for 0 <= k < N, each to within a few units in
+   the last place. out holds 2 * N initialized numbers of the same
+   precision, the one of out[0].
+
+   The factors for k <= N/8 (or N/4 or N/2, when 8 or 4 do not divide
+   N) are products of about 2 * sqrt(N/8) independent evaluations,
+   spread over the threads, and the other ones are copies with
+   exchanged or negated parts. 1, -1, i and -i are exact.
+
+   Does nothing if N is zero or out is clearly not initialized.
+
+*/
+void widefloat_twiddles(widefloat_t *out, size_t N) {
+  __widefloat_twiddles_t tw;
+  widefloat_t pi;
+  uint64_t K, L, B, i, k, m, NN;
+  size_t n;
+
+  if (N == ((size_t) 0)) return;
+  if (out[0].mantissa_size == ((size_t) 0)) return;
+  if (out[0].mantissa == NULL) return;
+  n = out[0].mantissa_size;
+  NN = (uint64_t) N;
+
+  /* Factors computed directly: k <= K, with K * L + L - 1 >= K */
+  K = NN >> 1;
+  if ((NN & ((uint64_t) 3)) == ((uint64_t) 0)) K = NN >> 2;
+  if ((NN & ((uint64_t) 7)) == ((uint64_t) 0)) K = NN >> 3;
+  L = (uint64_t) ceil(sqrt((double) (K + ((uint64_t) 1))));
+  B = K / L + ((uint64_t) 1);
+
+  /* The seeds have one more digit, which keeps the products within a
+     few units in the last place, also for the small cosines near pi/2
+     when 4 does not divide N
+  */
+  widefloat_init(&pi, n + ((size_t) 2));
+  __widefloat_constant(&pi, &__widefloat_pi_cache);
+  tw.out = out;
+  tw.steps = __alloc_mem((size_t) (((uint64_t) 2) * L), sizeof(*(tw.steps)));
+  tw.seeds = __alloc_mem((size_t) (((uint64_t) 2) * B), sizeof(*(tw.seeds)));
+  for (i=0;i<(((uint64_t) 2) * L);i++) {
+    widefloat_init(&tw.steps[i], n + ((size_t) 1));
+  }
+  for (i=0;i<(((uint64_t) 2) * B);i++) {
+    widefloat_init(&tw.seeds[i], n + ((size_t) 1));
+  }
+  tw.pi = &pi;
+  tw.N = NN;
+  tw.K = K;
+  tw.L = L;
+  __widefloat_twiddles_map(&tw, L + B, __widefloat_twiddles_seeds);
+  __widefloat_twiddles_map(&tw, B, __widefloat_twiddles_blocks);
+
+  /* N/8 < k <= N/4: (cos, sin)(k) = (sin, cos)(N/4 - k) */
+  if ((NN & ((uint64_t) 7)) == ((uint64_t) 0)) {
+    for (k=K+((uint64_t) 1);k<=(NN>>2);k++) {
+      m = (NN >> 2) - k;
+      __widefloat_copy(&out[((uint64_t) 2) * k], &out[((uint64_t) 2) * m + ((uint64_t) 1)],
+		       out[((uint64_t) 2) * m + ((uint64_t) 1)].sign);
+      __widefloat_copy(&out[((uint64_t) 2) * k + ((uint64_t) 1)], &out[((uint64_t) 2) * m],
+		       out[((uint64_t) 2) * m].sign);
+    }
+  }
+
+  /* N/4 < k <= N/2: (cos, sin)(k) = (-sin, cos)(k - N/4), from an
+     exact i
+  */
+  if ((NN & ((uint64_t) 3)) == ((uint64_t) 0)) {
+    __widefloat_set_special(&out[NN >> 1], FP_CLASS_NUMBER, 0);
+    __widefloat_set_one(&out[(NN >> 1) + ((uint64_t) 1)]);
+    for (k=(NN>>2)+((uint64_t) 1);k<=(NN>>1);k++) {
+      m = k - (NN >> 2);
+      __widefloat_copy_negated(&out[((uint64_t) 2) * k], &out[((uint64_t) 2) * m + ((uint64_t) 1)]);
+      __widefloat_copy(&out[((uint64_t) 2) * k + ((uint64_t) 1)], &out[((uint64_t) 2) * m],
+		       out[((uint64_t) 2) * m].sign);
+    }
+  }
+
+  /* -1 is exact */
+  if ((NN & ((uint64_t) 1)) == ((uint64_t) 0)) {
+    __widefloat_set_one(&out[NN]);
+    out[NN].sign = 1;
+    __widefloat_set_special(&out[NN + ((uint64_t) 1)], FP_CLASS_NUMBER, 0);
+  }
+
+  /* N/2 < k < N: (cos, sin)(k) = (cos, -sin)(N - k) */
+  for (k=(NN>>1)+((uint64_t) 1);k<NN;k++) {
+    m = NN - k;
+    __widefloat_copy(&out[((uint64_t) 2) * k], &out[((uint64_t) 2) * m],
+		     out[((uint64_t) 2) * m].sign);
+    __widefloat_copy_negated(&out[((uint64_t) 2) * k + ((uint64_t) 1)],
+			     &out[((uint64_t) 2) * m + ((uint64_t) 1)]);
+  }
+
+  for (i=0;i<(((uint64_t) 2) * L);i++) {
+    widefloat_clear(&tw.steps[i]);
+  }
+  for (i=0;i<(((uint64_t) 2) * B);i++) {
+    widefloat_clear(&tw.seeds[i]);
+  }
+  __free_mem(tw.steps);
+  __free_mem(tw.seeds);
+  widefloat_clear(&pi);
+}